@@ -0,0 +1,370 @@
+/*
+ ================================================================================================================
+ Nom du fichier        : bench.c
+ Projet				   : UE Programmation système avancée - projet : Files de messages
+                         M1 : Master Informatique fondamentale et appliquee - Universite Paris Cité .
+ Description           : Mesure des performances des files de messages : débit (messages/s, Mo/s) et latence
+                         de bout en bout (p50, p99, p99.9), pour chaque combinaison de moteur, de nombre de producteurs
+                         et de consommateurs, de taille de message, de capacité, de mode (bloquant ou O_NONBLOCK)
+                         et d'alignement des messages (M_ALIGNE : le faux partage entre messages voisins).
+
+ make bench && ./bench [-n messages] [-m moteurs] [-p producteurs] [-c consommateurs] [-s tailles] [-q capacites] [-b modes] [-a alignements] [-C cpus]
+ Par exemple, l'effet de M_ALIGNE sur des petits messages : ./bench -m spsc,mpmc -p 1 -c 1 -s 16 -b 0 -a 0,1
+ -C fixe chaque processus sur un processeur : les producteurs prennent les premiers de la liste, les consommateurs les suivants.
+ L'aller-retour des lignes de cache entre deux cœurs, un producteur et un consommateur de petits messages :
+   ./bench -m spsc,mpmc -p 1 -c 1 -s 16 -q 64 -b 1 -a 0,1 -C 0,1    (producteur sur le cœur 0, consommateur sur le cœur 1)
+   ./bench -m spsc,mpmc -p 1 -c 1 -s 16 -q 64 -b 1 -a 0,1 -C 0      (les deux sur le cœur 0 : la référence sans échange entre cœurs)
+ En mode O_NONBLOCK (-b 1), les processus ne s'endorment pas : la latence mesurée est celle des transferts entre caches.
+ ================================================================================================================
+ */
+
+#include <stdlib.h> // exit() EXIT_SUCCESS, EXIT_FAILURE, strtoul(), qsort()
+#include <stdio.h> // printf()
+#include <fcntl.h> // m_connexion() : pour les constantes O_
+#include <errno.h>
+#include <unistd.h> // fork(), _exit(), getopt()
+#include <string.h> // memcpy(), strtok()
+#include <time.h> // clock_gettime()
+#include <sched.h> // sched_yield(), sched_setaffinity()
+#include <stdatomic.h> // compteurs partagés entre les processus
+#include <sys/mman.h> // mmap() : la mémoire partagée des résultats
+#include <sys/wait.h> // waitpid()
+#include "m_file.h"
+
+#define NB_MAX_VALEURS 16 // le nombre maximal de valeurs pour chaque paramètre balayé
+
+// Une liste de valeurs pour un paramètre balayé
+typedef struct liste {
+	size_t valeurs[NB_MAX_VALEURS];
+	int nombre;
+} LISTE;
+
+// Les moteurs, dans l'ordre de leurs constantes M_
+static const struct {
+	const char* nom;
+	int options;
+} moteurs[] = {
+	{ "mutex", M_MUTEX },
+	{ "spsc", M_SPSC },
+	{ "mpmc", M_MPMC },
+	{ "priorite", M_PRIORITE },
+	{ "octets", M_OCTETS },
+};
+
+#define NB_MOTEURS ( sizeof(moteurs) / sizeof(moteurs[0]) )
+
+/**
+ * La mémoire partagée entre le processus père et les processus fils d'une mesure :
+ * le signal de départ, puis une latence par message reçu.
+ */
+typedef struct resultats {
+	_Atomic int depart; // 1 quand tous les processus sont créés
+	_Atomic size_t nombre_latences; // le nombre de latences enregistrées
+	uint64_t latences[]; // en nanosecondes
+} RESULTATS;
+
+// L'horloge des horodatages : CLOCK_MONOTONIC, commune à tous les processus
+static uint64_t maintenant(void) {
+	struct timespec t;
+
+	// int clock_gettime(clockid_t clockid, struct timespec *tp);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+// Lit une liste de nombres séparés par des virgules
+static void lire_liste(LISTE* liste, char* texte) {
+	liste->nombre = 0;
+
+	// char *strtok(char *str, const char *delim);
+	char* valeur;
+	for (valeur = strtok(texte, ",") ; valeur != NULL && liste->nombre < NB_MAX_VALEURS ; valeur = strtok(NULL, ","))
+		liste->valeurs[liste->nombre++] = strtoul(valeur, NULL, 10);
+}
+
+// Lit la liste des moteurs (par leur nom) ; retourne un masque de bits, un bit par moteur
+static unsigned lire_moteurs(char* texte) {
+	unsigned masque = 0;
+
+	char* nom;
+	for (nom = strtok(texte, ",") ; nom != NULL ; nom = strtok(NULL, ",")) {
+		size_t i;
+		for (i = 0 ; i < NB_MOTEURS ; i++)
+			if (strcmp(nom, moteurs[i].nom) == 0)
+				masque |= 1u << i;
+	}
+
+	return masque;
+}
+
+static int comparer(const void* a, const void* b) {
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+// Le centile p (entre 0 et 1) des n latences triées
+static uint64_t centile(const uint64_t* latences, size_t n, double p) {
+	if (n == 0)
+		return 0;
+
+	size_t rang = (size_t) (p * (double) (n - 1) + 0.5);
+
+	return latences[rang];
+}
+
+static void attendre_depart(RESULTATS* resultats) {
+	while (! atomic_load(&resultats->depart))
+		sched_yield();
+}
+
+/**
+ * Un producteur : envoie nombre messages de taille octets ; les 8 premiers octets sont l'heure d'envoi.
+ * En mode O_NONBLOCK, un envoi refusé (file pleine) est réessayé.
+ */
+static void producteur(MESSAGE* file, RESULTATS* resultats, size_t nombre, size_t taille, int flags) {
+	char* tampon = calloc(1, taille);
+	struct mon_message message = { 1, tampon };
+
+	attendre_depart(resultats);
+
+	size_t i;
+	for (i = 0 ; i < nombre ; i++) {
+		uint64_t heure = maintenant();
+		memcpy(tampon, &heure, sizeof(heure));
+
+		while (m_envoi(file, &message, taille, flags) == -1) {
+			if (errno != EAGAIN) {
+				perror("m_envoi()");
+				exit(EXIT_FAILURE);
+			}
+			sched_yield();
+		}
+	}
+
+	free(tampon);
+}
+
+/**
+ * Un consommateur : reçoit jusqu'au message de fin (heure d'envoi nulle) et enregistre la latence de chaque message.
+ */
+static void consommateur(MESSAGE* file, RESULTATS* resultats, size_t taille, int flags) {
+	char* tampon = malloc(taille);
+
+	attendre_depart(resultats);
+
+	for (;;) {
+		ssize_t lu = m_reception(file, tampon, taille, 0, flags);
+		if (lu == -1) {
+			if (errno != EAGAIN) {
+				perror("m_reception()");
+				exit(EXIT_FAILURE);
+			}
+			sched_yield();
+			continue;
+		}
+
+		uint64_t heure;
+		memcpy(&heure, tampon, sizeof(heure));
+		if (heure == 0) // message de fin
+			break;
+
+		uint64_t latence = maintenant() - heure;
+		resultats->latences[atomic_fetch_add(&resultats->nombre_latences, 1)] = latence;
+	}
+
+	free(tampon);
+}
+
+// Le processeur du processus de rang rang (producteurs puis consommateurs) ; −1 si la liste -C est vide
+static int processeur(const LISTE* cpus, size_t rang) {
+	return cpus->nombre == 0 ? -1 : (int) cpus->valeurs[rang % (size_t) cpus->nombre];
+}
+
+// Crée un processus fils, fixé sur le processeur cpu (sauf si cpu vaut −1), qui exécute la fonction du rôle demandé puis se termine
+static pid_t lancer(int role, MESSAGE* file, RESULTATS* resultats, size_t nombre, size_t taille, int flags, int cpu) {
+	pid_t pid = fork();
+
+	if (pid == -1) {
+		perror("Fonction fork()");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pid == 0) { // <=> Processus fils
+		if (cpu != -1) {
+			cpu_set_t ensemble;
+			CPU_ZERO(&ensemble);
+			CPU_SET(cpu, &ensemble);
+
+			// int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t *mask);
+			if (sched_setaffinity(0, sizeof(ensemble), &ensemble) == -1) {
+				perror("Fonction sched_setaffinity()");
+				_exit(EXIT_FAILURE);
+			}
+		}
+
+		if (role == 0)
+			producteur(file, resultats, nombre, taille, flags);
+		else
+			consommateur(file, resultats, taille, flags);
+		_exit(EXIT_SUCCESS);
+	}
+
+	return pid;
+}
+
+/**
+ * Une mesure : producteurs × consommateurs processus échangent nb_messages messages de taille octets
+ * par une file anonyme du moteur donné. Affiche une ligne CSV.
+ */
+static void mesurer(int moteur, size_t producteurs, size_t consommateurs, size_t taille, size_t capacite, int flags, int aligne, const LISTE* cpus, size_t nb_messages) {
+
+	// Le message porte au moins son heure d'envoi
+	if (taille < sizeof(uint64_t))
+		taille = sizeof(uint64_t);
+
+	MESSAGE* file = m_connexion(NULL, O_RDWR | O_CREAT | moteurs[moteur].options | (aligne ? M_ALIGNE : 0), capacite, taille, 0600, (size_t) 0);
+	if (file == NULL) {
+		perror("m_connexion()");
+		exit(EXIT_FAILURE);
+	}
+
+	// Chaque producteur envoie la même part ; le total peut être un peu inférieur à nb_messages
+	size_t par_producteur = nb_messages / producteurs;
+	size_t total = par_producteur * producteurs;
+
+	size_t taille_resultats = sizeof(RESULTATS) + total * sizeof(uint64_t);
+	RESULTATS* resultats = mmap(NULL, taille_resultats, PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED, -1, 0);
+	if (resultats == MAP_FAILED) {
+		perror("Fonction mmap()");
+		exit(EXIT_FAILURE);
+	}
+
+	pid_t pids[2 * 64]; // au plus 64 producteurs et 64 consommateurs
+	size_t nb_pids = 0, i;
+
+	for (i = 0 ; i < consommateurs ; i++)
+		pids[nb_pids++] = lancer(1, file, resultats, 0, taille, flags, processeur(cpus, producteurs + i));
+	for (i = 0 ; i < producteurs ; i++)
+		pids[nb_pids++] = lancer(0, file, resultats, par_producteur, taille, flags, processeur(cpus, i));
+
+	uint64_t debut = maintenant();
+	atomic_store(&resultats->depart, 1);
+
+	// Attendre les producteurs, puis envoyer un message de fin à chaque consommateur
+	for (i = consommateurs ; i < nb_pids ; i++)
+		waitpid(pids[i], NULL, 0);
+
+	char* fin = calloc(1, taille);
+	struct mon_message message = { 1, fin };
+	for (i = 0 ; i < consommateurs ; i++)
+		while (m_envoi(file, &message, taille, 0) == -1)
+			sched_yield();
+	free(fin);
+
+	for (i = 0 ; i < consommateurs ; i++)
+		waitpid(pids[i], NULL, 0);
+
+	double secondes = (double) (maintenant() - debut) / 1e9;
+
+	size_t n = atomic_load(&resultats->nombre_latences);
+	qsort(resultats->latences, n, sizeof(uint64_t), comparer);
+
+	// Les processeurs de la colonne cpus, séparés par des points-virgules ; "-" si les processus ne sont pas fixés
+	char texte_cpus[NB_MAX_VALEURS * 12] = "-";
+	int c, longueur = 0;
+	for (c = 0 ; c < cpus->nombre ; c++)
+		longueur += snprintf(texte_cpus + longueur, sizeof(texte_cpus) - (size_t) longueur, "%s%zu", c > 0 ? ";" : "", cpus->valeurs[c]);
+
+	printf("%s,%zu,%zu,%zu,%zu,%s,%d,%s,%zu,%.6f,%.0f,%.2f,%llu,%llu,%llu\n",
+	       moteurs[moteur].nom, producteurs, consommateurs, taille, m_capacite(file),
+	       flags == O_NONBLOCK ? "nonbloquant" : "bloquant", aligne, texte_cpus, n, secondes,
+	       (double) n / secondes, (double) n * (double) taille / secondes / 1e6,
+	       (unsigned long long) centile(resultats->latences, n, 0.50),
+	       (unsigned long long) centile(resultats->latences, n, 0.99),
+	       (unsigned long long) centile(resultats->latences, n, 0.999));
+	fflush(stdout);
+
+	munmap(resultats, taille_resultats);
+	m_deconnexion(file);
+	free(file);
+}
+
+/**
+ * Balaye toutes les combinaisons des paramètres et affiche une ligne CSV par mesure.
+ * Les listes se donnent séparées par des virgules, par exemple : ./bench -m mutex,mpmc -p 1,4 -s 64,4096
+ */
+int main(int argc, char* argv[]) {
+	size_t nb_messages = 20000;
+	unsigned masque_moteurs = (1u << NB_MOTEURS) - 1;
+	LISTE producteurs = { { 1, 4 }, 2 };
+	LISTE consommateurs = { { 1, 4 }, 2 };
+	LISTE tailles = { { 16, 1024 }, 2 };
+	LISTE capacites = { { 64, 1024 }, 2 };
+	LISTE modes = { { 0, 1 }, 2 }; // 0 : bloquant, 1 : O_NONBLOCK
+	LISTE alignements = { { 0 }, 1 }; // 0 : places contiguës, 1 : M_ALIGNE
+	LISTE cpus = { { 0 }, 0 }; // vide : les processus ne sont pas fixés
+
+	int option;
+	while ((option = getopt(argc, argv, "n:m:p:c:s:q:b:a:C:")) != -1) {
+		switch (option) {
+			case 'n' : nb_messages = strtoul(optarg, NULL, 10); break;
+			case 'm' : masque_moteurs = lire_moteurs(optarg); break;
+			case 'p' : lire_liste(&producteurs, optarg); break;
+			case 'c' : lire_liste(&consommateurs, optarg); break;
+			case 's' : lire_liste(&tailles, optarg); break;
+			case 'q' : lire_liste(&capacites, optarg); break;
+			case 'b' : lire_liste(&modes, optarg); break;
+			case 'a' : lire_liste(&alignements, optarg); break;
+			case 'C' : lire_liste(&cpus, optarg); break;
+			default :
+				fprintf(stderr, "usage : %s [-n messages] [-m mutex,spsc,mpmc,priorite,octets] [-p producteurs] [-c consommateurs]"
+				                " [-s tailles] [-q capacites] [-b 0,1 (bloquant, O_NONBLOCK)] [-a 0,1 (M_ALIGNE)]"
+				                " [-C cpus (producteurs, puis consommateurs)]\n", argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	// Les processeurs de -C doivent être permis à ce processus : un fils qui ne peut pas s'y fixer ferait échouer la mesure
+	cpu_set_t permis;
+	if (cpus.nombre > 0 && sched_getaffinity(0, sizeof(permis), &permis) == -1) {
+		perror("Fonction sched_getaffinity()");
+		exit(EXIT_FAILURE);
+	}
+	int k;
+	for (k = 0 ; k < cpus.nombre ; k++) {
+		if (cpus.valeurs[k] >= CPU_SETSIZE || ! CPU_ISSET(cpus.valeurs[k], &permis)) {
+			fprintf(stderr, "processeur %zu indisponible\n", cpus.valeurs[k]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	printf("moteur,producteurs,consommateurs,taille,capacite,mode,aligne,cpus,messages,secondes,messages_par_s,mo_par_s,p50_ns,p99_ns,p999_ns\n");
+	fflush(stdout); // sinon les processus fils hériteraient du tampon non vidé
+
+	size_t m;
+	int p, c, s, q, b, a;
+	for (m = 0 ; m < NB_MOTEURS ; m++) {
+		if (! (masque_moteurs & (1u << m)))
+			continue;
+
+		for (p = 0 ; p < producteurs.nombre ; p++)
+		for (c = 0 ; c < consommateurs.nombre ; c++) {
+			size_t nb_p = producteurs.valeurs[p], nb_c = consommateurs.valeurs[c];
+
+			// M_SPSC : exactement un producteur et un consommateur
+			if (nb_p == 0 || nb_c == 0 || nb_p > 64 || nb_c > 64 || (moteurs[m].options == M_SPSC && (nb_p != 1 || nb_c != 1)))
+				continue;
+
+			for (s = 0 ; s < tailles.nombre ; s++)
+			for (q = 0 ; q < capacites.nombre ; q++)
+			for (b = 0 ; b < modes.nombre ; b++)
+			for (a = 0 ; a < alignements.nombre ; a++)
+				mesurer(m, nb_p, nb_c, tailles.valeurs[s], capacites.valeurs[q], modes.valeurs[b] ? O_NONBLOCK : 0,
+				        alignements.valeurs[a] != 0, &cpus, nb_messages);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
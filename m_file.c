@@ -16,51 +16,4306 @@
 #endif
 
 #include <stdio.h> // perror()
-#include <stdlib.h> // malloc(), exit(), atexit(), EXIT_SUCCESS, EXIT_FAILURE
-#include <unistd.h> // ftruncate()
+#include <stdlib.h> // malloc(), qsort(), exit(), EXIT_SUCCESS, EXIT_FAILURE
+#include <stddef.h> // offsetof()
+#include <unistd.h> // ftruncate(), pread()
 #include <fcntl.h> // fcntl : file control ; Objets memoire POSIX : pour les constantes O_
 #include <sys/mman.h> // mmap(), munmap() ; Objets memoire POSIX : pour shm_open()
 #include <sys/stat.h> // fstat(), Pour les constantes droits d’acces
-#include <pthread.h> // pthread_mutexattr_init(), pthread_mutexattr_setpshared(), pthread_mutex_init()
+#include <sys/file.h> // flock() : les connexions aux files durables
+#include <pthread.h> // pthread_mutexattr_init(), pthread_mutexattr_setpshared(), pthread_mutexattr_setrobust(), pthread_mutex_init()
 #include <errno.h> // Pour strerror(), la variable errno
-#include <string.h> // strerror(), memset(), memmove()
+#include <string.h> // strerror(), memset(), memmove(), memcpy()
 #include <stdarg.h> // Pour acceder a la liste des parametres de l’appel de fonctions avec un nombre variable de parametres
 #include <signal.h>
 #include <sys/types.h>
+#include <stdatomic.h> // atomic_load_explicit(), atomic_store_explicit()
+#include <stdalign.h> // alignof
+#include <limits.h> // INT_MAX
+#include <time.h> // clock_gettime() : la durée des attentes
+#include <sched.h> // sched_getcpu(), sched_yield()
+#include <poll.h> // POLLIN, POLLOUT : les événements de m_fd()
+#ifdef __linux__
+#include <sys/syscall.h> // syscall(), SYS_futex
+#include <linux/futex.h> // FUTEX_WAIT, FUTEX_WAIT_BITSET, FUTEX_WAKE, FUTEX_PRIVATE_FLAG
+#endif
 #include "m_file.h"
 
+// Toutes les options propres à m_connexion (les autres bits de options sont transmis à shm_open())
+#define M_OPTIONS (M_MOTEUR_MASQUE | M_ALIGNE | M_FRAGMENTS | M_EXTENSIBLE | M_GRANDES_PAGES | M_PRECHARGE | M_MLOCK)
+
 /**
  * Une implémentation en utilisant la mémoire partagée entre les processus ;
- * L’accès parallèle à la file de messages est possible avec une protection appropriée, avec des mutexes/conditions.
+ * L’accès parallèle à la file de messages est possible avec une protection appropriée, avec des mutexes et des futex.
+ */
+
+
+// Les moteurs M_DIFFUSION et M_DIFFUSION_ABANDON ne diffèrent que par le sort des lecteurs trop lents
+static int moteur_diffusion(int moteur) {
+	return moteur == M_DIFFUSION || moteur == M_DIFFUSION_ABANDON;
+}
+
+// Une taille arrondie à un nombre entier de lignes de cache
+static size_t taille_lignes(size_t taille) {
+	return ( taille + TAILLE_LIGNE_CACHE - 1 ) / TAILLE_LIGNE_CACHE * TAILLE_LIGNE_CACHE;
+}
+
+/**
+ * La place de chaque message (ou enregistrement du moteur M_OCTETS) est un multiple de l'alignement :
+ * le minimum pour qu'un message d'entiers se lise sur place (m_reception_peek), ou pour que chaque en-tête d'enregistrement
+ * reste correctement aligné ; une ligne de cache avec M_ALIGNE.
+ * La zone des messages (ou l'anneau) commence elle-même sur une ligne de cache.
+ */
+static size_t alignement_places(int moteur, int options) {
+	if (options & M_ALIGNE)
+		return TAILLE_LIGNE_CACHE;
+
+	return moteur == M_OCTETS ? sizeof(ENREGISTREMENT) : alignof(uint64_t);
+}
+
+/**
+ * Les messages de la zone des messages ont tous la même place : longueur_maximale_message octets (un au moins, pour que
+ * chaque place ait sa propre adresse), arrondie à un multiple de alignement.
+ */
+static size_t taille_place(size_t len_max, size_t alignement) {
+	size_t taille = len_max > 0 ? len_max : 1;
+
+	return ( taille + alignement - 1 ) / alignement * alignement;
+}
+
+// Le tableau des descripteurs (FILE_ELEMENT), prévu pour capacite_maximale éléments : la zone des messages commence après
+static size_t taille_descripteurs(size_t capacite_maximale) {
+	return taille_lignes(capacite_maximale * sizeof(FILE_ELEMENT));
+}
+
+// La plus petite puissance de 2 supérieure ou égale à n (les indices des moteurs sans verrou sont des masques)
+static size_t puissance_de_deux(size_t n) {
+	size_t p = 1;
+	while (p < n)
+		p <<= 1;
+
+	return p;
+}
+
+// Les moteurs M_MUTEX et M_PRIORITE indexent les messages par type : au moins deux entrées par message pour que les sondages restent courts
+static size_t taille_index_types(int moteur, size_t nb_msg) {
+	if (moteur != M_MUTEX && moteur != M_PRIORITE)
+		return 0;
+
+	return puissance_de_deux(2 * nb_msg);
+}
+
+/**
+ * Moteurs M_MUTEX et M_PRIORITE : la place de l'index des types et du tas, prévus pour capacite_maximale messages.
+ * Ils sont placés avant les descripteurs, eux aussi prévus pour capacite_maximale, puis vient la zone des messages, qui finit
+ * l'objet mémoire : m_redimensionner n'a qu'à changer sa taille.
+ */
+static size_t taille_avant_tableau(int moteur, size_t capacite_maximale) {
+	size_t taille = taille_index_types(moteur, capacite_maximale) * sizeof(INDEX_TYPE);
+
+	if (moteur == M_PRIORITE)
+		taille += capacite_maximale * sizeof(int);
+
+	return taille_lignes(taille);
+}
+
+/**
+ * La taille de l'objet mémoire qui contient une file de nb_msg messages de len_max octets au plus :
+ * l'en-tête, l'index des types et le tas (selon le moteur), les descripteurs (tous trois pour capacite_maximale messages),
+ * puis la zone des messages, qui finit l'objet mémoire.
+ * Le moteur M_OCTETS n'a, après l'en-tête, que son anneau de taille_anneau octets.
+ * Les moteurs M_DIFFUSION ont, après la zone des messages, les NB_LECTEURS lecteurs, sur leurs propres lignes de cache.
+ */
+static size_t taille_segment(int moteur, size_t nb_msg, size_t capacite_maximale, size_t len_max, size_t taille_anneau, size_t alignement) {
+	if (moteur == M_OCTETS)
+		return sizeof(FILE_DE_MESSAGES) + taille_anneau;
+
+	size_t taille = sizeof(FILE_DE_MESSAGES) + taille_avant_tableau(moteur, capacite_maximale) + taille_descripteurs(capacite_maximale);
+
+	if (moteur_diffusion(moteur))
+		return taille + taille_lignes(nb_msg * taille_place(len_max, alignement)) + NB_LECTEURS * sizeof(LECTEUR_DIFFUSION);
+
+	return taille + ( nb_msg * taille_place(len_max, alignement) );
+}
+
+// La taille de l'objet mémoire à la capacité actuelle de la file
+static size_t taille_utilisee(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return taille_segment(ptr_file_de_messages->moteur, ptr_file_de_messages->capacite, ptr_file_de_messages->capacite_maximale,
+	                      ptr_file_de_messages->longueur_maximale_message, ptr_file_de_messages->octets.taille_anneau,
+	                      ptr_file_de_messages->alignement);
+}
+
+// La taille des grandes pages (Hugepagesize de /proc/meminfo) ; 2 Mo si elle est illisible
+static size_t taille_grande_page(void) {
+	size_t taille = 2048;
+	char ligne[128];
+
+	FILE* meminfo = fopen("/proc/meminfo", "r");
+	if (meminfo == NULL)
+		return taille * 1024;
+
+	while (fgets(ligne, sizeof(ligne), meminfo) != NULL)
+		if (sscanf(ligne, "Hugepagesize: %zu kB", &taille) == 1)
+			break;
+	fclose(meminfo);
+
+	return taille * 1024;
+}
+
+// Touche chaque page de la projection, en lecture seulement : d'autres processus utilisent peut-être déjà la file
+static void toucher_pages(void* adresse, size_t taille) {
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	for (i = 0 ; i < taille ; i += page)
+		(void) *(volatile char *) ( (char *) adresse + i );
+}
+
+/**
+ * Projette l'objet mémoire de la file (descripteur, ou -1 pour une file anonyme) selon les options de projection.
+ * *taille est la place réservée (cf. m_redimensionner) ; elle devient la taille projetée, arrondie à une grande page avec MAP_HUGETLB.
+ * Seuls les taille_utile premiers octets existent : M_PRECHARGE et M_MLOCK ne concernent qu'eux, la suite est
+ * projetée sans être comptée dans la mémoire engagée (MAP_NORESERVE).
+ * M_GRANDES_PAGES : une file anonyme essaie d'abord MAP_HUGETLB (il faut des grandes pages réservées, cf. vm.nr_hugepages) ;
+ * sinon, comme pour un objet de shm_open() (tmpfs, où MAP_HUGETLB n'existe pas), madvise(MADV_HUGEPAGE) demande
+ * des grandes pages transparentes, et le noyau garde des pages normales s'il ne peut pas.
+ * Retourne MAP_FAILED en cas d'échec (errno : celui de mmap ou de mlock).
+ */
+static void* projeter(int descripteur, size_t* taille, size_t taille_utile, int protect, int options) {
+	int drapeaux = descripteur == -1 ? MAP_ANON | MAP_SHARED : MAP_SHARED;
+	void* adresse = MAP_FAILED;
+
+	if (*taille > taille_utile)
+		drapeaux |= MAP_NORESERVE;
+
+	// Une file anonyme M_GRANDES_PAGES ne peut pas grandir (cf. m_connexion) : toute la place est utile
+	if ( (options & M_GRANDES_PAGES) && descripteur == -1 ) {
+		size_t grande_page = taille_grande_page();
+		size_t taille_arrondie = ( *taille + grande_page - 1 ) / grande_page * grande_page;
+
+		// void * mmap (void *address, size_t length,int protect, int flags, int filedes, off_t offset)
+		adresse = mmap(NULL, taille_arrondie, protect, drapeaux | MAP_HUGETLB | ( (options & M_PRECHARGE) ? MAP_POPULATE : 0 ), -1, 0);
+		if (adresse != MAP_FAILED)
+			*taille = taille_utile = taille_arrondie;
+	}
+
+	if (adresse == MAP_FAILED) {
+		// Avec des grandes pages transparentes, les pages sont touchées après madvise() : MAP_POPULATE prendrait des pages normales ;
+		// MAP_POPULATE toucherait aussi la place réservée au-delà de la fin de l'objet mémoire
+		int precharge = (options & M_PRECHARGE) && ! (options & M_GRANDES_PAGES) && *taille == taille_utile;
+
+		adresse = mmap(NULL, *taille, protect, drapeaux | ( precharge ? MAP_POPULATE : 0 ), descripteur, 0);
+		if (adresse == MAP_FAILED)
+			return MAP_FAILED;
+
+		if (options & M_GRANDES_PAGES) {
+			// int madvise(void *addr, size_t length, int advice) ; EINVAL si le noyau n'a pas les grandes pages transparentes
+			madvise(adresse, *taille, MADV_HUGEPAGE);
+		}
+
+		if ( (options & M_PRECHARGE) && ! precharge )
+			toucher_pages(adresse, taille_utile);
+	}
+
+	// int mlock(const void *addr, size_t len) : EPERM ou ENOMEM au-delà de RLIMIT_MEMLOCK
+	if ( (options & M_MLOCK) && mlock(adresse, taille_utile) == -1 ) {
+		int errno_mlock = errno;
+		munmap(adresse, *taille);
+		errno = errno_mlock;
+		return MAP_FAILED;
+	}
+
+	return adresse;
+}
+
+/**
+ * Le début du tableau des descripteurs (ou de l'anneau du moteur M_OCTETS), calculé à partir de l'en-tête :
+ * la mémoire partagée ne contient aucune adresse, chaque processus (et chaque projection) a la sienne.
+ */
+static char* debut_tableau(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return (char *) (ptr_file_de_messages + 1) + ptr_file_de_messages->decalage_tableau;
+}
+
+// Le début de la zone des messages, après les descripteurs
+static char* debut_messages(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return (char *) (ptr_file_de_messages + 1) + ptr_file_de_messages->decalage_messages;
+}
+
+// L'élément d'indice index du tableau circulaire (son descripteur)
+static FILE_ELEMENT* element_file(FILE_DE_MESSAGES* ptr_file_de_messages, size_t index) {
+	return (FILE_ELEMENT *) debut_tableau(ptr_file_de_messages) + index;
+}
+
+// L'indice d'un élément dans le tableau circulaire
+static int index_element(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	return (int) ( element - (FILE_ELEMENT *) debut_tableau(ptr_file_de_messages) );
+}
+
+// La place du message de l'élément d'indice index, dans la zone des messages
+static char* place_message(FILE_DE_MESSAGES* ptr_file_de_messages, size_t index) {
+	return debut_messages(ptr_file_de_messages) + index * ptr_file_de_messages->taille_place;
+}
+
+// La place du message de l'élément (au même indice que son descripteur)
+static char* message_element(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	return place_message(ptr_file_de_messages, (size_t) index_element(ptr_file_de_messages, element));
+}
+
+// Les lecteurs des moteurs M_DIFFUSION, sur la première ligne de cache après la zone des messages
+static LECTEUR_DIFFUSION* lecteurs_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	size_t taille_zone = ptr_file_de_messages->capacite * ptr_file_de_messages->taille_place;
+
+	return (LECTEUR_DIFFUSION *) ( debut_messages(ptr_file_de_messages) + taille_lignes(taille_zone) );
+}
+
+/* Les fragments d'une file M_FRAGMENTS */
+
+// Le fragment i : une file complète (en-tête compris), placée après l'en-tête de la file
+static FILE_DE_MESSAGES* fragment(FILE_DE_MESSAGES* ptr_file_de_messages, size_t i) {
+	return (FILE_DE_MESSAGES *) ( (char *) (ptr_file_de_messages + 1) + ( i * ptr_file_de_messages->taille_fragment ) );
+}
+
+/**
+ * Le fragment des messages de ce type. Même hachage que l'index des types, mais avec d'autres bits : les types d'un même
+ * fragment restent dispersés dans l'index des types de ce fragment.
+ */
+static size_t fragment_du_type(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+	uint64_t h = (uint64_t) type * 0x9E3779B97F4A7C15ULL;
+
+	return (size_t) ( (h >> 40) % ptr_file_de_messages->nombre_fragments );
+}
+
+/* L'index des types du moteur M_MUTEX */
+
+// L'index des types est placé juste après l'en-tête, avant le tableau circulaire
+static INDEX_TYPE* index_types(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return (INDEX_TYPE *) (ptr_file_de_messages + 1);
+}
+
+// La position de départ de type dans l'index (hachage multiplicatif : les pid consécutifs sont bien dispersés)
+static size_t hachage_type(long type, size_t taille_index_types) {
+	uint64_t h = (uint64_t) type * 0x9E3779B97F4A7C15ULL;
+
+	return (size_t) (h ^ (h >> 32)) & (taille_index_types - 1);
+}
+
+// L'entrée de l'index pour type, ou l'entrée libre où il faudrait l'ajouter
+static INDEX_TYPE* chercher_type(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+	INDEX_TYPE* index = index_types(ptr_file_de_messages);
+	size_t masque = ptr_file_de_messages->taille_index_types - 1;
+	size_t i = hachage_type(type, ptr_file_de_messages->taille_index_types);
+
+	// L'index contient au moins deux fois plus d'entrées que de messages : il y a toujours une entrée libre
+	while (index[i].premier != -1 && index[i].type != type)
+		i = (i + 1) & masque;
+
+	return &index[i];
+}
+
+/**
+ * Retire une entrée de l'index sans laisser de trou dans les suites de sondage :
+ * les entrées suivantes qui ne sont pas à leur place de départ sont reculées (suppression par décalage arrière).
+ */
+static void supprimer_type(FILE_DE_MESSAGES* ptr_file_de_messages, INDEX_TYPE* entree) {
+	INDEX_TYPE* index = index_types(ptr_file_de_messages);
+	size_t masque = ptr_file_de_messages->taille_index_types - 1;
+	size_t i = entree - index;
+	size_t j = i;
+
+	for (;;) {
+		j = (j + 1) & masque;
+		if (index[j].premier == -1)
+			break;
+
+		// k, la place de départ de l'entrée j : si k est dans ]i, j], l'entrée j ne peut pas reculer en i
+		size_t k = hachage_type(index[j].type, ptr_file_de_messages->taille_index_types);
+		if ( (i <= j) ? (i < k && k <= j) : (i < k || k <= j) )
+			continue;
+
+		index[i] = index[j];
+		i = j;
+	}
+
+	index[i].premier = -1;
+}
+
+/* Le tas du moteur M_PRIORITE : un tas binaire d'indices d'éléments, le plus petit type à la racine */
+
+// Le tas est placé juste après l'index des types, à sa taille maximale : ni l'un ni l'autre ne bouge quand la file change de taille
+static int* tas_priorite(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return (int *) ( index_types(ptr_file_de_messages) + taille_index_types(ptr_file_de_messages->moteur, ptr_file_de_messages->capacite_maximale) );
+}
+
+// Vrai si l'élément a doit être lu avant l'élément b : le plus petit type d'abord, puis l'ordre d'arrivée
+static int precede(FILE_DE_MESSAGES* ptr_file_de_messages, int a, int b) {
+	FILE_ELEMENT* element_a = element_file(ptr_file_de_messages, a);
+	FILE_ELEMENT* element_b = element_file(ptr_file_de_messages, b);
+
+	if (element_a->type != element_b->type)
+		return element_a->type < element_b->type;
+
+	return element_a->numero_ordre < element_b->numero_ordre;
+}
+
+static void placer_dans_tas(FILE_DE_MESSAGES* ptr_file_de_messages, size_t position, int index_element) {
+	tas_priorite(ptr_file_de_messages)[position] = index_element;
+	element_file(ptr_file_de_messages, index_element)->position_tas = position;
+}
+
+// Fait remonter l'élément de la place position tant qu'il précède son parent
+static void remonter_dans_tas(FILE_DE_MESSAGES* ptr_file_de_messages, size_t position) {
+	int* tas = tas_priorite(ptr_file_de_messages);
+	int index_element = tas[position];
+
+	while (position > 0 && precede(ptr_file_de_messages, index_element, tas[(position - 1) / 2])) {
+		placer_dans_tas(ptr_file_de_messages, position, tas[(position - 1) / 2]);
+		position = (position - 1) / 2;
+	}
+
+	placer_dans_tas(ptr_file_de_messages, position, index_element);
+}
+
+// Fait descendre l'élément de la place position tant qu'un de ses enfants le précède
+static void descendre_dans_tas(FILE_DE_MESSAGES* ptr_file_de_messages, size_t position) {
+	int* tas = tas_priorite(ptr_file_de_messages);
+	int index_element = tas[position];
+	size_t n = ptr_file_de_messages->taille_tas;
+
+	for (;;) {
+		size_t enfant = 2 * position + 1;
+		if (enfant >= n)
+			break;
+
+		if (enfant + 1 < n && precede(ptr_file_de_messages, tas[enfant + 1], tas[enfant]))
+			enfant++;
+
+		if (! precede(ptr_file_de_messages, tas[enfant], index_element))
+			break;
+
+		placer_dans_tas(ptr_file_de_messages, position, tas[enfant]);
+		position = enfant;
+	}
+
+	placer_dans_tas(ptr_file_de_messages, position, index_element);
+}
+
+static void inserer_dans_tas(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	size_t position = ptr_file_de_messages->taille_tas++;
+
+	placer_dans_tas(ptr_file_de_messages, position, index_element);
+	remonter_dans_tas(ptr_file_de_messages, position);
+}
+
+// Retire un élément quelconque du tas (pas seulement la racine : une lecture avec type >= 0 peut le choisir)
+static void retirer_du_tas(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	size_t position = element_file(ptr_file_de_messages, index_element)->position_tas;
+	size_t derniere = --ptr_file_de_messages->taille_tas;
+
+	if (position == derniere)
+		return;
+
+	// Le dernier élément du tas prend la place libérée, puis remonte ou descend
+	int* tas = tas_priorite(ptr_file_de_messages);
+	placer_dans_tas(ptr_file_de_messages, position, tas[derniere]);
+
+	if (position > 0 && precede(ptr_file_de_messages, tas[position], tas[(position - 1) / 2]))
+		remonter_dans_tas(ptr_file_de_messages, position);
+	else
+		descendre_dans_tas(ptr_file_de_messages, position);
+}
+
+// Ajoute l'élément index_element à la fin de la file et à la fin de la liste de son type
+static void lier_element(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_element);
+
+	element->suivant = -1;
+	element->precedent = ptr_file_de_messages->last;
+	element->suivant_meme_type = -1;
+	element->numero_ordre = ptr_file_de_messages->numero_ordre_suivant++;
+
+	if (ptr_file_de_messages->last == -1)
+		ptr_file_de_messages->first = index_element;
+	else
+		element_file(ptr_file_de_messages, ptr_file_de_messages->last)->suivant = index_element;
+	ptr_file_de_messages->last = index_element;
+
+	INDEX_TYPE* entree = chercher_type(ptr_file_de_messages, element->type);
+	if (entree->premier == -1) { // Le premier message de ce type dans la file
+		entree->type = element->type;
+		entree->premier = index_element;
+	} else {
+		element_file(ptr_file_de_messages, entree->dernier)->suivant_meme_type = index_element;
+	}
+	entree->dernier = index_element;
+
+	if (ptr_file_de_messages->moteur == M_PRIORITE)
+		inserer_dans_tas(ptr_file_de_messages, index_element);
+}
+
+/**
+ * Retire l'élément index_element de la file et de la liste de son type.
+ * L'élément doit être le premier message de son type, ce qui est toujours le cas de ceux que choisir_element() retourne.
+ */
+static void delier_element(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_element);
+
+	if (element->precedent == -1)
+		ptr_file_de_messages->first = element->suivant;
+	else
+		element_file(ptr_file_de_messages, element->precedent)->suivant = element->suivant;
+
+	if (element->suivant == -1)
+		ptr_file_de_messages->last = element->precedent;
+	else
+		element_file(ptr_file_de_messages, element->suivant)->precedent = element->precedent;
+
+	INDEX_TYPE* entree = chercher_type(ptr_file_de_messages, element->type);
+	entree->premier = element->suivant_meme_type;
+	if (entree->premier == -1) // C'était le dernier message de ce type
+		supprimer_type(ptr_file_de_messages, entree);
+
+	if (ptr_file_de_messages->moteur == M_PRIORITE)
+		retirer_du_tas(ptr_file_de_messages, index_element);
+}
+
+/**
+ * L'indice du message que m_reception doit lire pour la demande type, ou -1 s'il n'y en a pas :
+ * type == 0 : le premier message de la file ;
+ * type > 0 : le premier message de la liste de ce type ;
+ * type < 0 : le premier message du plus petit type inférieur ou égal à |type|.
+ * Pour type < 0, le moteur M_PRIORITE regarde la racine du tas ; le moteur M_MUTEX parcourt l'index
+ * (les types présents, pas les messages).
+ */
+static int choisir_element(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+	if (type == 0)
+		return ptr_file_de_messages->first;
+
+	if (type > 0)
+		return chercher_type(ptr_file_de_messages, type)->premier;
+
+	if (ptr_file_de_messages->moteur == M_PRIORITE) {
+		if (ptr_file_de_messages->taille_tas == 0)
+			return -1;
+
+		int racine = tas_priorite(ptr_file_de_messages)[0];
+		return element_file(ptr_file_de_messages, racine)->type <= -type ? racine : -1;
+	}
+
+	INDEX_TYPE* index = index_types(ptr_file_de_messages);
+	int index_element = -1;
+	size_t i;
+	for (i = 0 ; i < ptr_file_de_messages->taille_index_types ; i++) {
+		if (index[i].premier != -1 && index[i].type <= -type
+		    && (index_element == -1 || index[i].type < element_file(ptr_file_de_messages, index_element)->type))
+			index_element = index[i].premier;
+	}
+
+	return index_element;
+}
+
+// Le canal sur lequel attend une lecture de ce type
+static CANAL_ATTENTE* canal_reception(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+	if (type == 0)
+		return &(ptr_file_de_messages->attente_file_vide);
+
+	if (type > 0)
+		return &(ptr_file_de_messages->attente_type[hachage_type(type, NB_CANAUX_TYPE)]);
+
+	return &(ptr_file_de_messages->attente_priorite);
+}
+
+/*
+ * Les statistiques : chaque processus incrémente la ligne de compteurs de son processeur, sans verrou et sans ordre
+ * mémoire particulier ; m_stats() additionne les lignes. Les durées ne sont mesurées que lorsqu'un processus attend.
+ */
+
+// La ligne de compteurs du processeur sur lequel tourne le processus
+static STATISTIQUES_LIGNE* ligne_statistiques(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int processeur = 0;
+#ifdef __linux__
+	// int sched_getcpu(void) : sans appel système (rseq ou vDSO)
+	processeur = sched_getcpu();
+	if (processeur < 0)
+		processeur = 0;
+#endif
+
+	return &ptr_file_de_messages->statistiques.lignes[processeur % NB_LIGNES_STATISTIQUES];
+}
+
+// L'heure, en nanosecondes, pour mesurer la durée des attentes
+static uint64_t horloge(void) {
+	struct timespec t;
+
+	// int clock_gettime(clockid_t clockid, struct timespec *tp);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (uint64_t) t.tv_sec * 1000000000u + (uint64_t) t.tv_nsec;
+}
+
+/*
+ * Les échéances et les durées de vie. m_envoi_timeout() et m_reception_timeout() posent l'échéance du thread le temps
+ * de l'appel : futex_attendre() ne dort pas au-delà, et chaque boucle d'attente échoue alors avec ETIMEDOUT.
+ * m_envoi_ttl() pose de même la durée de vie des messages qu'il publie.
+ */
+static _Thread_local const struct timespec* echeance_attente = NULL; // NULL : attendre sans limite
+static _Thread_local uint64_t duree_vie_envoi = 0; // en nanosecondes ; 0 : les messages envoyés ne périment pas
+
+// 1 si l'échéance de l'appel en cours est passée (errno prend alors la valeur ETIMEDOUT), 0 sinon
+static int echeance_depassee(void) {
+	if (echeance_attente == NULL)
+		return 0;
+
+	if (horloge() < (uint64_t) echeance_attente->tv_sec * 1000000000u + (uint64_t) echeance_attente->tv_nsec)
+		return 0;
+
+	errno = ETIMEDOUT;
+	return 1;
+}
+
+// L'heure de péremption d'un message publié maintenant (cf. FILE_ELEMENT::peremption)
+static uint64_t peremption_envoi(void) {
+	return duree_vie_envoi == 0 ? 0 : horloge() + duree_vie_envoi;
+}
+
+// 1 si le message de l'élément est périmé : la lecture le jette et passe au suivant. L'horloge n'est lue que pour les messages qui périment.
+static int element_perime(const FILE_ELEMENT* element) {
+	return element->peremption != 0 && element->peremption <= horloge();
+}
+
+/*
+ * Les messages en plusieurs morceaux. m_envoiv() et m_receptionv() posent de même les morceaux du thread le temps de l'appel :
+ * la copie d'un message dans sa place (ou hors de sa place) les parcourt au lieu de l'adresse unique de m_envoi() ou m_reception().
+ */
+static _Thread_local const struct iovec* morceaux_envoi = NULL; // NULL : le message est à l'adresse mtext
+static _Thread_local int nombre_morceaux_envoi = 0;
+static _Thread_local const struct iovec* morceaux_reception = NULL; // NULL : le message est copié à l'adresse msg
+static _Thread_local int nombre_morceaux_reception = 0;
+
+// Copie le message de len octets à envoyer, d'adresse mtext (ou dans les morceaux de m_envoiv), dans sa place
+static void copier_envoi(void* place, const void* mtext, size_t len) {
+	if (morceaux_envoi == NULL) {
+		//void * memmove (void *to, const void *from, size_t size)
+		memmove(place, mtext, len);
+		return;
+	}
+
+	// La somme des longueurs des morceaux est len (cf. m_envoiv)
+	char* destination = (char *) place;
+	int i;
+	for (i = 0 ; i < nombre_morceaux_envoi ; i++) {
+		// void * memcpy (void *restrict to, const void *restrict from, size_t size)
+		memcpy(destination, morceaux_envoi[i].iov_base, morceaux_envoi[i].iov_len);
+		destination += morceaux_envoi[i].iov_len;
+	}
+}
+
+// Copie le message lu de len octets, depuis sa place, à l'adresse msg (ou dans les morceaux de m_receptionv, l'un après l'autre)
+static void copier_reception(void* msg, const void* place, size_t len) {
+	if (morceaux_reception == NULL) {
+		// void * memmove (void *to, const void *from, size_t size)
+		memmove(msg, place, len);
+		return;
+	}
+
+	const char* source = (const char *) place;
+	int i;
+	for (i = 0 ; i < nombre_morceaux_reception && len > 0 ; i++) {
+		size_t morceau = morceaux_reception[i].iov_len < len ? morceaux_reception[i].iov_len : len;
+		memcpy(morceaux_reception[i].iov_base, source, morceau);
+		source += morceau;
+		len -= morceau;
+	}
+}
+
+/*
+ * Les messages hors ligne (cf. m_hors_ligne). Un message plus long que longueur_maximale_message est écrit dans son propre
+ * objet mémoire (shm_open) ; sa place ne contient que sa poignée, et longueur_message sa vraie longueur, ce qui le distingue
+ * d'un message ordinaire. La place n'est tenue que le temps de copier la poignée : l'objet est rempli avant, et lu après,
+ * hors du mutex. Le processus qui retire le message supprime l'objet (shm_unlink) dès qu'il l'a ouvert ; ses projections
+ * le gardent jusqu'à munmap(). Un message périmé le supprime sans l'ouvrir.
+ */
+
+static _Atomic uint64_t numero_hors_ligne = 0; // le numéro du prochain objet hors ligne de ce processus
+
+// Vrai si le message de l'élément est hors ligne : sa place ne contient que sa poignée
+static int element_hors_ligne(FILE_DE_MESSAGES* ptr_file_de_messages, const FILE_ELEMENT* element) {
+	return (size_t) element->longueur_message > ptr_file_de_messages->longueur_maximale_message;
+}
+
+// Le nom de l'objet mémoire d'un message hors ligne (taille octets au plus)
+static void nom_hors_ligne(char* nom, size_t taille, const POIGNEE_HORS_LIGNE* poignee) {
+	snprintf(nom, taille, "/m_file.hors_ligne.%lld.%llu", (long long) poignee->pid, (unsigned long long) poignee->numero);
+}
+
+// Supprime l'objet mémoire d'un message hors ligne ; ses projections restent valides
+static void supprimer_hors_ligne(const POIGNEE_HORS_LIGNE* poignee) {
+	char nom[64];
+
+	nom_hors_ligne(nom, sizeof(nom), poignee);
+	shm_unlink(nom);
+}
+
+/**
+ * Crée l'objet mémoire d'un message hors ligne de len octets, avec les droits mode, et le projette en lecture et écriture.
+ * Retourne l'adresse de la projection (la poignée de l'objet est écrite dans *poignee), ou NULL (errno de shm_open, ftruncate ou mmap).
+ */
+static void* creer_hors_ligne(size_t len, mode_t mode, POIGNEE_HORS_LIGNE* poignee) {
+	char nom[64];
+	int descripteur;
+
+	poignee->pid = getpid();
+	do {
+		// Un objet jamais lu d'un ancien processus de même pid garde son nom : le numéro suivant
+		poignee->numero = atomic_fetch_add_explicit(&numero_hors_ligne, 1, memory_order_relaxed);
+		nom_hors_ligne(nom, sizeof(nom), poignee);
+		descripteur = shm_open(nom, O_RDWR | O_CREAT | O_EXCL, mode);
+	} while (descripteur == -1 && errno == EEXIST);
+	if (descripteur == -1)
+		return NULL; // échec
+
+	void* adresse = MAP_FAILED;
+	if (ftruncate(descripteur, (off_t) len) == 0)
+		adresse = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, descripteur, 0);
+
+	int erreur = errno;
+	close(descripteur);
+	if (adresse == MAP_FAILED) {
+		shm_unlink(nom);
+		errno = erreur;
+		return NULL; // échec
+	}
+
+	return adresse;
+}
+
+/**
+ * Ouvre l'objet mémoire d'un message hors ligne de len octets, le supprime aussitôt et le projette en lecture.
+ * Retourne l'adresse de la projection, ou NULL (errno de shm_open ou de mmap) : le message est alors perdu.
+ */
+static void* ouvrir_hors_ligne(const POIGNEE_HORS_LIGNE* poignee, size_t len) {
+	char nom[64];
+
+	nom_hors_ligne(nom, sizeof(nom), poignee);
+	int descripteur = shm_open(nom, O_RDONLY, 0);
+	if (descripteur == -1)
+		return NULL; // échec
+	shm_unlink(nom);
+
+	void* adresse = mmap(NULL, len, PROT_READ, MAP_SHARED, descripteur, 0);
+	int erreur = errno;
+	close(descripteur);
+	if (adresse == MAP_FAILED) {
+		errno = erreur;
+		return NULL; // échec
+	}
+
+	return adresse;
+}
+
+// Copie le message de len octets dans sa place ; un message hors ligne, déjà écrit dans son objet mémoire, n'y met que sa poignée
+static void ecrire_place(FILE_DE_MESSAGES* ptr_file_de_messages, void* place, const void* mtext, size_t len, const POIGNEE_HORS_LIGNE* poignee) {
+	if (len > ptr_file_de_messages->longueur_maximale_message)
+		memcpy(place, poignee, sizeof(POIGNEE_HORS_LIGNE));
+	else
+		copier_envoi(place, mtext, len);
+}
+
+// Copie le message de l'élément à l'adresse msg ; d'un message hors ligne, seulement sa poignée, à l'adresse poignee (cf. recevoir_hors_ligne)
+static void lire_place(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element, void* msg, void* poignee) {
+	if (element_hors_ligne(ptr_file_de_messages, element))
+		memcpy(poignee, message_element(ptr_file_de_messages, element), sizeof(POIGNEE_HORS_LIGNE));
+	else
+		copier_reception(msg, message_element(ptr_file_de_messages, element), (size_t) element->longueur_message);
+}
+
+/**
+ * Copie le message hors ligne de len octets à l'adresse msg (ou dans les morceaux de m_receptionv), depuis son objet mémoire.
+ * Retourne 0, ou -1 (errno de shm_open ou de mmap) : le message est perdu.
+ */
+static int recevoir_hors_ligne(const POIGNEE_HORS_LIGNE* poignee, void* msg, size_t len) {
+	void* adresse = ouvrir_hors_ligne(poignee, len);
+	if (adresse == NULL)
+		return -1; // échec
+
+	copier_reception(msg, adresse, len);
+	munmap(adresse, len);
+	return 0;
+}
+
+// Message périmé, jeté sans être lu : l'objet mémoire d'un message hors ligne est supprimé avec lui
+static void jeter_hors_ligne(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	POIGNEE_HORS_LIGNE poignee;
+
+	if (! element_hors_ligne(ptr_file_de_messages, element))
+		return;
+
+	memcpy(&poignee, message_element(ptr_file_de_messages, element), sizeof(poignee));
+	supprimer_hors_ligne(&poignee);
+}
+
+/*
+ * Les projections hors ligne de ce processus, entre m_envoi_reserve() et m_envoi_commit(), ou entre m_reception_peek()
+ * et m_reception_release() : l'adresse donnée à l'appelant n'est pas dans la file, la liste retrouve la place du message.
  */
+typedef struct projection_hors_ligne {
+	void* adresse; // la projection de l'objet mémoire
+	size_t taille;
+	void* place; // la place du message dans la file, qui contient la poignée
+	int envoi; // 1 : m_envoi_reserve() ; 0 : m_reception_peek()
+	struct projection_hors_ligne* suivante;
+} PROJECTION_HORS_LIGNE ;
+
+static PROJECTION_HORS_LIGNE* projections_hors_ligne = NULL;
+static pthread_mutex_t mutex_projections = PTHREAD_MUTEX_INITIALIZER;
+
+// Ajoute une projection à la liste ; retourne la projection, ou NULL (errno == ENOMEM)
+static PROJECTION_HORS_LIGNE* retenir_projection(void* adresse, size_t taille, void* place, int envoi) {
+	PROJECTION_HORS_LIGNE* projection = (PROJECTION_HORS_LIGNE *) malloc(sizeof(PROJECTION_HORS_LIGNE));
+	if (projection == NULL) {
+		errno = ENOMEM;
+		return NULL; // échec
+	}
+
+	projection->adresse = adresse;
+	projection->taille = taille;
+	projection->place = place;
+	projection->envoi = envoi;
+
+	pthread_mutex_lock(&mutex_projections);
+	projection->suivante = projections_hors_ligne;
+	projections_hors_ligne = projection;
+	pthread_mutex_unlock(&mutex_projections);
+
+	return projection;
+}
+
+// La projection d'adresse adresse, de la sorte envoi ; NULL si adresse n'en est pas une
+static PROJECTION_HORS_LIGNE* chercher_projection(const void* adresse, int envoi) {
+	PROJECTION_HORS_LIGNE* projection;
+
+	pthread_mutex_lock(&mutex_projections);
+	for (projection = projections_hors_ligne ; projection != NULL ; projection = projection->suivante)
+		if (projection->adresse == adresse && projection->envoi == envoi)
+			break;
+	pthread_mutex_unlock(&mutex_projections);
+
+	return projection;
+}
+
+// Retire la projection de la liste, et la défait
+static void oublier_projection(PROJECTION_HORS_LIGNE* projection) {
+	PROJECTION_HORS_LIGNE** suivante;
+
+	pthread_mutex_lock(&mutex_projections);
+	for (suivante = &projections_hors_ligne ; *suivante != projection ; suivante = &(*suivante)->suivante)
+		;
+	*suivante = projection->suivante;
+	pthread_mutex_unlock(&mutex_projections);
+
+	munmap(projection->adresse, projection->taille);
+	free(projection);
+}
+
+// Le nombre de messages dans la file, sans prendre le mutex (cf. m_nb)
+static size_t nombre_messages(FILE_DE_MESSAGES* ptr_file_de_messages) {
+
+	// M_FRAGMENTS : la somme des fragments
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		size_t i, nombre = 0;
+		for (i = 0 ; i < ptr_file_de_messages->nombre_fragments ; i++)
+			nombre += nombre_messages(fragment(ptr_file_de_messages, i));
+		return nombre;
+	}
+
+	if (ptr_file_de_messages->moteur == M_SPSC) {
+		// Lire tete avant queue : queue ne peut alors pas être plus ancienne que tete
+		uint32_t tete = atomic_load_explicit(&ptr_file_de_messages->spsc.tete, memory_order_acquire);
+		return (uint32_t) ( atomic_load_explicit(&ptr_file_de_messages->spsc.queue, memory_order_acquire) - tete );
+	}
+
+	if (ptr_file_de_messages->moteur == M_MPMC || moteur_diffusion(ptr_file_de_messages->moteur)) {
+		// Une valeur approchée : les positions réservées mais pas encore publiées ou libérées sont comptées
+		// (moteurs M_DIFFUSION : les messages pas encore lus par le lecteur le plus lent, à la dernière vérification)
+		uint32_t tete = atomic_load_explicit(&ptr_file_de_messages->mpmc.tete, memory_order_acquire);
+		size_t nombre = (uint32_t) ( atomic_load_explicit(&ptr_file_de_messages->mpmc.queue, memory_order_acquire) - tete );
+		return nombre < ptr_file_de_messages->capacite ? nombre : ptr_file_de_messages->capacite;
+	}
+
+	return ptr_file_de_messages->nombre_elements_remplis;
+}
+
+// Compte nombre messages envoyés (octets en tout), puis met à jour l'occupation maximale
+static void compter_envois(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre, size_t octets) {
+	STATISTIQUES_LIGNE* ligne = ligne_statistiques(ptr_file_de_messages);
+
+	atomic_fetch_add_explicit(&ligne->envois, nombre, memory_order_relaxed);
+	atomic_fetch_add_explicit(&ligne->octets_envoyes, octets, memory_order_relaxed);
+
+	// La ligne de l'occupation maximale n'est écrite que lorsque le maximum augmente
+	_Atomic size_t* maximum = &ptr_file_de_messages->statistiques.occupation_maximale;
+	size_t occupation = nombre_messages(ptr_file_de_messages);
+	size_t precedent = atomic_load_explicit(maximum, memory_order_relaxed);
+	while (occupation > precedent
+	       && ! atomic_compare_exchange_weak_explicit(maximum, &precedent, occupation, memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+// Compte nombre messages lus (octets en tout)
+static void compter_receptions(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre, size_t octets) {
+	STATISTIQUES_LIGNE* ligne = ligne_statistiques(ptr_file_de_messages);
+
+	atomic_fetch_add_explicit(&ligne->receptions, nombre, memory_order_relaxed);
+	atomic_fetch_add_explicit(&ligne->octets_recus, octets, memory_order_relaxed);
+}
+
+// Après un échec : compte un refus si c'est un EAGAIN (sorte vaut ATTENTE_FILE_PLEINE pour un envoi, ATTENTE_FILE_VIDE pour une lecture)
+static void compter_echec(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte) {
+	if (errno == EAGAIN)
+		atomic_fetch_add_explicit(&ligne_statistiques(ptr_file_de_messages)->refus[sorte], 1, memory_order_relaxed);
+}
+
+// Compte nombre messages jetés à la lecture parce que périmés
+static void compter_perimes(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre) {
+	atomic_fetch_add_explicit(&ligne_statistiques(ptr_file_de_messages)->perimes, nombre, memory_order_relaxed);
+}
+
+// Compte une attente de la sorte donnée, commencée à l'heure debut (cf. horloge)
+static void compter_attente(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte, uint64_t debut) {
+	STATISTIQUES_LIGNE* ligne = ligne_statistiques(ptr_file_de_messages);
+
+	atomic_fetch_add_explicit(&ligne->attentes[sorte], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&ligne->duree_attentes[sorte], horloge() - debut, memory_order_relaxed);
+}
+
+#ifdef __linux__
+/**
+ * L'opération futex op pour la file : une file locale (m_connexion_locale) n'est vue que par les threads d'un processus,
+ * FUTEX_PRIVATE_FLAG évite au noyau de chercher la page partagée derrière l'adresse à chaque attente et à chaque réveil.
+ */
+static int operation_futex(FILE_DE_MESSAGES* ptr_file_de_messages, int op) {
+	return ptr_file_de_messages->locale ? op | FUTEX_PRIVATE_FLAG : op;
+}
+#endif
+
+/**
+ * Attente sur un mot de 32 bits de la mémoire partagée : le processus dort tant que *adresse == valeur,
+ * et au plus jusqu'à l'échéance de l'appel en cours (cf. echeance_attente).
+ * Sous Linux, c'est un futex, partagé entre processus (sauf pour une file locale, cf. operation_futex) ;
+ * ailleurs, on se contente de céder le processeur, l'appelant revérifiant la condition.
+ */
+static void futex_attendre(FILE_DE_MESSAGES* ptr_file_de_messages, _Atomic uint32_t* adresse, uint32_t valeur) {
+#ifdef __linux__
+	// long syscall(SYS_futex, uint32_t *uaddr, int futex_op, uint32_t val, const struct timespec *timeout, ...)
+	// EAGAIN : *adresse != valeur au moment de l'appel ; EINTR : signal ; ETIMEDOUT : échéance passée.
+	// Dans tous les cas l'appelant revérifie. FUTEX_WAIT_BITSET prend une échéance absolue de CLOCK_MONOTONIC.
+	long futex_resultat = echeance_attente == NULL
+	                    ? syscall(SYS_futex, (uint32_t *) adresse, operation_futex(ptr_file_de_messages, FUTEX_WAIT), valeur, NULL, NULL, 0)
+	                    : syscall(SYS_futex, (uint32_t *) adresse, operation_futex(ptr_file_de_messages, FUTEX_WAIT_BITSET), valeur,
+	                              echeance_attente, NULL, FUTEX_BITSET_MATCH_ANY);
+	if (futex_resultat == -1 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+		perror("Fonction futex(FUTEX_WAIT)");
+		exit(EXIT_FAILURE);
+	}
+#else
+	(void) ptr_file_de_messages;
+	if (atomic_load_explicit(adresse, memory_order_acquire) == valeur)
+		sched_yield();
+#endif
+}
+
+// Réveille au plus nombre processus qui attendent sur adresse
+static void futex_reveiller(FILE_DE_MESSAGES* ptr_file_de_messages, _Atomic uint32_t* adresse, int nombre) {
+#ifdef __linux__
+	long futex_resultat = syscall(SYS_futex, (uint32_t *) adresse, operation_futex(ptr_file_de_messages, FUTEX_WAKE), nombre, NULL, NULL, 0);
+	if (futex_resultat == -1) {
+		perror("Fonction futex(FUTEX_WAKE)");
+		exit(EXIT_FAILURE);
+	}
+#else
+	(void) ptr_file_de_messages;
+	(void) adresse;
+	(void) nombre;
+#endif
+}
+
+// Le nombre de tours d'attente active avant de dormir : aucun sur une machine à un seul processeur, où l'autre processus ne peut pas avancer pendant qu'on tourne
+static int tours_attente_active(void) {
+	static int tours = -1;
+
+	if (tours == -1) {
+		// long sysconf(int name)
+		long nombre_processeurs = sysconf(_SC_NPROCESSORS_ONLN);
+		tours = nombre_processeurs > 1 ? NB_TOURS_ATTENTE : 0;
+	}
+
+	return tours;
+}
+
+// Un tour d'attente active : indique au processeur qu'on tourne sur une lecture
+static void pause_active(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#else
+	atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+/**
+ * Attente active bornée : tourne tant que *adresse == valeur, au plus tours_attente_active() tours.
+ * Retourne 1 si la valeur a changé, 0 s'il faut dormir.
+ */
+static int attendre_activement(_Atomic uint32_t* adresse, uint32_t valeur) {
+	int i, tours = tours_attente_active();
+
+	for (i = 0 ; i < tours ; i++) {
+		if (atomic_load_explicit(adresse, memory_order_acquire) != valeur)
+			return 1;
+		pause_active();
+	}
+
+	return 0;
+}
+
+// Signale le canal et réveille au plus nombre processus endormis ; aucun appel système si personne ne dort
+static void reveiller_canal(FILE_DE_MESSAGES* ptr_file_de_messages, CANAL_ATTENTE* canal, int nombre) {
+	atomic_fetch_add_explicit(&canal->sequence, 1, memory_order_seq_cst);
+	if (atomic_load_explicit(&canal->en_attente, memory_order_seq_cst) > 0)
+		futex_reveiller(ptr_file_de_messages, &canal->sequence, nombre);
+}
+
+/*
+ * La reprise après la mort d'un processus qui avait le mutex. Les mutex de la file sont robustes : le processus suivant
+ * qui en prend un reçoit EOWNERDEAD ; il reconstruit ce que le mutex protège à partir de ce qu'une écriture interrompue
+ * ne peut pas laisser à moitié faite (l'état de chaque élément, de chaque place), puis déclare le mutex cohérent.
+ */
+
+static pid_t pid_processus = 0; // 0 : pas encore lu, ou remis à zéro par fork()
+
+static void oublier_pid(void) {
+	pid_processus = 0;
+}
+
+// Le pid du processus, sans appel système à chaque section critique
+static pid_t mon_pid(void) {
+	static int oubli_enregistre = 0;
+
+	if (pid_processus == 0) {
+		if (! oubli_enregistre) {
+			// int pthread_atfork(void (*prepare)(void), void (*parent)(void), void (*child)(void));
+			pthread_atfork(NULL, NULL, oublier_pid);
+			oubli_enregistre = 1;
+		}
+		pid_processus = getpid(); // pid_t getpid (void)
+	}
+
+	return pid_processus;
+}
+
+// Vrai si le processus pid, qui a réservé ou lu un élément, est mort : c'est le dernier propriétaire du mutex, ou il n'existe plus
+static int processus_mort(FILE_DE_MESSAGES* ptr_file_de_messages, pid_t pid) {
+	if (pid == 0)
+		return 0;
+
+	// int kill (pid_t pid, int signum) : avec signum == 0, vérifie seulement que le processus existe
+	return pid == ptr_file_de_messages->proprietaire_mutex || (kill(pid, 0) == -1 && errno == ESRCH);
+}
+
+/**
+ * Vérifie le résultat de pthread_mutex_lock() (ou de pthread_mutex_trylock()) sur un mutex robuste de la file.
+ * EOWNERDEAD : le mutex est pris, mais son dernier propriétaire est mort dans la section critique ; reparer() remet
+ * la file en état avant pthread_mutex_consistent(), sans quoi le mutex deviendrait inutilisable (ENOTRECOVERABLE).
+ */
+static void verifier_verrouillage(FILE_DE_MESSAGES* ptr_file_de_messages, pthread_mutex_t* mutex, int mutex_lock_result,
+                                  void (*reparer)(FILE_DE_MESSAGES *)) {
+	if(mutex_lock_result == EOWNERDEAD) {
+		reparer(ptr_file_de_messages);
+
+		// int pthread_mutex_consistent(pthread_mutex_t *mutex);
+		mutex_lock_result = pthread_mutex_consistent(mutex);
+	}
+
+	if(mutex_lock_result != 0) {
+		char* error_msg = strerror( mutex_lock_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Function pthread_mutex_lock() : %s \n", error_msg);
+		exit (EXIT_FAILURE);
+	}
+}
+
+// Un message publié et son ordre d'arrivée : reparer_elements() relie les messages dans cet ordre
+typedef struct message_a_relier {
+	uint64_t numero_ordre;
+	int index_element;
+} MESSAGE_A_RELIER ;
+
+static int comparer_messages_a_relier(const void* a, const void* b) {
+	uint64_t numero_a = ((const MESSAGE_A_RELIER *) a)->numero_ordre;
+	uint64_t numero_b = ((const MESSAGE_A_RELIER *) b)->numero_ordre;
+
+	return (numero_a > numero_b) - (numero_a < numero_b);
+}
+
+/**
+ * Moteurs M_MUTEX et M_PRIORITE : reconstruit la file, l'index des types, le tas et la liste des éléments libres
+ * d'après l'état des éléments. Un message à moitié lié ou délié n'est pas perdu (son état n'a pas encore changé) ;
+ * les éléments réservés ou lus par un processus mort redeviennent libres.
+ */
+static void reparer_elements(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	MESSAGE_A_RELIER* messages = malloc(ptr_file_de_messages->capacite * sizeof(MESSAGE_A_RELIER));
+	size_t nombre = 0;
+	size_t i;
+
+	ptr_file_de_messages->first = ptr_file_de_messages->last = ptr_file_de_messages->libre = -1;
+	ptr_file_de_messages->nombre_elements_remplis = 0;
+	ptr_file_de_messages->taille_tas = 0;
+	for(i = 0 ; i < ptr_file_de_messages->taille_index_types ; i++)
+		index_types(ptr_file_de_messages)[i].premier = -1;
+
+	for(i = ptr_file_de_messages->capacite ; i-- > 0 ; ) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, i);
+
+		if ( (element->etat == ELEMENT_RESERVE || element->etat == ELEMENT_LU) && processus_mort(ptr_file_de_messages, element->pid) )
+			element->etat = ELEMENT_LIBRE;
+
+		if (element->etat == ELEMENT_LIBRE) {
+			element->suivant = ptr_file_de_messages->libre;
+			ptr_file_de_messages->libre = i;
+		} else if (element->etat == ELEMENT_PUBLIE && messages != NULL) {
+			messages[nombre].numero_ordre = element->numero_ordre;
+			messages[nombre].index_element = i;
+			nombre++;
+		}
+	}
+
+	// Sans mémoire pour les trier, les messages sont reliés dans l'ordre du tableau
+	if (messages == NULL) {
+		for(i = 0 ; i < ptr_file_de_messages->capacite ; i++) {
+			if (element_file(ptr_file_de_messages, i)->etat == ELEMENT_PUBLIE) {
+				lier_element(ptr_file_de_messages, i);
+				ptr_file_de_messages->nombre_elements_remplis++;
+			}
+		}
+		return;
+	}
+
+	// lier_element() donne de nouveaux numero_ordre, dans le même ordre
+	qsort(messages, nombre, sizeof(MESSAGE_A_RELIER), comparer_messages_a_relier);
+	for(i = 0 ; i < nombre ; i++)
+		lier_element(ptr_file_de_messages, messages[i].index_element);
+	ptr_file_de_messages->nombre_elements_remplis = nombre;
+
+	free(messages);
+}
+
+/**
+ * Moteur M_OCTETS : parcourt l'anneau de tete à queue et recalcule lecture et les compteurs d'après l'état des places.
+ * L'en-tête d'une place est écrit avant que queue n'avance : une place entre tete et queue est toujours lisible.
+ * La place réservée par un processus mort devient un bourrage, que la lecture saute ; celle qu'il a lue est libérée.
+ */
+static void reparer_anneau(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	CURSEURS_OCTETS* octets = &ptr_file_de_messages->octets;
+	size_t occupees = 0, publies = 0;
+
+	// Mort au milieu de la remise à zéro d'un anneau vide
+	if (octets->queue - octets->tete > octets->taille_anneau)
+		octets->tete = octets->queue;
+
+	uint64_t position = octets->tete;
+	uint64_t fin_lus = octets->tete; // la fin de la dernière place lue ou libérée : les lectures se font dans l'ordre
+
+	while (position != octets->queue) {
+		ENREGISTREMENT* enregistrement = (ENREGISTREMENT *) ( debut_tableau(ptr_file_de_messages) + position % octets->taille_anneau );
+
+		if (enregistrement->taille < sizeof(ENREGISTREMENT) || enregistrement->taille > octets->queue - position
+		    || enregistrement->etat < ENREGISTREMENT_RESERVE || enregistrement->etat > ENREGISTREMENT_BOURRAGE) {
+			octets->queue = position; // en-tête illisible : l'anneau s'arrête là
+			break;
+		}
+
+		if (enregistrement->etat == ENREGISTREMENT_RESERVE && processus_mort(ptr_file_de_messages, enregistrement->pid))
+			enregistrement->etat = ENREGISTREMENT_BOURRAGE;
+		else if (enregistrement->etat == ENREGISTREMENT_LU && processus_mort(ptr_file_de_messages, enregistrement->pid))
+			enregistrement->etat = ENREGISTREMENT_LIBERE;
+
+		switch (enregistrement->etat) {
+			case ENREGISTREMENT_PUBLIE : publies++; // une place publiée est aussi occupée
+			                             // fall through
+			case ENREGISTREMENT_RESERVE : occupees++;
+			                              break;
+			case ENREGISTREMENT_LU : occupees++;
+			                         fin_lus = position + enregistrement->taille;
+			                         break;
+			case ENREGISTREMENT_LIBERE : fin_lus = position + enregistrement->taille;
+			                             break;
+		}
+
+		position += enregistrement->taille;
+	}
+
+	octets->lecture = fin_lus;
+	octets->nombre_enregistrements = occupees;
+	ptr_file_de_messages->nombre_elements_remplis = publies;
+
+	// Rendre à l'anneau les places libérées en tête, comme liberer_enregistrement()
+	while (octets->tete != octets->lecture) {
+		ENREGISTREMENT* enregistrement = (ENREGISTREMENT *) ( debut_tableau(ptr_file_de_messages) + octets->tete % octets->taille_anneau );
+		if (enregistrement->etat != ENREGISTREMENT_LIBERE && enregistrement->etat != ENREGISTREMENT_BOURRAGE)
+			break;
+
+		octets->tete += enregistrement->taille;
+	}
+}
+
+// Remet en état la file protégée par le mutex (moteurs M_MUTEX, M_PRIORITE et M_OCTETS)
+static void reparer_file(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int errno_appelant = errno;
+	int i;
+
+	if (ptr_file_de_messages->moteur == M_OCTETS)
+		reparer_anneau(ptr_file_de_messages);
+	else if (! moteur_diffusion(ptr_file_de_messages->moteur)) // le mutex des moteurs M_DIFFUSION ne protège que des écritures atomiques
+		reparer_elements(ptr_file_de_messages);
+	errno = errno_appelant;
+
+	// Le processus mort n'a peut-être pas signalé ce qu'il a changé : chaque processus endormi revérifie sa condition
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_pleine), INT_MAX);
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_vide), INT_MAX);
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_priorite), INT_MAX);
+	for (i = 0 ; i < NB_CANAUX_TYPE ; i++)
+		reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_type[i]), INT_MAX);
+}
+
+/**
+ * Attend un signalement du canal, mutex pris ; le mutex est rendu pendant l'attente et repris avant de retourner.
+ * L'appelant revérifie sa condition : un signalement peut concerner un autre type, ou un message déjà lu.
+ * Le processus tourne d'abord un peu, puis s'inscrit dans en_attente et dort sur sequence.
+ * L'inscription est relue avec une barrière complète par reveiller_canal() : soit celui qui signale voit
+ * le processus inscrit, soit le processus voit la nouvelle sequence et ne dort pas.
+ */
+static void attendre_canal(FILE_DE_MESSAGES* ptr_file_de_messages, CANAL_ATTENTE* canal) {
+	// La valeur lue mutex pris : tout signalement postérieur à la vérification de la condition la change
+	uint32_t sequence = atomic_load_explicit(&canal->sequence, memory_order_relaxed);
+	uint64_t debut = horloge();
+
+	ptr_file_de_messages->proprietaire_mutex = 0;
+	int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
+	if(mutex_unlock_result != 0) {
+		char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
+		exit (EXIT_FAILURE);
+	}
+
+	if (! attendre_activement(&canal->sequence, sequence)) {
+		atomic_fetch_add_explicit(&canal->en_attente, 1, memory_order_seq_cst);
+		if (atomic_load_explicit(&canal->sequence, memory_order_seq_cst) == sequence)
+			futex_attendre(ptr_file_de_messages, &canal->sequence, sequence);
+		atomic_fetch_sub_explicit(&canal->en_attente, 1, memory_order_relaxed);
+	}
+
+	int mutex_lock_result = pthread_mutex_lock( &(ptr_file_de_messages->mutex) );
+	verifier_verrouillage(ptr_file_de_messages, &(ptr_file_de_messages->mutex), mutex_lock_result, reparer_file);
+	ptr_file_de_messages->proprietaire_mutex = mon_pid();
+
+	compter_attente(ptr_file_de_messages, canal == &ptr_file_de_messages->attente_file_pleine ? ATTENTE_FILE_PLEINE : ATTENTE_FILE_VIDE, debut);
+}
+
+/*
+ * Les notifications par signal (enregistrement_notifications). Les enregistrements sont chaînés par type dans
+ * NB_LISTES_NOTIFICATIONS listes, sous mutex_notifications, qui n'est jamais pris avec le mutex de la file.
+ */
+
+#define NB_SIGNAUX_PAR_TOUR 32 // envoyer_notifications() rend le mutex des notifications pour envoyer les signaux par groupes
+
+// La liste des enregistrements de ce type
+static int* liste_notifications(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+	return &ptr_file_de_messages->notifications_par_type[hachage_type(type, NB_LISTES_NOTIFICATIONS)];
+}
+
+// Reconstruit les listes d'enregistrements : un enregistrement dont pid n'est pas nul est dans la liste de son type
+static void reparer_notifications(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	uint32_t nombre = 0;
+	int i;
+
+	ptr_file_de_messages->notifications_libres = -1;
+	for (i = 0 ; i < NB_LISTES_NOTIFICATIONS ; i++)
+		ptr_file_de_messages->notifications_par_type[i] = -1;
+
+	for (i = NB_NOTIFICATIONS ; i-- > 0 ; ) {
+		ENREGISTREMENT_NOTIFICATIONS* enregistrement = &ptr_file_de_messages->notifications[i];
+		int* liste = &ptr_file_de_messages->notifications_libres;
+
+		if (enregistrement->pid != 0) {
+			liste = liste_notifications(ptr_file_de_messages, enregistrement->type);
+			nombre++;
+		}
+
+		enregistrement->suivant = *liste;
+		*liste = i;
+	}
+
+	atomic_store_explicit(&ptr_file_de_messages->nombre_notifications, nombre, memory_order_relaxed);
+}
+
+static void verrouiller_notifications(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int mutex_lock_result = pthread_mutex_lock( &(ptr_file_de_messages->mutex_notifications) );
+	verifier_verrouillage(ptr_file_de_messages, &(ptr_file_de_messages->mutex_notifications), mutex_lock_result, reparer_notifications);
+}
+
+static void deverrouiller_notifications(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex_notifications) );
+	if(mutex_unlock_result != 0) {
+		char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
+		exit (EXIT_FAILURE);
+	}
+}
+
+// Retire de sa liste l'enregistrement *lien (lien : le champ qui le désigne) et le rend à la liste des enregistrements libres
+static void liberer_notification(FILE_DE_MESSAGES* ptr_file_de_messages, int* lien) {
+	int index = *lien;
+	ENREGISTREMENT_NOTIFICATIONS* enregistrement = &ptr_file_de_messages->notifications[index];
+
+	*lien = enregistrement->suivant;
+	enregistrement->pid = 0;
+	enregistrement->suivant = ptr_file_de_messages->notifications_libres;
+	ptr_file_de_messages->notifications_libres = index;
+
+	atomic_fetch_sub_explicit(&ptr_file_de_messages->nombre_notifications, 1, memory_order_relaxed);
+}
+
+// Libère les enregistrements des processus qui n'existent plus (mutex des notifications pris) ; retourne leur nombre
+static int liberer_notifications_orphelines(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int liste, nombre = 0;
+
+	for (liste = 0 ; liste < NB_LISTES_NOTIFICATIONS ; liste++) {
+		int* lien = &ptr_file_de_messages->notifications_par_type[liste];
+
+		while (*lien != -1) {
+			// int kill (pid_t pid, int signum) : avec signum == 0, vérifie seulement que le processus existe
+			if (kill(ptr_file_de_messages->notifications[*lien].pid, 0) == -1 && errno == ESRCH) {
+				liberer_notification(ptr_file_de_messages, lien);
+				nombre++;
+			} else {
+				lien = &ptr_file_de_messages->notifications[*lien].suivant;
+			}
+		}
+	}
+
+	return nombre;
+}
+
+/**
+ * Envoie le signal de notification aux processus enregistrés pour ce type.
+ * Quand le signal de notification est envoyé, le processus enregistré doit être automatiquement désenregistré.
+ * Les signaux sont envoyés mutex des notifications rendu ; un processus qui n'existe plus est simplement oublié.
+ */
+static void envoyer_notifications(FILE_DE_MESSAGES* ptr_file_de_messages, long type) {
+
+	// Sans aucun enregistrement, un envoi ne prend pas le mutex des notifications
+	if (atomic_load_explicit(&ptr_file_de_messages->nombre_notifications, memory_order_relaxed) == 0)
+		return;
+
+	int errno_appelant = errno;
+	ENREGISTREMENT_NOTIFICATIONS a_signaler[NB_SIGNAUX_PAR_TOUR];
+	int nombre, i;
+
+	do {
+		nombre = 0;
+
+		verrouiller_notifications(ptr_file_de_messages);
+		int* lien = liste_notifications(ptr_file_de_messages, type);
+		while (*lien != -1 && nombre < NB_SIGNAUX_PAR_TOUR) {
+			ENREGISTREMENT_NOTIFICATIONS* enregistrement = &ptr_file_de_messages->notifications[*lien];
+
+			if (enregistrement->type == type) {
+				a_signaler[nombre++] = *enregistrement;
+				liberer_notification(ptr_file_de_messages, lien);
+			} else {
+				lien = &enregistrement->suivant;
+			}
+		}
+		deverrouiller_notifications(ptr_file_de_messages);
+
+		// int kill (pid_t pid, int signum) ; ESRCH : le processus n'existe plus, son enregistrement est déjà libéré
+		for (i = 0 ; i < nombre ; i++)
+			kill(a_signaler[i].pid, a_signaler[i].signum);
+
+	} while (nombre == NB_SIGNAUX_PAR_TOUR);
+
+	errno = errno_appelant;
+}
+
+/*
+ * Chaque moteur découpe un envoi en deux phases : réserver un élément libre (en attendant s'il le faut),
+ * puis publier le message qu'on y a écrit. De même, une réception réserve le message à lire, puis libère l'élément.
+ * m_envoi() et m_reception() copient le message entre les deux phases ; m_envoi_reserve(), m_envoi_commit(),
+ * m_reception_peek() et m_reception_release() laissent l'appelant lire et écrire directement dans l'élément.
+ */
+
+/**
+ * Réserve l'élément où le producteur du moteur M_SPSC écrira son prochain message.
+ * Un seul producteur écrit queue, un seul consommateur écrit tete, le mutex n'est donc jamais pris.
+ * Le producteur n'entre dans le noyau que pour dormir quand l'anneau est plein.
+ */
+static FILE_ELEMENT* reserver_envoi_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, int msgflag) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t capacite = (uint32_t) ptr_file_de_messages->capacite;
+	uint32_t queue = atomic_load_explicit(&spsc->queue, memory_order_relaxed); // seul le producteur écrit queue
+
+	if (queue - spsc->tete_locale == capacite) // Peut-être pleine : relire la vraie valeur de tete
+		spsc->tete_locale = atomic_load_explicit(&spsc->tete, memory_order_acquire);
+
+	while (queue - spsc->tete_locale == capacite) { // Si pas de place dans la file
+
+		switch(msgflag) {
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		uint64_t debut = horloge();
+
+		// Tourner un peu : le consommateur libère souvent une place en quelques microsecondes
+		if (! attendre_activement(&spsc->tete, spsc->tete_locale)) {
+			// Se déclarer endormi puis relire tete : soit le consommateur voit attente_producteur, soit nous voyons sa nouvelle tete
+			atomic_store_explicit(&spsc->attente_producteur, 1, memory_order_seq_cst);
+			uint32_t tete = atomic_load_explicit(&spsc->tete, memory_order_seq_cst);
+			if (queue - tete == capacite)
+				futex_attendre(ptr_file_de_messages, &spsc->tete, tete);
+
+			atomic_store_explicit(&spsc->attente_producteur, 0, memory_order_relaxed);
+		}
+
+		spsc->tete_locale = atomic_load_explicit(&spsc->tete, memory_order_acquire);
+		compter_attente(ptr_file_de_messages, ATTENTE_FILE_PLEINE, debut);
+	}
+
+	return element_file(ptr_file_de_messages, queue & (capacite - 1));
+}
+
+// Publie les nombre messages écrits à partir de queue, puis réveille le consommateur s'il s'est déclaré endormi
+static void publier_envoi_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, uint32_t nombre) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t queue = atomic_load_explicit(&spsc->queue, memory_order_relaxed);
+
+	// Le contenu des éléments est visible avant la nouvelle queue
+	atomic_store_explicit(&spsc->queue, queue + nombre, memory_order_seq_cst);
+	if (atomic_load_explicit(&spsc->attente_consommateur, memory_order_seq_cst))
+		futex_reveiller(ptr_file_de_messages, &spsc->queue, 1);
+}
+
+// Libère les nombre éléments lus à partir de tete, puis réveille le producteur s'il s'est déclaré endormi
+static void liberer_reception_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, uint32_t nombre) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t tete = atomic_load_explicit(&spsc->tete, memory_order_relaxed);
+
+	atomic_store_explicit(&spsc->tete, tete + nombre, memory_order_seq_cst);
+	if (atomic_load_explicit(&spsc->attente_producteur, memory_order_seq_cst))
+		futex_reveiller(ptr_file_de_messages, &spsc->tete, 1);
+}
+
+// Réserve le prochain message pour le consommateur du moteur M_SPSC, symétrique de reserver_envoi_spsc() ; les messages périmés sont jetés
+static FILE_ELEMENT* reserver_reception_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, int flags) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t tete = atomic_load_explicit(&spsc->tete, memory_order_relaxed); // seul le consommateur écrit tete
+	FILE_ELEMENT* element;
+
+	for (;;) {
+		if (spsc->queue_locale == tete) // Peut-être vide : relire la vraie valeur de queue
+			spsc->queue_locale = atomic_load_explicit(&spsc->queue, memory_order_acquire);
+
+		while (spsc->queue_locale == tete) { // Si la file est vide
+
+			switch(flags) {
+				case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+				                  return NULL; // échec
+				case 0 : break; // L’appel est bloquant jusqu’à ce que la lecture réussisse.
+				default : return NULL; // échec
+			}
+
+			if (echeance_depassee())
+				return NULL; // échec, errno == ETIMEDOUT
+
+			uint64_t debut = horloge();
+
+			if (! attendre_activement(&spsc->queue, spsc->queue_locale)) {
+				atomic_store_explicit(&spsc->attente_consommateur, 1, memory_order_seq_cst);
+				uint32_t queue = atomic_load_explicit(&spsc->queue, memory_order_seq_cst);
+				if (queue == tete)
+					futex_attendre(ptr_file_de_messages, &spsc->queue, queue);
+
+				atomic_store_explicit(&spsc->attente_consommateur, 0, memory_order_relaxed);
+			}
+
+			spsc->queue_locale = atomic_load_explicit(&spsc->queue, memory_order_acquire);
+			compter_attente(ptr_file_de_messages, ATTENTE_FILE_VIDE, debut);
+		}
+
+		element = element_file(ptr_file_de_messages, tete & ((uint32_t) ptr_file_de_messages->capacite - 1));
+		if (! element_perime(element))
+			break;
+
+		// Message périmé : sa place est rendue sans qu'il soit lu
+		jeter_hors_ligne(ptr_file_de_messages, element);
+		liberer_reception_spsc(ptr_file_de_messages, 1);
+		compter_perimes(ptr_file_de_messages, 1);
+		tete++;
+	}
+
+	// Le message reste dans la file si msg est trop petit
+	if (len < element->longueur_message) {
+		errno = EMSGSIZE;
+		return NULL; // échec
+	}
+
+	return element;
+}
+
+/**
+ * Réveille jusqu'à nombre processus parmi ceux qui attendent sur signal, s'il y en a.
+ * Le compteur en_attente est relu après une barrière complète : soit le processus qui attend voit ce que l'appelant
+ * vient de publier, soit l'appelant voit le processus qui attend (cf. reserver_envoi_mpmc et reserver_reception_mpmc).
+ */
+static void reveiller_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, _Atomic uint32_t* signal, _Atomic uint32_t* en_attente, int nombre) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(en_attente, memory_order_relaxed) > 0) {
+		atomic_fetch_add_explicit(signal, 1, memory_order_release);
+		futex_reveiller(ptr_file_de_messages, signal, nombre);
+	}
+}
+
+/**
+ * Essaie de prendre une position pour un producteur du moteur M_MPMC.
+ * Retourne l'élément réservé, ou NULL si l'anneau est plein.
+ * Tant que le message n'est pas publié, la sequence de l'élément est égale à la position prise.
+ */
+static FILE_ELEMENT* essayer_envoi_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	uint32_t masque = (uint32_t) ptr_file_de_messages->capacite - 1;
+	uint32_t queue = atomic_load_explicit(&mpmc->queue, memory_order_relaxed);
+
+	for (;;) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, queue & masque);
+		int32_t difference = (int32_t) ( atomic_load_explicit(&element->sequence, memory_order_acquire) - queue );
+
+		if (difference == 0) { // L'élément est libre pour cette position : essayer de la prendre
+			// En cas d'échec, compare_exchange met la valeur actuelle de queue dans queue
+			if (atomic_compare_exchange_weak_explicit(&mpmc->queue, &queue, queue + 1, memory_order_relaxed, memory_order_relaxed))
+				return element;
+		} else if (difference < 0) { // L'élément n'a pas encore été lu depuis le tour précédent : la file est pleine
+			return NULL;
+		} else { // Un autre producteur a pris cette position
+			queue = atomic_load_explicit(&mpmc->queue, memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * Essaie de prendre une position pour un consommateur du moteur M_MPMC, si le message qui s'y trouve tient dans len octets.
+ * Retourne l'élément réservé, ou NULL si l'anneau est vide (errno == EAGAIN) ou si le message est trop long (errno == EMSGSIZE).
+ * Tant que le message n'est pas libéré, la sequence de l'élément est égale à la position prise + 1.
+ */
+static FILE_ELEMENT* essayer_reception_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	uint32_t masque = (uint32_t) ptr_file_de_messages->capacite - 1;
+	uint32_t tete = atomic_load_explicit(&mpmc->tete, memory_order_relaxed);
+
+	for (;;) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, tete & masque);
+		uint32_t sequence = atomic_load_explicit(&element->sequence, memory_order_acquire);
+		int32_t difference = (int32_t) ( sequence - (tete + 1) );
+
+		if (difference == 0) { // Le message de cette position est publié
+			// Message périmé : la position est prise et l'élément rendu aussitôt, sans être lu
+			if (element_perime(element)) {
+				if (atomic_compare_exchange_weak_explicit(&mpmc->tete, &tete, tete + 1, memory_order_relaxed, memory_order_relaxed)) {
+					jeter_hors_ligne(ptr_file_de_messages, element);
+					atomic_store_explicit(&element->sequence, tete + masque + 1, memory_order_release);
+					reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_plein, &mpmc->producteurs_en_attente, 1);
+					compter_perimes(ptr_file_de_messages, 1);
+					tete++;
+				}
+				continue;
+			}
+
+			// Le message reste dans la file si msg est trop petit : on ne prend la position qu'après avoir vérifié la longueur
+			if (len < element->longueur_message) {
+				if (atomic_load_explicit(&element->sequence, memory_order_acquire) == sequence) {
+					errno = EMSGSIZE;
+					return NULL;
+				}
+				tete = atomic_load_explicit(&mpmc->tete, memory_order_relaxed);
+				continue;
+			}
+
+			if (atomic_compare_exchange_weak_explicit(&mpmc->tete, &tete, tete + 1, memory_order_relaxed, memory_order_relaxed))
+				return element;
+		} else if (difference < 0) { // Rien n'est encore publié à cette position : la file est vide
+			errno = EAGAIN;
+			return NULL;
+		} else { // Un autre consommateur a pris cette position
+			tete = atomic_load_explicit(&mpmc->tete, memory_order_relaxed);
+		}
+	}
+}
+
+/**
+ * Réserve un élément pour un producteur du moteur M_MPMC : aucun verrou global, chaque producteur prend sa position
+ * par compare-and-swap. Un producteur qui trouve l'anneau plein s'inscrit dans producteurs_en_attente, revérifie,
+ * puis dort sur signal_non_plein.
+ */
+static FILE_ELEMENT* reserver_envoi_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, int msgflag) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	FILE_ELEMENT* element;
+
+	while ( (element = essayer_envoi_mpmc(ptr_file_de_messages)) == NULL ) { // Si pas de place dans la file
+
+		switch(msgflag) {
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		uint64_t debut = horloge();
+
+		// Tourner un peu avant de s'inscrire : un consommateur libère souvent une place en quelques microsecondes
+		int tour, tours = tours_attente_active();
+		for (tour = 0 ; tour < tours && (element = essayer_envoi_mpmc(ptr_file_de_messages)) == NULL ; tour++)
+			pause_active();
+
+		if (element == NULL) {
+			uint32_t signal = atomic_load_explicit(&mpmc->signal_non_plein, memory_order_acquire);
+			atomic_fetch_add_explicit(&mpmc->producteurs_en_attente, 1, memory_order_relaxed);
+			atomic_thread_fence(memory_order_seq_cst);
+
+			element = essayer_envoi_mpmc(ptr_file_de_messages);
+			if (element == NULL)
+				futex_attendre(ptr_file_de_messages, &mpmc->signal_non_plein, signal);
+
+			atomic_fetch_sub_explicit(&mpmc->producteurs_en_attente, 1, memory_order_relaxed);
+		}
+
+		compter_attente(ptr_file_de_messages, ATTENTE_FILE_PLEINE, debut);
+		if (element != NULL)
+			break;
+	}
+
+	return element;
+}
+
+// Publie le message pour le consommateur de cette position
+static void publier_envoi_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	uint32_t position = atomic_load_explicit(&element->sequence, memory_order_relaxed);
+
+	atomic_store_explicit(&element->sequence, position + 1, memory_order_release);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_vide, &ptr_file_de_messages->mpmc.consommateurs_en_attente, 1);
+}
+
+// Réserve le prochain message pour un consommateur du moteur M_MPMC, symétrique de reserver_envoi_mpmc()
+static FILE_ELEMENT* reserver_reception_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, int flags) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	FILE_ELEMENT* element;
+
+	while ( (element = essayer_reception_mpmc(ptr_file_de_messages, len)) == NULL ) {
+
+		if (errno == EMSGSIZE)
+			return NULL; // échec
+
+		switch(flags) { // Si la file est vide
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // L’appel est bloquant jusqu’à ce que la lecture réussisse.
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		uint64_t debut = horloge();
+
+		int tour, tours = tours_attente_active();
+		for (tour = 0 ; tour < tours && (element = essayer_reception_mpmc(ptr_file_de_messages, len)) == NULL ; tour++) {
+			if (errno == EMSGSIZE)
+				return NULL; // échec
+			pause_active();
+		}
+
+		if (element == NULL) {
+			uint32_t signal = atomic_load_explicit(&mpmc->signal_non_vide, memory_order_acquire);
+			atomic_fetch_add_explicit(&mpmc->consommateurs_en_attente, 1, memory_order_relaxed);
+			atomic_thread_fence(memory_order_seq_cst);
+
+			element = essayer_reception_mpmc(ptr_file_de_messages, len);
+			if (element == NULL && errno == EAGAIN)
+				futex_attendre(ptr_file_de_messages, &mpmc->signal_non_vide, signal);
+
+			atomic_fetch_sub_explicit(&mpmc->consommateurs_en_attente, 1, memory_order_relaxed);
+		}
+
+		compter_attente(ptr_file_de_messages, ATTENTE_FILE_VIDE, debut);
+		if (element != NULL)
+			break;
+	}
+
+	return element;
+}
+
+// Rend l'élément au producteur du tour suivant
+static void liberer_reception_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	uint32_t position = atomic_load_explicit(&element->sequence, memory_order_relaxed) - 1;
+
+	atomic_store_explicit(&element->sequence, position + (uint32_t) ptr_file_de_messages->capacite, memory_order_release);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_plein, &ptr_file_de_messages->mpmc.producteurs_en_attente, 1);
+}
+
+/* Les moteurs M_MUTEX et M_PRIORITE : toutes les fonctions suivantes, sauf les signalements, s'appellent mutex pris */
+
+// Prend le mutex de la file (début de la section critique)
+static void verrouiller(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	// int pthread_mutex_trylock(pthread_mutex_t *mutex) : EBUSY si un autre processus a le mutex, on compte alors l'attente
+	int mutex_lock_result = pthread_mutex_trylock( &(ptr_file_de_messages->mutex) );
+	if(mutex_lock_result == EBUSY) {
+		uint64_t debut = horloge();
+		mutex_lock_result = pthread_mutex_lock( &(ptr_file_de_messages->mutex) );
+		compter_attente(ptr_file_de_messages, ATTENTE_VERROU, debut);
+	}
+	verifier_verrouillage(ptr_file_de_messages, &(ptr_file_de_messages->mutex), mutex_lock_result, reparer_file);
+
+	/* SECTION CRITIQUE - DEBUT */
+
+	ptr_file_de_messages->proprietaire_mutex = mon_pid();
+}
+
+// Rend le mutex de la file (fin de la section critique)
+static void deverrouiller(FILE_DE_MESSAGES* ptr_file_de_messages) {
+
+	ptr_file_de_messages->proprietaire_mutex = 0;
+
+	/* SECTION CRITIQUE - FIN */
+
+	int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
+	if(mutex_unlock_result != 0) {
+		char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
+		exit (EXIT_FAILURE);
+	}
+}
+
+/**
+ * Prend le premier élément libre, en attendant qu'une place se libère si msgflag == 0.
+ * Retourne l'indice de l'élément, ou -1 (errno == EAGAIN si la file est pleine et msgflag == O_NONBLOCK).
+ * Les éléments réservés (m_envoi_reserve) ou en cours de lecture (m_reception_peek) ne sont pas libres :
+ * la file est pleine quand la liste des éléments libres est vide.
+ */
+static int prendre_element_libre(FILE_DE_MESSAGES* ptr_file_de_messages, int msgflag) {
+
+	while(ptr_file_de_messages->libre == -1) { // Si pas de place dans la file
+
+		switch(msgflag) {
+			case O_NONBLOCK : // Si pas de place dans la file, alors lappel retourne tout de suite avec la valeur de retour −1
+				              // et errno prend la valeur EAGAIN.
+				              errno = EAGAIN; // errno prend la valeur EAGAIN
+				              return -1; // échec
+			case 0 : // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
+				      break;
+			default : return -1; // échec
+		}
+
+		if (echeance_depassee())
+			return -1; // échec, errno == ETIMEDOUT
+
+		attendre_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_pleine));
+	}
+
+	int index_element = ptr_file_de_messages->libre;
+	ptr_file_de_messages->libre = element_file(ptr_file_de_messages, index_element)->suivant;
+	element_file(ptr_file_de_messages, index_element)->pid = mon_pid();
+	element_file(ptr_file_de_messages, index_element)->etat = ELEMENT_RESERVE;
+
+	return index_element;
+}
+
+// Rend un élément à la liste des éléments libres
+static void rendre_element_libre(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	element_file(ptr_file_de_messages, index_element)->etat = ELEMENT_LIBRE;
+	element_file(ptr_file_de_messages, index_element)->suivant = ptr_file_de_messages->libre;
+	ptr_file_de_messages->libre = index_element;
+}
+
+// Ajoute les taille octets de donnees à la somme de contrôle FNV-1a somme (2166136261 pour commencer)
+static uint32_t fnv1a(uint32_t somme, const void* donnees, size_t taille) {
+	const unsigned char* octets = (const unsigned char *) donnees;
+	size_t i;
+
+	for (i = 0 ; i < taille ; i++)
+		somme = ( somme ^ octets[i] ) * 16777619u;
+
+	return somme;
+}
+
+/**
+ * Files durables : la somme de contrôle (FNV-1a) du type, de la longueur et du message d'un élément. Elle ne dépend pas
+ * de la place de l'élément ni de son rang : un message déplacé ou relié (reparer_elements) la garde.
+ */
+static uint32_t somme_controle(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	long entete[2] = { element->type, element->longueur_message };
+
+	return fnv1a(fnv1a(2166136261u, entete, sizeof(entete)), message_element(ptr_file_de_messages, element), (size_t) element->longueur_message);
+}
+
+// Ajoute le message écrit dans l'élément à la fin de la file et à la fin de la liste de son type
+static void publier_element(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element, long type, size_t len) {
+	FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_element);
+
+	element->longueur_message = len;
+	element->type = type;
+	element->peremption = peremption_envoi();
+	if (ptr_file_de_messages->durable)
+		element->somme_controle = somme_controle(ptr_file_de_messages, element);
+
+	lier_element(ptr_file_de_messages, index_element);
+	ptr_file_de_messages->nombre_elements_remplis++;
+
+	// Le message n'est dans la file, pour reparer_file(), qu'une fois lié
+	element->etat = ELEMENT_PUBLIE;
+}
+
+// Retire le message de la file et de la liste de son type ; l'élément n'est pas encore libre
+static void retirer_message(FILE_DE_MESSAGES* ptr_file_de_messages, int index_element) {
+	delier_element(ptr_file_de_messages, index_element);
+	ptr_file_de_messages->nombre_elements_remplis--;
+	element_file(ptr_file_de_messages, index_element)->pid = mon_pid();
+	element_file(ptr_file_de_messages, index_element)->etat = ELEMENT_LU;
+}
+
+// Signale nombre nouvelles places libres aux envois qui attendent (mutex rendu, ou pris pour les places des messages périmés)
+static void signaler_places(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre) {
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_pleine), nombre < INT_MAX ? (int) nombre : INT_MAX);
+}
+
+/**
+ * Cherche le message à lire pour la demande type, en attendant qu'il arrive si flags == 0, et vérifie qu'il tient dans len octets.
+ * Les messages périmés rencontrés sont jetés, leur place rendue.
+ * Retourne l'indice de l'élément, qui reste dans la file, ou -1 (errno == EAGAIN, EMSGSIZE ou ETIMEDOUT).
+ */
+static int chercher_message(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, long type, int flags) {
+	int index_element;
+
+	// Le message à lire : grâce à l'index des types, aucune demande ne parcourt les messages de la file
+	for (;;) {
+		index_element = choisir_element(ptr_file_de_messages, type);
+
+		if (index_element != -1 && element_perime(element_file(ptr_file_de_messages, index_element))) {
+			// Message périmé : sa place est rendue sans qu'il soit lu
+			jeter_hors_ligne(ptr_file_de_messages, element_file(ptr_file_de_messages, index_element));
+			retirer_message(ptr_file_de_messages, index_element);
+			rendre_element_libre(ptr_file_de_messages, index_element);
+			signaler_places(ptr_file_de_messages, 1);
+			compter_perimes(ptr_file_de_messages, 1);
+			continue;
+		}
+
+		if (index_element != -1)
+			break; // S’il y a un message du type demandé
+
+		switch(flags) {
+			case O_NONBLOCK : // Si il ny a pas de message du type demandé dans la file,
+				             // l’appel retourne tout de suite avec la valeur −1 et errno == EAGAIN.
+				              errno = EAGAIN; // errno prend la valeur EAGAIN
+				              return -1; // échec
+			case 0 : // L’appel est bloquant jusqu’à ce que la lecture réussisse.
+				      break;
+			default : return -1; // échec
+		}
+
+		if (echeance_depassee())
+			return -1; // échec, errno == ETIMEDOUT
+
+		// Chaque sorte de demande (type nul, positif ou négatif) a son propre canal d'attente
+		attendre_canal(ptr_file_de_messages, canal_reception(ptr_file_de_messages, type));
+	}
+
+	// Le message reste dans la file si msg est trop petit
+	if (len < element_file(ptr_file_de_messages, index_element)->longueur_message) {
+
+		// Nous avons peut-être consommé le réveil destiné à ce message : le transmettre à une autre lecture
+		reveiller_canal(ptr_file_de_messages, canal_reception(ptr_file_de_messages, type), 1);
+
+		errno = EMSGSIZE;
+		return -1; // échec
+	}
+
+	return index_element;
+}
+
+// Le bit du canal de type (attente_type) sur lequel attendent les lectures de ce type ; 0 si type <= 0
+static uint32_t canal_type(long type) {
+	return type > 0 ? (uint32_t) 1 << hachage_type(type, NB_CANAUX_TYPE) : 0;
+}
+
+/**
+ * Signale nombre nouveaux messages aux lectures qui attendent ; canaux est l'union des canal_type() de leurs types.
+ * Appelée une fois par envoi ou par lot, mutex rendu (ou pris, avant une attente au milieu d'un lot).
+ */
+static void signaler_messages(FILE_DE_MESSAGES* ptr_file_de_messages, uint32_t canaux, size_t nombre) {
+
+	// Un message réveille une lecture du premier message, un lot les réveille toutes
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_vide), nombre == 1 ? 1 : INT_MAX);
+
+	// Les lectures d'un type donné et les lectures par priorité attendent sur d'autres canaux.
+	// Un canal de type peut être partagé par plusieurs types et une lecture par priorité peut ne pas accepter ce type :
+	// on les réveille toutes, chacune revérifie sa propre demande.
+	int canal;
+	for (canal = 0 ; canal < NB_CANAUX_TYPE ; canal++)
+		if (canaux & ((uint32_t) 1 << canal))
+			reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_type[canal]), INT_MAX);
+	reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_priorite), INT_MAX);
+}
+
+/* Le moteur M_OCTETS : un mutex et un anneau d'octets, toutes les fonctions suivantes s'appellent mutex pris */
+
+// La place occupée dans l'anneau par un message de len octets, en-tête compris : un multiple de alignement
+static size_t taille_enregistrement(size_t len, size_t alignement) {
+	return ( sizeof(ENREGISTREMENT) + len + alignement - 1 ) / alignement * alignement;
+}
+
+// L'en-tête de la place qui commence au compteur d'octets position
+static ENREGISTREMENT* enregistrement_anneau(FILE_DE_MESSAGES* ptr_file_de_messages, uint64_t position) {
+	return (ENREGISTREMENT *) ( debut_tableau(ptr_file_de_messages) + position % ptr_file_de_messages->octets.taille_anneau );
+}
+
+/**
+ * Réserve une place pour un message de len octets à la fin de l'anneau, en attendant qu'il y en ait une si msgflag == 0.
+ * Il faut à la fois assez d'octets libres et moins de capacite places occupées.
+ * Retourne l'en-tête de la place réservée, ou NULL (errno == EAGAIN si la file est pleine et msgflag == O_NONBLOCK).
+ */
+static ENREGISTREMENT* allouer_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, int msgflag) {
+	CURSEURS_OCTETS* octets = &ptr_file_de_messages->octets;
+	size_t taille = taille_enregistrement(len, ptr_file_de_messages->alignement);
+
+	for (;;) {
+		if (octets->nombre_enregistrements < ptr_file_de_messages->capacite) {
+
+			// Anneau vide : recommencer au début, aucun bourrage n'est nécessaire
+			if (octets->tete == octets->queue) {
+				uint64_t debut = ( octets->queue + octets->taille_anneau - 1 ) / octets->taille_anneau * octets->taille_anneau;
+				octets->tete = octets->lecture = octets->queue = debut;
+			}
+
+			// Un message ne se coupe pas en deux : s'il ne tient pas avant la fin de l'anneau, il commence au début
+			size_t reste = octets->taille_anneau - octets->queue % octets->taille_anneau;
+			size_t bourrage = reste < taille ? reste : 0;
+
+			if (octets->queue - octets->tete + bourrage + taille <= octets->taille_anneau) {
+				ENREGISTREMENT* enregistrement;
+
+				if (bourrage > 0) {
+					enregistrement = enregistrement_anneau(ptr_file_de_messages, octets->queue);
+					enregistrement->taille = bourrage;
+					enregistrement->etat = ENREGISTREMENT_BOURRAGE;
+					octets->queue += bourrage;
+				}
+
+				enregistrement = enregistrement_anneau(ptr_file_de_messages, octets->queue);
+				enregistrement->taille = taille;
+				enregistrement->longueur = len;
+				enregistrement->pid = mon_pid();
+				enregistrement->etat = ENREGISTREMENT_RESERVE;
+				octets->queue += taille;
+				octets->nombre_enregistrements++;
+
+				return enregistrement;
+			}
+		}
+
+		switch(msgflag) { // Si pas de place dans la file
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		attendre_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_pleine));
+	}
+}
+
+// Publie le message de len octets écrit dans une place réservée
+static void publier_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages, ENREGISTREMENT* enregistrement, long type, size_t len) {
+	enregistrement->longueur = len;
+	enregistrement->type = type;
+	enregistrement->etat = ENREGISTREMENT_PUBLIE;
+
+	ptr_file_de_messages->nombre_elements_remplis++;
+}
+
+// Le prochain message à lire, ou NULL si l'anneau est vide ou si la place suivante n'est pas encore publiée (ordre FIFO)
+static ENREGISTREMENT* premier_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	CURSEURS_OCTETS* octets = &ptr_file_de_messages->octets;
+
+	while (octets->lecture != octets->queue) {
+		ENREGISTREMENT* enregistrement = enregistrement_anneau(ptr_file_de_messages, octets->lecture);
+
+		if (enregistrement->etat != ENREGISTREMENT_BOURRAGE)
+			return enregistrement->etat == ENREGISTREMENT_PUBLIE ? enregistrement : NULL;
+
+		octets->lecture += enregistrement->taille;
+	}
+
+	return NULL;
+}
+
+/**
+ * Cherche le prochain message, en attendant qu'il soit publié si flags == 0, et vérifie qu'il tient dans len octets.
+ * Retourne son en-tête, le message restant dans la file, ou NULL (errno == EAGAIN ou EMSGSIZE).
+ */
+static ENREGISTREMENT* chercher_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, int flags) {
+	ENREGISTREMENT* enregistrement;
+
+	while ( (enregistrement = premier_enregistrement(ptr_file_de_messages)) == NULL ) { // Si la file est vide
+
+		switch(flags) {
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // L’appel est bloquant jusqu’à ce que la lecture réussisse.
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		attendre_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_vide));
+	}
+
+	// Le message reste dans la file si msg est trop petit
+	if (len < enregistrement->longueur) {
+
+		// Nous avons peut-être consommé le réveil destiné à ce message : le transmettre à une autre lecture
+		reveiller_canal(ptr_file_de_messages, &(ptr_file_de_messages->attente_file_vide), 1);
+
+		errno = EMSGSIZE;
+		return NULL; // échec
+	}
+
+	return enregistrement;
+}
+
+// Retire le message de la file ; sa place n'est pas encore libre
+static void retirer_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages, ENREGISTREMENT* enregistrement) {
+	enregistrement->pid = mon_pid();
+	enregistrement->etat = ENREGISTREMENT_LU;
+	ptr_file_de_messages->octets.lecture += enregistrement->taille;
+
+	ptr_file_de_messages->nombre_elements_remplis--;
+}
+
+// Libère la place d'un message lu ; les octets ne sont rendus à l'anneau que lorsque toutes les places précédentes sont libérées
+static void liberer_enregistrement(FILE_DE_MESSAGES* ptr_file_de_messages, ENREGISTREMENT* enregistrement) {
+	CURSEURS_OCTETS* octets = &ptr_file_de_messages->octets;
+
+	enregistrement->etat = ENREGISTREMENT_LIBERE;
+	octets->nombre_enregistrements--;
+
+	while (octets->tete != octets->lecture) {
+		enregistrement = enregistrement_anneau(ptr_file_de_messages, octets->tete);
+		if (enregistrement->etat != ENREGISTREMENT_LIBERE && enregistrement->etat != ENREGISTREMENT_BOURRAGE)
+			break;
+
+		octets->tete += enregistrement->taille;
+	}
+}
+
+/**
+ * L'en-tête de la place dont zone est le contenu, si cette place est dans l'état etat
+ * (ENREGISTREMENT_RESERVE pour m_envoi_commit, ENREGISTREMENT_LU pour m_reception_release) ; NULL sinon.
+ */
+static ENREGISTREMENT* enregistrement_de_zone(FILE_DE_MESSAGES* ptr_file_de_messages, const void* zone, uint32_t etat) {
+	char* debut = debut_tableau(ptr_file_de_messages);
+
+	if ((char *) zone < debut + sizeof(ENREGISTREMENT) || (char *) zone >= debut + ptr_file_de_messages->octets.taille_anneau)
+		return NULL;
+	if (( (char *) zone - sizeof(ENREGISTREMENT) - debut ) % ptr_file_de_messages->alignement != 0) // chaque place commence à un multiple de alignement
+		return NULL;
+
+	ENREGISTREMENT* enregistrement = (ENREGISTREMENT *) zone - 1;
+
+	return enregistrement->etat == etat ? enregistrement : NULL;
+}
+
+// m_envoi() pour le moteur M_OCTETS : une seule section critique
+static int envoi_octets(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msg, size_t len, int msgflag) {
+	verrouiller(ptr_file_de_messages);
+
+	ENREGISTREMENT* enregistrement = allouer_enregistrement(ptr_file_de_messages, len, msgflag);
+	if (enregistrement == NULL) { // échec : ne pas garder le mutex
+		deverrouiller(ptr_file_de_messages);
+		return -1;
+	}
+
+	copier_envoi(enregistrement + 1, msg->mtext, len);
+	publier_enregistrement(ptr_file_de_messages, enregistrement, msg->type, len);
+
+	deverrouiller(ptr_file_de_messages);
+
+	signaler_messages(ptr_file_de_messages, 0, 1);
+	envoyer_notifications(ptr_file_de_messages, msg->type);
+
+	return 0;
+}
+
+// m_reception() pour le moteur M_OCTETS : une seule section critique
+static ssize_t reception_octets(FILE_DE_MESSAGES* ptr_file_de_messages, void* msg, size_t len, int flags) {
+	verrouiller(ptr_file_de_messages);
+
+	ENREGISTREMENT* enregistrement = chercher_enregistrement(ptr_file_de_messages, len, flags);
+	if (enregistrement == NULL) { // échec : ne pas garder le mutex
+		deverrouiller(ptr_file_de_messages);
+		return -1;
+	}
+
+	ssize_t nombre_octets_message_lu = enregistrement->longueur;
+
+	copier_reception(msg, enregistrement + 1, nombre_octets_message_lu);
+	retirer_enregistrement(ptr_file_de_messages, enregistrement);
+	liberer_enregistrement(ptr_file_de_messages, enregistrement);
+
+	deverrouiller(ptr_file_de_messages);
+
+	signaler_places(ptr_file_de_messages, 1);
+
+	return nombre_octets_message_lu;
+}
+
+/*
+ * Les descripteurs de m_fd(). Un eventfd n'est visible que du processus qui l'a créé (et de ses fils) : chaque descripteur
+ * est donc l'extrémité lecture d'une FIFO nommée, /tmp/m_file.<uid>/<pid>.<numero>, inscrite dans la mémoire partagée.
+ * Le répertoire est à l'utilisateur du processus, fermé aux autres (0700) : personne d'autre ne peut y mettre un lien
+ * ou un fichier ordinaire à la place d'une FIFO, dans lequel écriraient les processus qui envoient.
+ * Le contrat est celui d'epoll avec des descripteurs non bloquants : le descripteur reste lisible jusqu'à ce qu'un appel
+ * O_NONBLOCK du processus échoue avec EAGAIN ; cet échec vide la FIFO et réarme le descripteur.
+ * Tant qu'aucun descripteur n'est armé, un envoi ou une lecture ne coûte que la lecture de descripteurs_armes.
+ */
+
+#define REPERTOIRE_FIFO "/tmp/m_file.%lu" // le répertoire des FIFO d'un utilisateur : uid
+#define CHEMIN_FIFO REPERTOIRE_FIFO "/%ld.%u" // le nom de la FIFO d'un descripteur : uid, pid, numero
+
+// Un descripteur ouvert par ce processus
+typedef struct descripteur_local {
+	FILE_DE_MESSAGES* file;
+	int index; // l'abonnement dans file->descripteurs
+	int fd; // l'extrémité lecture, retournée par m_fd()
+	int fd_ecriture; // pour rendre la FIFO lisible soi-même, quand la condition est déjà vraie au moment de réarmer
+	pid_t pid; // un processus fils n'hérite pas des descripteurs de son père
+	char chemin[64];
+	struct descripteur_local* suivant;
+} DESCRIPTEUR_LOCAL ;
+
+// Une FIFO d'un autre processus, gardée ouverte par ce processus pour lui écrire
+typedef struct fifo_ouverte {
+	FILE_DE_MESSAGES* file;
+	int index;
+	uint32_t generation;
+	int fd;
+	struct fifo_ouverte* suivant;
+} FIFO_OUVERTE ;
+
+// Les deux listes sont propres au processus, mais partagées par ses threads : mutex_descripteurs les protège
+static DESCRIPTEUR_LOCAL* descripteurs_locaux = NULL;
+static FIFO_OUVERTE* fifos_ouvertes = NULL;
+static pthread_mutex_t mutex_descripteurs = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic int nombre_descripteurs_locaux = 0; // lu sans le mutex par terminer_echec(), c'est une indication
+
+// Vrai si la condition attendue par un descripteur de cette sorte est vraie (lecture sans le mutex, c'est une indication)
+static int condition_descripteur(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte) {
+
+	if (sorte == ATTENTE_FILE_VIDE)
+		return nombre_messages(ptr_file_de_messages) > 0;
+
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC :
+		case M_MPMC : return nombre_messages(ptr_file_de_messages) < ptr_file_de_messages->capacite;
+		case M_OCTETS : {
+			// Une place pour un message de longueur maximale, comme la calcule allouer_enregistrement()
+			CURSEURS_OCTETS* octets = &ptr_file_de_messages->octets;
+			size_t taille = taille_enregistrement(ptr_file_de_messages->longueur_maximale_message, ptr_file_de_messages->alignement);
+			size_t reste = octets->taille_anneau - octets->queue % octets->taille_anneau;
+			size_t bourrage = reste < taille ? reste : 0;
+
+			return octets->nombre_enregistrements < ptr_file_de_messages->capacite
+			       && (octets->tete == octets->queue || octets->queue - octets->tete + bourrage + taille <= octets->taille_anneau);
+		}
+		default : return ptr_file_de_messages->libre != -1; // les éléments réservés ne sont pas libres
+	}
+}
+
+/**
+ * Le répertoire des FIFO de l'utilisateur uid, créé 0700 s'il n'existe pas. S'il existe, ce doit être un répertoire
+ * (pas un lien) à cet utilisateur, fermé aux autres : sinon un autre utilisateur l'a créé, et pourrait y mettre
+ * n'importe quoi à la place des FIFO. Retourne 0, ou -1 (errno == EACCES).
+ */
+static int preparer_repertoire_fifo(uid_t uid) {
+	char chemin[64];
+	struct stat etat;
+
+	snprintf(chemin, sizeof(chemin), REPERTOIRE_FIFO, (unsigned long) uid);
+
+	// int mkdir (const char *filename, mode_t mode)
+	if (mkdir(chemin, 0700) == -1 && errno != EEXIST) {
+		perror("Fonction mkdir()");
+		return -1; // échec
+	}
+
+	// int lstat (const char *filename, struct stat *buf) : un lien symbolique n'est pas suivi
+	if (lstat(chemin, &etat) == -1) {
+		perror("Fonction lstat()");
+		return -1; // échec
+	}
+
+	if (! S_ISDIR(etat.st_mode) || etat.st_uid != uid || (etat.st_mode & 077) != 0) {
+		fprintf(stderr, "%s n'est pas un répertoire de cet utilisateur fermé aux autres\n", chemin);
+		errno = EACCES;
+		return -1; // échec
+	}
+
+	return 0;
+}
+
+/**
+ * write() sur une FIFO dont le lecteur est parti lève SIGPIPE, qui tuerait l'envoyeur : le signal est bloqué pour ce thread
+ * le temps de l'écriture, et celui qu'elle a levé est retiré avant de rétablir le masque. Un SIGPIPE déjà en attente
+ * (bloqué par l'appelant) est laissé à l'appelant.
+ */
+static ssize_t ecrire_sans_sigpipe(int fd, const void* donnees, size_t taille) {
+	sigset_t sigpipe, masque_appelant, en_attente;
+
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	// int pthread_sigmask (int how, const sigset_t *set, sigset_t *oldset)
+	pthread_sigmask(SIG_BLOCK, &sigpipe, &masque_appelant);
+
+	sigpending(&en_attente);
+	int deja_en_attente = sigismember(&en_attente, SIGPIPE);
+
+	ssize_t ecrit = write(fd, donnees, taille);
+	int errno_write = errno;
+
+	if (ecrit == -1 && errno_write == EPIPE && ! deja_en_attente) {
+		struct timespec immediat = { 0, 0 };
+		// int sigtimedwait (const sigset_t *set, siginfo_t *info, const struct timespec *timeout)
+		while (sigtimedwait(&sigpipe, NULL, &immediat) == -1 && errno == EINTR)
+			;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &masque_appelant, NULL);
+	errno = errno_write;
+
+	return ecrit;
+}
+
+// Rend lisible la FIFO de l'abonnement index, désarmé par l'appelant, qui tient mutex_descripteurs ; retourne 0 si le lecteur n'existe plus
+static int ecrire_fifo(FILE_DE_MESSAGES* ptr_file_de_messages, int index) {
+	ABONNEMENT_DESCRIPTEUR* abonnement = &ptr_file_de_messages->descripteurs[index];
+	FIFO_OUVERTE* fifo;
+
+	for (fifo = fifos_ouvertes ; fifo != NULL ; fifo = fifo->suivant)
+		if (fifo->file == ptr_file_de_messages && fifo->index == index)
+			break;
+
+	if (fifo != NULL && fifo->generation != abonnement->generation) { // un autre descripteur a pris cet abonnement
+		close(fifo->fd);
+		fifo->fd = -1;
+	}
+
+	if (fifo == NULL) {
+		fifo = (FIFO_OUVERTE *) malloc(sizeof(FIFO_OUVERTE));
+		if (fifo == NULL)
+			return 1; // le lecteur n'est pas réveillé, mais l'abonnement reste valable
+		fifo->file = ptr_file_de_messages;
+		fifo->index = index;
+		fifo->fd = -1;
+		fifo->suivant = fifos_ouvertes;
+		fifos_ouvertes = fifo;
+	}
+
+	if (fifo->fd == -1) {
+		char chemin[64];
+		snprintf(chemin, sizeof(chemin), CHEMIN_FIFO, (unsigned long) abonnement->uid, (long) abonnement->pid, abonnement->numero);
+
+		// Sans O_NONBLOCK, open() attendrait un lecteur ; avec, il échoue (ENXIO, ENOENT) si le lecteur n'existe plus.
+		// O_NOFOLLOW : un lien symbolique n'est pas suivi (ELOOP)
+		fifo->fd = open(chemin, O_WRONLY | O_NONBLOCK | O_NOFOLLOW);
+		if (fifo->fd == -1 && errno == ENXIO) // la FIFO d'un processus disparu sans fermer son descripteur
+			unlink(chemin);
+		if (fifo->fd == -1)
+			return errno != ENXIO && errno != ENOENT && errno != ELOOP;
+
+		// Seule une FIFO de l'utilisateur de l'abonnement reçoit l'octet, jamais un fichier mis à sa place
+		struct stat etat;
+		if (fstat(fifo->fd, &etat) == -1 || ! S_ISFIFO(etat.st_mode) || etat.st_uid != abonnement->uid) {
+			close(fifo->fd);
+			fifo->fd = -1;
+			return 0;
+		}
+		fifo->generation = abonnement->generation;
+	}
+
+	// Un seul octet suffit ; EAGAIN : la FIFO est déjà pleine, donc lisible ; EPIPE : le lecteur a fermé sa FIFO
+	char octet = 1;
+	if (ecrire_sans_sigpipe(fifo->fd, &octet, 1) == -1 && errno == EPIPE) {
+		close(fifo->fd);
+		fifo->fd = -1;
+		return 0;
+	}
+
+	return 1;
+}
+
+/**
+ * Après un envoi (sorte == ATTENTE_FILE_VIDE) ou la libération d'une place (sorte == ATTENTE_FILE_PLEINE) :
+ * désarme les descripteurs de cette sorte et rend leur FIFO lisible. La barrière complète sépare la publication
+ * de la lecture de descripteurs_armes : soit nous voyons le descripteur armé, soit celui qui l'arme voit la publication.
+ */
+static void signaler_descripteurs(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte) {
+	int errno_appelant = errno;
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&ptr_file_de_messages->descripteurs_armes[sorte], memory_order_relaxed) == 0)
+		return;
+
+	int i;
+	for (i = 0 ; i < NB_DESCRIPTEURS ; i++) {
+		ABONNEMENT_DESCRIPTEUR* abonnement = &ptr_file_de_messages->descripteurs[i];
+		uint32_t arme = DESCRIPTEUR_ARME;
+
+		if (abonnement->sorte != sorte || atomic_load_explicit(&abonnement->etat, memory_order_relaxed) != DESCRIPTEUR_ARME)
+			continue;
+		if (! atomic_compare_exchange_strong(&abonnement->etat, &arme, DESCRIPTEUR_INSCRIT))
+			continue; // un autre processus l'a désarmé
+
+		atomic_fetch_sub(&ptr_file_de_messages->descripteurs_armes[sorte], 1);
+
+		pthread_mutex_lock(&mutex_descripteurs);
+		int lecteur_present = ecrire_fifo(ptr_file_de_messages, i);
+		pthread_mutex_unlock(&mutex_descripteurs);
+
+		// Le processus qui a ouvert le descripteur a disparu sans le fermer : libérer l'abonnement
+		if (! lecteur_present)
+			atomic_store(&abonnement->etat, DESCRIPTEUR_LIBRE);
+	}
+
+	errno = errno_appelant;
+}
+
+/**
+ * Arme un descripteur de ce processus : vide sa FIFO, l'inscrit parmi les descripteurs armés, puis revérifie la condition ;
+ * si elle est déjà vraie, le processus rend lui-même la FIFO lisible.
+ */
+static void armer_descripteur(DESCRIPTEUR_LOCAL* local) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = local->file;
+	ABONNEMENT_DESCRIPTEUR* abonnement = &ptr_file_de_messages->descripteurs[local->index];
+	char tampon[64];
+	uint32_t inscrit = DESCRIPTEUR_INSCRIT;
+
+	// ssize_t read (int filedes, void *buffer, size_t size) : la FIFO est ouverte avec O_NONBLOCK
+	while (read(local->fd, tampon, sizeof(tampon)) > 0)
+		;
+
+	if (atomic_compare_exchange_strong(&abonnement->etat, &inscrit, DESCRIPTEUR_ARME))
+		atomic_fetch_add(&ptr_file_de_messages->descripteurs_armes[abonnement->sorte], 1);
+
+	if (condition_descripteur(ptr_file_de_messages, abonnement->sorte)) {
+		uint32_t arme = DESCRIPTEUR_ARME;
+		if (atomic_compare_exchange_strong(&abonnement->etat, &arme, DESCRIPTEUR_INSCRIT)) {
+			atomic_fetch_sub(&ptr_file_de_messages->descripteurs_armes[abonnement->sorte], 1);
+
+			char octet = 1;
+			if (write(local->fd_ecriture, &octet, 1) == -1 && errno != EAGAIN)
+				perror("Fonction write()");
+		}
+	}
+}
+
+// Après un EAGAIN : réarme les descripteurs de cette sorte ouverts par ce processus
+static void rearmer_descripteurs(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte) {
+	DESCRIPTEUR_LOCAL* local;
+	pid_t pid = -1;
+
+	pthread_mutex_lock(&mutex_descripteurs);
+	for (local = descripteurs_locaux ; local != NULL ; local = local->suivant) {
+		if (local->file != ptr_file_de_messages || ptr_file_de_messages->descripteurs[local->index].sorte != sorte)
+			continue;
+
+		if (pid == -1)
+			pid = getpid(); // pid_t getpid (void)
+		if (local->pid == pid)
+			armer_descripteur(local);
+	}
+	pthread_mutex_unlock(&mutex_descripteurs);
+
+	errno = EAGAIN;
+}
+
+// Ferme un descripteur de ce processus et libère son abonnement
+static void fermer_descripteur(DESCRIPTEUR_LOCAL* local) {
+	ABONNEMENT_DESCRIPTEUR* abonnement = &local->file->descripteurs[local->index];
+
+	if (local->pid == getpid()) {
+		int sorte = abonnement->sorte; // lue avant de rendre l'abonnement, qu'un autre m_fd() peut aussitôt reprendre
+		if (atomic_exchange(&abonnement->etat, DESCRIPTEUR_LIBRE) == DESCRIPTEUR_ARME)
+			atomic_fetch_sub(&local->file->descripteurs_armes[sorte], 1);
+		unlink(local->chemin); // int unlink (const char *filename)
+	}
+
+	close(local->fd);
+	close(local->fd_ecriture);
+}
+
+/*
+ * Les files durables (m_connexion_fichier) : la validation groupée. Chaque envoi ou lecture réussi compte une opération ;
+ * le processus qui franchit un seuil (cf. DURABILITE) écrit la file sur le disque avec msync(), hors du mutex.
+ * Un seul processus valide à la fois : les autres continuent sans attendre, leurs opérations partent avec la validation suivante.
+ */
+
+// Écrit sur le disque les pages modifiées de la file ; retourne 0, ou -1 (errno de msync)
+static int valider_file(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	DURABILITE* durabilite = &ptr_file_de_messages->durabilite;
+	uint64_t operations = atomic_load_explicit(&durabilite->operations, memory_order_acquire);
+
+	// int msync(void *address, size_t length, int flags) : MS_SYNC attend la fin des écritures
+	if (msync(ptr_file_de_messages, taille_utilisee(ptr_file_de_messages), MS_SYNC) == -1)
+		return -1; // échec
+
+	// L'index de validation ne recule pas : une validation commencée après celle-ci a pu finir avant
+	uint64_t validees = atomic_load_explicit(&durabilite->operations_validees, memory_order_relaxed);
+	while (validees < operations
+	       && ! atomic_compare_exchange_weak_explicit(&durabilite->operations_validees, &validees, operations,
+	                                                  memory_order_release, memory_order_relaxed))
+		;
+	atomic_store_explicit(&durabilite->heure_validation, horloge(), memory_order_relaxed);
+
+	return 0;
+}
+
+// Après nombre opérations réussies : msync() si la file est durable et qu'un seuil de validation est franchi
+static void valider_si_besoin(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre) {
+	if (! ptr_file_de_messages->durable)
+		return;
+
+	DURABILITE* durabilite = &ptr_file_de_messages->durabilite;
+	uint64_t operations = atomic_fetch_add_explicit(&durabilite->operations, nombre, memory_order_release) + nombre;
+	uint64_t en_attente = operations - atomic_load_explicit(&durabilite->operations_validees, memory_order_relaxed);
+
+	int seuil_operations = durabilite->operations_par_validation != 0 && en_attente >= durabilite->operations_par_validation;
+	int seuil_delai = durabilite->delai_validation != 0
+	                  && horloge() - atomic_load_explicit(&durabilite->heure_validation, memory_order_relaxed) >= durabilite->delai_validation;
+	if (! seuil_operations && ! seuil_delai)
+		return;
+
+	// Un processus mort pendant msync() ne bloque pas les validations suivantes
+	pid_t validateur = 0;
+	if (! atomic_compare_exchange_strong(&durabilite->validation_en_cours, &validateur, mon_pid())) {
+		if ( ! (kill(validateur, 0) == -1 && errno == ESRCH)
+		     || ! atomic_compare_exchange_strong(&durabilite->validation_en_cours, &validateur, mon_pid()) )
+			return; // un autre processus valide déjà
+	}
+
+	if (valider_file(ptr_file_de_messages) == -1)
+		perror("Fonction msync()");
+
+	atomic_store(&durabilite->validation_en_cours, 0);
+}
+
+/*
+ * Après chaque appel des fonctions publiques : les statistiques, la validation des files durables, puis les descripteurs de m_fd().
+ */
+
+// Après nombre envois réussis (octets en tout)
+static void terminer_envois(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre, size_t octets) {
+	compter_envois(ptr_file_de_messages, nombre, octets);
+	valider_si_besoin(ptr_file_de_messages, nombre);
+	signaler_descripteurs(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+}
+
+// Après nombre lectures réussies (octets en tout) ; avec m_reception_peek(), la place n'est libre qu'après m_reception_release()
+static void terminer_receptions(FILE_DE_MESSAGES* ptr_file_de_messages, size_t nombre, size_t octets) {
+	compter_receptions(ptr_file_de_messages, nombre, octets);
+	valider_si_besoin(ptr_file_de_messages, nombre);
+	signaler_descripteurs(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+}
+
+/**
+ * Après la lecture d'un message de longueur octets, sa place rendue : un message hors ligne est maintenant copié à l'adresse msg
+ * depuis son objet mémoire (lire_place n'a copié que sa poignée). Retourne longueur, ou -1 si l'objet est illisible :
+ * le message est perdu, errno de shm_open() ou de mmap().
+ */
+static ssize_t achever_reception(FILE_DE_MESSAGES* ptr_file_de_messages, ssize_t longueur, const POIGNEE_HORS_LIGNE* poignee, void* msg) {
+	int erreur = 0;
+
+	if ( (size_t) longueur > ptr_file_de_messages->longueur_maximale_message && recevoir_hors_ligne(poignee, msg, (size_t) longueur) == -1 )
+		erreur = errno;
+
+	terminer_receptions(ptr_file_de_messages, 1, (size_t) longueur);
+
+	if (erreur != 0) {
+		errno = erreur;
+		return -1; // échec
+	}
+	return longueur;
+}
+
+// Après un échec d'un envoi (sorte == ATTENTE_FILE_PLEINE) ou d'une lecture (sorte == ATTENTE_FILE_VIDE)
+static void terminer_echec(FILE_DE_MESSAGES* ptr_file_de_messages, int sorte) {
+	if (errno != EAGAIN)
+		return;
+
+	compter_echec(ptr_file_de_messages, sorte);
+	if (atomic_load_explicit(&nombre_descripteurs_locaux, memory_order_relaxed) > 0)
+		rearmer_descripteurs(ptr_file_de_messages, sorte);
+}
+
+/*
+ * Les moteurs M_DIFFUSION et M_DIFFUSION_ABANDON : chaque message est écrit une fois dans l'anneau, et chaque connexion
+ * en lecture le lit à sa propre position (un LECTEUR_DIFFUSION, placé après la zone des messages).
+ * Les envois prennent leurs positions par compare-and-swap sur mpmc.queue, comme avec M_MPMC ; une position n'est prise
+ * que si tous les lecteurs actifs ont lu le message du tour précédent. Le mutex ne protège que l'arrivée des lecteurs
+ * et le calcul de mpmc.tete, la position du plus lent : les envois ne parcourent les lecteurs que lorsque l'anneau
+ * semble plein. Avec M_DIFFUSION_ABANDON, ce parcours décroche les lecteurs qui retiennent l'anneau plein.
+ */
+
+// Vrai si le lecteur pid n'existe plus (errno est gardé)
+static int lecteur_disparu(pid_t pid) {
+	int errno_appelant = errno;
+	int disparu = pid != mon_pid() && kill(pid, 0) == -1 && errno == ESRCH;
+
+	errno = errno_appelant;
+	return disparu;
+}
+
+/**
+ * Recalcule mpmc.tete, mutex pris : la position du lecteur actif le plus lent, ou mpmc.queue s'il n'y a aucun lecteur.
+ * Un lecteur qui retient l'anneau plein est libéré si son processus n'existe plus, ou décroché avec M_DIFFUSION_ABANDON.
+ * Le décrochage précède la nouvelle valeur de tete : un envoi ne réécrit la place d'un lecteur qu'après l'avoir décroché.
+ */
+static void verifier_lecteurs(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	LECTEUR_DIFFUSION* lecteurs = lecteurs_diffusion(ptr_file_de_messages);
+	uint32_t capacite = (uint32_t) ptr_file_de_messages->capacite;
+	int i;
+
+	verrouiller(ptr_file_de_messages);
+
+	uint32_t queue = atomic_load_explicit(&ptr_file_de_messages->mpmc.queue, memory_order_acquire);
+	uint32_t minimum = queue;
+
+	for (i = 0 ; i < NB_LECTEURS ; i++) {
+		LECTEUR_DIFFUSION* lecteur = &lecteurs[i];
+		if (atomic_load_explicit(&lecteur->etat, memory_order_acquire) != LECTEUR_ACTIF)
+			continue;
+
+		uint32_t position = atomic_load_explicit(&lecteur->position, memory_order_acquire);
+		if (queue - position >= capacite) { // ce lecteur retient l'anneau plein
+			uint32_t actif = LECTEUR_ACTIF;
+
+			if (lecteur_disparu(lecteur->pid)) {
+				atomic_store_explicit(&lecteur->etat, LECTEUR_LIBRE, memory_order_release);
+				continue;
+			}
+			if (ptr_file_de_messages->moteur == M_DIFFUSION_ABANDON
+			    && atomic_compare_exchange_strong_explicit(&lecteur->etat, &actif, LECTEUR_DECROCHE, memory_order_seq_cst, memory_order_seq_cst))
+				continue;
+		}
+
+		if (queue - position > queue - minimum)
+			minimum = position;
+	}
+
+	atomic_store_explicit(&ptr_file_de_messages->mpmc.tete, minimum, memory_order_release);
+
+	deverrouiller(ptr_file_de_messages);
+}
+
+/**
+ * Prend une place de lecteur pour une nouvelle connexion, à la position mpmc.queue : le lecteur lit les messages
+ * envoyés après lui. Avec modele (le lecteur hérité du père par fork()), il prend la position et l'état de modele,
+ * lus mutex pris : tete n'a pas dépassé cette position, et verifier_lecteurs() verra ensuite le nouveau lecteur.
+ * Mutex pris, pour que verifier_lecteurs() voie le nouveau lecteur ou une tete antérieure à sa position.
+ * Retourne l'indice de la place, ou -1 (errno == ENOSPC) si les NB_LECTEURS places sont prises.
+ */
+static int accrocher_lecteur(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* modele) {
+	LECTEUR_DIFFUSION* lecteurs = lecteurs_diffusion(ptr_file_de_messages);
+	int i;
+
+	verrouiller(ptr_file_de_messages);
+
+	uint32_t position = atomic_load_explicit(&ptr_file_de_messages->mpmc.queue, memory_order_acquire);
+	uint32_t etat = LECTEUR_ACTIF;
+	if (modele != NULL && atomic_load_explicit(&modele->etat, memory_order_acquire) != LECTEUR_LIBRE) {
+		position = atomic_load_explicit(&modele->position, memory_order_acquire);
+		etat = atomic_load_explicit(&modele->etat, memory_order_relaxed); // LECTEUR_DECROCHE : la lecture suivante échoue avec EOVERFLOW
+	}
+
+	// Une place libre, ou celle d'un processus qui n'existe plus
+	for (i = 0 ; i < NB_LECTEURS ; i++) {
+		if (atomic_load_explicit(&lecteurs[i].etat, memory_order_acquire) == LECTEUR_LIBRE || lecteur_disparu(lecteurs[i].pid))
+			break;
+	}
+
+	if (i < NB_LECTEURS) {
+		lecteurs[i].pid = mon_pid();
+		atomic_store_explicit(&lecteurs[i].position, position, memory_order_relaxed);
+		atomic_store_explicit(&lecteurs[i].etat, etat, memory_order_seq_cst);
+	}
+
+	deverrouiller(ptr_file_de_messages);
+
+	if (i == NB_LECTEURS) {
+		errno = ENOSPC;
+		return -1; // échec
+	}
+	return i;
+}
+
+// Le lecteur décroché reprend à la position mpmc.queue : les messages qu'il n'a pas lus sont perdus pour lui
+static void raccrocher_lecteur(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur) {
+	verrouiller(ptr_file_de_messages);
+	atomic_store_explicit(&lecteur->position, atomic_load_explicit(&ptr_file_de_messages->mpmc.queue, memory_order_acquire), memory_order_relaxed);
+	atomic_store_explicit(&lecteur->etat, LECTEUR_ACTIF, memory_order_seq_cst);
+	deverrouiller(ptr_file_de_messages);
+}
+
+// Rend la place du lecteur ; les envois qui l'attendaient peut-être revérifient
+static void decrocher_lecteur(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur) {
+	atomic_store_explicit(&lecteur->etat, LECTEUR_LIBRE, memory_order_seq_cst);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_plein, &ptr_file_de_messages->mpmc.producteurs_en_attente, INT_MAX);
+}
+
+/**
+ * Le lecteur de cette connexion pour ce processus, ou NULL si elle n'en a pas. Un enfant créé par fork() hérite de
+ * la connexion, mais le lecteur reste celui du père : à sa première lecture, l'enfant prend sa propre place,
+ * à la position qu'a alors le lecteur du père, et lit ensuite tous les messages, comme lui.
+ * Retourne aussi NULL (errno == ENOSPC) si l'enfant ne trouve pas de place libre.
+ */
+static LECTEUR_DIFFUSION* lecteur_diffusion(MESSAGE* file) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+
+	if (file->lecteur == -1)
+		return NULL;
+
+	if (file->pid_lecteur != mon_pid()) {
+		int lecteur = accrocher_lecteur(ptr_file_de_messages, &lecteurs_diffusion(ptr_file_de_messages)[file->lecteur]);
+		if (lecteur == -1)
+			return NULL; // échec, errno == ENOSPC
+		file->lecteur = lecteur;
+		file->pid_lecteur = mon_pid();
+	}
+
+	return &lecteurs_diffusion(ptr_file_de_messages)[file->lecteur];
+}
+
+/**
+ * Essaie de prendre une position pour un envoi des moteurs M_DIFFUSION : la place doit avoir été lue par tous
+ * les lecteurs (mpmc.tete, recalculée au plus une fois) et publiée par l'envoi du tour précédent.
+ * Retourne l'élément réservé, ou NULL si l'anneau est plein. La position prise est gardée dans numero_ordre.
+ */
+static FILE_ELEMENT* essayer_envoi_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	uint32_t capacite = (uint32_t) ptr_file_de_messages->capacite;
+	uint32_t queue = atomic_load_explicit(&mpmc->queue, memory_order_relaxed);
+	int verifie = 0;
+
+	for (;;) {
+		if ( (int32_t) ( queue - atomic_load_explicit(&mpmc->tete, memory_order_acquire) ) >= (int32_t) capacite ) {
+			if (verifie)
+				return NULL; // pleine
+
+			// Peut-être pleine : recalculer la position du lecteur le plus lent
+			verifier_lecteurs(ptr_file_de_messages);
+			verifie = 1;
+			queue = atomic_load_explicit(&mpmc->queue, memory_order_relaxed);
+			continue;
+		}
+
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, queue & (capacite - 1));
+		if (atomic_load_explicit(&element->sequence, memory_order_acquire) != queue + 1 - capacite) {
+			// L'envoi du tour précédent n'a pas encore publié, ou un autre envoi a déjà pris cette position
+			uint32_t actuelle = atomic_load_explicit(&mpmc->queue, memory_order_relaxed);
+			if (actuelle == queue)
+				return NULL;
+			queue = actuelle;
+			continue;
+		}
+
+		if (atomic_compare_exchange_weak_explicit(&mpmc->queue, &queue, queue + 1, memory_order_relaxed, memory_order_relaxed)) {
+			element->numero_ordre = queue;
+			return element;
+		}
+	}
+}
+
+// Réserve un élément pour un envoi des moteurs M_DIFFUSION, en dormant sur signal_non_plein tant que l'anneau est plein
+static FILE_ELEMENT* reserver_envoi_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, int msgflag) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	FILE_ELEMENT* element;
+
+	while ( (element = essayer_envoi_diffusion(ptr_file_de_messages)) == NULL ) { // Si pas de place dans la file
+
+		switch(msgflag) {
+			case O_NONBLOCK : errno = EAGAIN; // errno prend la valeur EAGAIN
+			                  return NULL; // échec
+			case 0 : break; // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		// Pas d'attente active : chaque essai d'un anneau plein parcourt les lecteurs, mutex pris
+		uint64_t debut = horloge();
+		uint32_t signal = atomic_load_explicit(&mpmc->signal_non_plein, memory_order_acquire);
+		atomic_fetch_add_explicit(&mpmc->producteurs_en_attente, 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+
+		element = essayer_envoi_diffusion(ptr_file_de_messages);
+		if (element == NULL)
+			futex_attendre(ptr_file_de_messages, &mpmc->signal_non_plein, signal);
+
+		atomic_fetch_sub_explicit(&mpmc->producteurs_en_attente, 1, memory_order_relaxed);
+
+		compter_attente(ptr_file_de_messages, ATTENTE_FILE_PLEINE, debut);
+		if (element != NULL)
+			break;
+	}
+
+	return element;
+}
+
+/**
+ * Publie le message pour tous les lecteurs, puis réveille les lecteurs endormis, et les envois qui attendent
+ * que cette place soit publiée pour la reprendre au tour suivant.
+ */
+static void publier_envoi_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	atomic_store_explicit(&element->sequence, (uint32_t) element->numero_ordre + 1, memory_order_release);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_vide, &ptr_file_de_messages->mpmc.consommateurs_en_attente, INT_MAX);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_plein, &ptr_file_de_messages->mpmc.producteurs_en_attente, INT_MAX);
+}
+
+/**
+ * Le message à la position du lecteur est lu : le lecteur avance, puis les envois qui attendent une place sont réveillés.
+ * Retourne -1 (errno == EOVERFLOW) si le lecteur a été décroché pendant la lecture : le message a peut-être été réécrit,
+ * ce qui en a été lu n'est pas fiable. La barrière ordonne la lecture du message avant celle de etat.
+ */
+static int liberer_reception_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur) {
+	atomic_thread_fence(memory_order_acquire);
+	if (atomic_load_explicit(&lecteur->etat, memory_order_relaxed) != LECTEUR_ACTIF) {
+		errno = EOVERFLOW;
+		return -1; // échec
+	}
+
+	uint32_t position = atomic_load_explicit(&lecteur->position, memory_order_relaxed);
+	atomic_store_explicit(&lecteur->position, position + 1, memory_order_release);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_plein, &ptr_file_de_messages->mpmc.producteurs_en_attente, INT_MAX);
+
+	return 0;
+}
+
+/**
+ * Le message à la position du lecteur, s'il est publié et tient dans len octets (les messages périmés sont passés) ; sa longueur est lue une seule fois,
+ * dans *longueur (avec M_DIFFUSION_ABANDON, l'élément peut être réécrit dès que le lecteur est décroché).
+ * Retourne NULL en cas d'échec : errno == EAGAIN, EMSGSIZE, ou EOVERFLOW si le lecteur a été décroché
+ * (il est alors raccroché à la position mpmc.queue).
+ */
+static FILE_ELEMENT* essayer_reception_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur, size_t len, size_t* longueur) {
+	FILE_ELEMENT* element;
+
+	for (;;) {
+		if (atomic_load_explicit(&lecteur->etat, memory_order_acquire) != LECTEUR_ACTIF) {
+			raccrocher_lecteur(ptr_file_de_messages, lecteur);
+			errno = EOVERFLOW;
+			return NULL; // échec
+		}
+
+		uint32_t position = atomic_load_explicit(&lecteur->position, memory_order_relaxed); // seul ce lecteur écrit sa position
+		element = element_file(ptr_file_de_messages, position & ((uint32_t) ptr_file_de_messages->capacite - 1));
+
+		if (atomic_load_explicit(&element->sequence, memory_order_acquire) != position + 1) {
+			errno = EAGAIN;
+			return NULL; // pas encore publié
+		}
+
+		if (! element_perime(element))
+			break;
+
+		// Message périmé : ce lecteur le passe sans le lire
+		if (liberer_reception_diffusion(ptr_file_de_messages, lecteur) == 0)
+			compter_perimes(ptr_file_de_messages, 1);
+	}
+
+	*longueur = (size_t) element->longueur_message;
+	if (len < *longueur || *longueur > ptr_file_de_messages->longueur_maximale_message) {
+		errno = EMSGSIZE;
+		return NULL; // échec : le message reste à lire
+	}
+
+	return element;
+}
+
+// Réserve le prochain message du lecteur, symétrique de reserver_envoi_diffusion() ; les lecteurs dorment sur signal_non_vide
+static FILE_ELEMENT* reserver_reception_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur, size_t len,
+                                                  size_t* longueur, int flags) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	FILE_ELEMENT* element;
+
+	while ( (element = essayer_reception_diffusion(ptr_file_de_messages, lecteur, len, longueur)) == NULL ) {
+
+		if (errno != EAGAIN)
+			return NULL; // échec
+
+		switch(flags) { // Si aucun nouveau message
+			case O_NONBLOCK : return NULL; // échec, errno == EAGAIN
+			case 0 : break; // L’appel est bloquant jusqu’à ce que la lecture réussisse.
+			default : return NULL; // échec
+		}
+
+		if (echeance_depassee())
+			return NULL; // échec, errno == ETIMEDOUT
+
+		uint64_t debut = horloge();
+		uint32_t position = atomic_load_explicit(&lecteur->position, memory_order_relaxed);
+		_Atomic uint32_t* sequence = &element_file(ptr_file_de_messages, position & ((uint32_t) ptr_file_de_messages->capacite - 1))->sequence;
+
+		// Tourner un peu sur la sequence de l'élément attendu, puis s'inscrire et dormir
+		if (! attendre_activement(sequence, atomic_load_explicit(sequence, memory_order_relaxed))) {
+			uint32_t signal = atomic_load_explicit(&mpmc->signal_non_vide, memory_order_acquire);
+			atomic_fetch_add_explicit(&mpmc->consommateurs_en_attente, 1, memory_order_relaxed);
+			atomic_thread_fence(memory_order_seq_cst);
+
+			if (atomic_load_explicit(sequence, memory_order_acquire) != position + 1
+			    && atomic_load_explicit(&lecteur->etat, memory_order_relaxed) == LECTEUR_ACTIF)
+				futex_attendre(ptr_file_de_messages, &mpmc->signal_non_vide, signal);
+
+			atomic_fetch_sub_explicit(&mpmc->consommateurs_en_attente, 1, memory_order_relaxed);
+		}
+
+		compter_attente(ptr_file_de_messages, ATTENTE_FILE_VIDE, debut);
+	}
+
+	return element;
+}
+
+// Lit le prochain message du lecteur dans msg ; retourne sa longueur, ou -1 (errno == EAGAIN, EMSGSIZE ou EOVERFLOW)
+static ssize_t reception_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur, void* msg, size_t len, int flags) {
+	size_t longueur;
+
+	FILE_ELEMENT* element = reserver_reception_diffusion(ptr_file_de_messages, lecteur, len, &longueur, flags);
+	if (element == NULL)
+		return -1; // échec
+
+	copier_reception(msg, message_element(ptr_file_de_messages, element), longueur);
+
+	if (liberer_reception_diffusion(ptr_file_de_messages, lecteur) == -1) {
+		raccrocher_lecteur(ptr_file_de_messages, lecteur);
+		return -1; // échec, errno == EOVERFLOW
+	}
+
+	return (ssize_t) longueur;
+}
+
+/* Les deux phases, pour tous les moteurs */
+
+// Les moteurs sans verrou n'utilisent ni le mutex ni les canaux d'attente (M_DIFFUSION : sauf quand l'anneau semble plein)
+static int moteur_sans_verrou(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return ptr_file_de_messages->moteur == M_SPSC || ptr_file_de_messages->moteur == M_MPMC || moteur_diffusion(ptr_file_de_messages->moteur);
+}
+
+// Les moteurs à anneau ne lisent que dans l'ordre d'arrivée : ils ne savent pas chercher un message d'un type donné
+static int lecture_fifo_seulement(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	return moteur_sans_verrou(ptr_file_de_messages) || ptr_file_de_messages->moteur == M_OCTETS;
+}
+
+/**
+ * L'élément dont zone est le contenu (une adresse retournée par m_envoi_reserve ou m_reception_peek),
+ * ou NULL si zone n'est le contenu d'aucun élément de la file.
+ */
+static FILE_ELEMENT* element_de_zone(FILE_DE_MESSAGES* ptr_file_de_messages, const void* zone) {
+	size_t taille = ptr_file_de_messages->taille_place;
+	char* debut = debut_messages(ptr_file_de_messages);
+
+	if ((char *) zone < debut || (char *) zone >= debut + ptr_file_de_messages->capacite * taille)
+		return NULL;
+	if (( (char *) zone - debut ) % taille != 0)
+		return NULL;
+
+	return element_file(ptr_file_de_messages, ( (char *) zone - debut ) / taille);
+}
+
+// Réserve un élément où écrire un message ; NULL en cas d'échec (errno == EAGAIN si la file est pleine et msgflag == O_NONBLOCK)
+static FILE_ELEMENT* reserver_envoi(FILE_DE_MESSAGES* ptr_file_de_messages, int msgflag) {
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC : return reserver_envoi_spsc(ptr_file_de_messages, msgflag);
+		case M_MPMC : return reserver_envoi_mpmc(ptr_file_de_messages, msgflag);
+		case M_DIFFUSION :
+		case M_DIFFUSION_ABANDON : return reserver_envoi_diffusion(ptr_file_de_messages, msgflag);
+	}
+
+	verrouiller(ptr_file_de_messages);
+	int index_libre = prendre_element_libre(ptr_file_de_messages, msgflag);
+	deverrouiller(ptr_file_de_messages);
+
+	return index_libre == -1 ? NULL : element_file(ptr_file_de_messages, index_libre);
+}
+
+// Publie le message de len octets écrit dans un élément réservé par reserver_envoi()
+static void publier_envoi(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element, long type, size_t len) {
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC :
+		case M_MPMC :
+		case M_DIFFUSION :
+		case M_DIFFUSION_ABANDON :
+			element->longueur_message = len;
+			element->type = type;
+			element->peremption = peremption_envoi();
+
+			if (ptr_file_de_messages->moteur == M_SPSC)
+				publier_envoi_spsc(ptr_file_de_messages, 1);
+			else if (ptr_file_de_messages->moteur == M_MPMC)
+				publier_envoi_mpmc(ptr_file_de_messages, element);
+			else
+				publier_envoi_diffusion(ptr_file_de_messages, element);
+			break;
+
+		default :
+			verrouiller(ptr_file_de_messages);
+			publier_element(ptr_file_de_messages, index_element(ptr_file_de_messages, element), type, len);
+			deverrouiller(ptr_file_de_messages);
+
+			signaler_messages(ptr_file_de_messages, canal_type(type), 1);
+	}
+
+	envoyer_notifications(ptr_file_de_messages, type);
+}
+
+/**
+ * Réserve le message à lire pour la demande type, s'il tient dans len octets : il n'est plus dans la file,
+ * mais son élément n'est pas libre tant que liberer_reception() n'est pas appelée.
+ * Retourne NULL en cas d'échec (errno == EAGAIN, EMSGSIZE ou EINVAL).
+ */
+static FILE_ELEMENT* reserver_reception(FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, long type, int flags) {
+
+	if (moteur_sans_verrou(ptr_file_de_messages)) {
+		// L'anneau ne garde que l'ordre d'arrivée : il ne sait pas chercher un message d'un type donné
+		if (type != 0) {
+			errno = EINVAL;
+			return NULL; // échec
+		}
+
+		if (ptr_file_de_messages->moteur == M_SPSC)
+			return reserver_reception_spsc(ptr_file_de_messages, len, flags);
+		return reserver_reception_mpmc(ptr_file_de_messages, len, flags);
+	}
+
+	verrouiller(ptr_file_de_messages);
+	int index_message = chercher_message(ptr_file_de_messages, len, type, flags);
+	if (index_message != -1)
+		retirer_message(ptr_file_de_messages, index_message);
+	deverrouiller(ptr_file_de_messages);
+
+	return index_message == -1 ? NULL : element_file(ptr_file_de_messages, index_message);
+}
+
+// Libère l'élément d'un message réservé par reserver_reception()
+static void liberer_reception(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC : liberer_reception_spsc(ptr_file_de_messages, 1);
+		              return;
+		case M_MPMC : liberer_reception_mpmc(ptr_file_de_messages, element);
+		              return;
+	}
+
+	verrouiller(ptr_file_de_messages);
+	rendre_element_libre(ptr_file_de_messages, index_element(ptr_file_de_messages, element));
+	deverrouiller(ptr_file_de_messages);
+
+	signaler_places(ptr_file_de_messages, 1);
+}
+
+/*
+ * Les lots : m_envoi_lot() et m_reception_lot() traitent plusieurs messages avec une seule synchronisation
+ * (une section critique, ou une publication des curseurs des anneaux) et un seul réveil par lot.
+ * Chaque fonction retourne le nombre de messages traités ; elle n'attend que tant qu'elle n'a rien pu traiter,
+ * sauf l'envoi bloquant qui attend une place pour chaque message du lot.
+ */
+
+// Écrit le message msg de len octets dans l'élément
+static void ecrire_element(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element, const struct mon_message* msg, size_t len) {
+	element->longueur_message = len;
+	element->type = msg->type;
+	element->peremption = peremption_envoi();
+
+	//void * memmove (void *to, const void *from, size_t size)
+	memmove(message_element(ptr_file_de_messages, element), msg->mtext, len);
+}
+
+// Envoie un lot par l'anneau M_SPSC : les messages qui tiennent dans les places libres sont publiés d'un coup
+static size_t envoi_lot_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msgs, const size_t* lens, size_t nb, int msgflag) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t capacite = (uint32_t) ptr_file_de_messages->capacite;
+	size_t envoyes = 0;
+
+	while (envoyes < nb) {
+		uint32_t queue = atomic_load_explicit(&spsc->queue, memory_order_relaxed);
+		uint32_t libres = capacite - (queue - spsc->tete_locale);
+
+		if (libres == 0) { // Peut-être pleine : relire la vraie valeur de tete, puis attendre si besoin
+			spsc->tete_locale = atomic_load_explicit(&spsc->tete, memory_order_acquire);
+			libres = capacite - (queue - spsc->tete_locale);
+		}
+		if (libres == 0) {
+			if (reserver_envoi_spsc(ptr_file_de_messages, msgflag) == NULL)
+				break; // la file est pleine et msgflag == O_NONBLOCK
+			continue;
+		}
+
+		uint32_t i, nombre = nb - envoyes < libres ? (uint32_t) (nb - envoyes) : libres;
+		for (i = 0 ; i < nombre ; i++)
+			ecrire_element(ptr_file_de_messages, element_file(ptr_file_de_messages, (queue + i) & (capacite - 1)), &msgs[envoyes + i], lens[envoyes + i]);
+
+		publier_envoi_spsc(ptr_file_de_messages, nombre);
+		envoyes += nombre;
+	}
+
+	return envoyes;
+}
+
+// Reçoit un lot par l'anneau M_SPSC : les messages disponibles sont libérés d'un coup
+static size_t reception_lot_spsc(FILE_DE_MESSAGES* ptr_file_de_messages, void** msgs, size_t* lens, size_t nb, int flags) {
+	CURSEURS_SPSC* spsc = &ptr_file_de_messages->spsc;
+	uint32_t masque = (uint32_t) ptr_file_de_messages->capacite - 1;
+	size_t recus = 0;
+
+	// Attendre le premier message (reserver_reception_spsc vérifie aussi sa longueur)
+	if (reserver_reception_spsc(ptr_file_de_messages, lens[0], flags) == NULL)
+		return 0;
+
+	uint32_t tete = atomic_load_explicit(&spsc->tete, memory_order_relaxed);
+	uint32_t disponibles = spsc->queue_locale - tete;
+	uint32_t lus = 0, perimes = 0; // les places rendues : messages copiés et messages périmés
+
+	while (recus < nb && lus < disponibles) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, (tete + lus) & masque);
+
+		if (element_perime(element)) { // jeté sans être lu
+			jeter_hors_ligne(ptr_file_de_messages, element);
+			lus++;
+			perimes++;
+			continue;
+		}
+
+		if (lens[recus] < element->longueur_message) // Le message reste dans la file si msgs[recus] est trop petit
+			break;
+
+		// Un message hors ligne n'y laisse que sa poignée (cf. m_reception_lot)
+		lire_place(ptr_file_de_messages, element, msgs[recus], msgs[recus]);
+		lens[recus] = element->longueur_message;
+		recus++;
+		lus++;
+	}
+
+	liberer_reception_spsc(ptr_file_de_messages, lus);
+	if (perimes > 0)
+		compter_perimes(ptr_file_de_messages, perimes);
+
+	return recus;
+}
+
+// Envoie un lot par l'anneau M_MPMC : chaque message est publié dès qu'il est écrit, les consommateurs sont réveillés une fois
+static size_t envoi_lot_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msgs, const size_t* lens, size_t nb, int msgflag) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	size_t envoyes = 0;
+	int a_reveiller = 0;
+
+	while (envoyes < nb) {
+		FILE_ELEMENT* element = essayer_envoi_mpmc(ptr_file_de_messages);
+
+		if (element == NULL) { // Pleine : réveiller les consommateurs des messages déjà publiés avant d'attendre
+			if (a_reveiller > 0)
+				reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_vide, &mpmc->consommateurs_en_attente, a_reveiller);
+			a_reveiller = 0;
+
+			element = reserver_envoi_mpmc(ptr_file_de_messages, msgflag);
+			if (element == NULL)
+				break; // la file est pleine et msgflag == O_NONBLOCK
+		}
+
+		ecrire_element(ptr_file_de_messages, element, &msgs[envoyes], lens[envoyes]);
+
+		uint32_t position = atomic_load_explicit(&element->sequence, memory_order_relaxed);
+		atomic_store_explicit(&element->sequence, position + 1, memory_order_release);
+
+		envoyes++;
+		a_reveiller++;
+	}
+
+	if (a_reveiller > 0)
+		reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_vide, &mpmc->consommateurs_en_attente, a_reveiller);
+
+	return envoyes;
+}
+
+// Reçoit un lot par l'anneau M_MPMC : chaque élément est rendu dès qu'il est lu, les producteurs sont réveillés une fois
+static size_t reception_lot_mpmc(FILE_DE_MESSAGES* ptr_file_de_messages, void** msgs, size_t* lens, size_t nb, int flags) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	size_t recus = 0;
+
+	while (recus < nb) {
+		FILE_ELEMENT* element;
+
+		if (recus == 0)
+			element = reserver_reception_mpmc(ptr_file_de_messages, lens[recus], flags);
+		else
+			element = essayer_reception_mpmc(ptr_file_de_messages, lens[recus]);
+		if (element == NULL)
+			break; // vide, ou message trop long : il reste dans la file
+
+		// Un message hors ligne n'y laisse que sa poignée (cf. m_reception_lot)
+		lire_place(ptr_file_de_messages, element, msgs[recus], msgs[recus]);
+		lens[recus] = element->longueur_message;
+
+		uint32_t position = atomic_load_explicit(&element->sequence, memory_order_relaxed) - 1;
+		atomic_store_explicit(&element->sequence, position + (uint32_t) ptr_file_de_messages->capacite, memory_order_release);
+
+		recus++;
+	}
+
+	if (recus > 0)
+		reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_plein, &mpmc->producteurs_en_attente, recus < INT_MAX ? (int) recus : INT_MAX);
+
+	return recus;
+}
+
+// Envoie un lot par l'anneau des moteurs M_DIFFUSION : chaque message est publié dès qu'il est écrit, les lecteurs sont réveillés une fois
+static size_t envoi_lot_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msgs, const size_t* lens, size_t nb, int msgflag) {
+	CURSEURS_MPMC* mpmc = &ptr_file_de_messages->mpmc;
+	size_t envoyes = 0;
+	int a_reveiller = 0;
+
+	while (envoyes < nb) {
+		FILE_ELEMENT* element = essayer_envoi_diffusion(ptr_file_de_messages);
+
+		if (element == NULL) { // Pleine : réveiller les lecteurs des messages déjà publiés avant d'attendre
+			if (a_reveiller > 0)
+				reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_vide, &mpmc->consommateurs_en_attente, INT_MAX);
+			a_reveiller = 0;
+
+			element = reserver_envoi_diffusion(ptr_file_de_messages, msgflag);
+			if (element == NULL)
+				break; // la file est pleine et msgflag == O_NONBLOCK
+		}
+
+		ecrire_element(ptr_file_de_messages, element, &msgs[envoyes], lens[envoyes]);
+		atomic_store_explicit(&element->sequence, (uint32_t) element->numero_ordre + 1, memory_order_release);
+
+		envoyes++;
+		a_reveiller++;
+	}
+
+	if (a_reveiller > 0) {
+		reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_vide, &mpmc->consommateurs_en_attente, INT_MAX);
+		reveiller_mpmc(ptr_file_de_messages, &mpmc->signal_non_plein, &mpmc->producteurs_en_attente, INT_MAX);
+	}
+
+	return envoyes;
+}
+
+/**
+ * Reçoit un lot des messages du lecteur : sa position n'avance qu'une fois, après la copie de tout le lot.
+ * Avec M_DIFFUSION_ABANDON, un lecteur décroché pendant la copie ne reçoit rien (errno == EOVERFLOW).
+ */
+static size_t reception_lot_diffusion(FILE_DE_MESSAGES* ptr_file_de_messages, LECTEUR_DIFFUSION* lecteur, void** msgs, size_t* lens, size_t nb, int flags) {
+	uint32_t capacite = (uint32_t) ptr_file_de_messages->capacite;
+	size_t recus = 0, longueur;
+
+	FILE_ELEMENT* element = reserver_reception_diffusion(ptr_file_de_messages, lecteur, lens[0], &longueur, flags);
+	if (element == NULL)
+		return 0; // vide, décroché, ou message trop long : il reste à lire
+
+	uint32_t position = atomic_load_explicit(&lecteur->position, memory_order_relaxed); // seul ce lecteur écrit sa position
+	uint32_t lus = 0, perimes = 0; // les positions passées : messages copiés et messages périmés
+	while (recus < nb) {
+		if (recus > 0) { // les messages suivants, s'ils sont déjà publiés et tiennent dans leur mémoire
+			element = element_file(ptr_file_de_messages, (position + lus) & (capacite - 1));
+			if (atomic_load_explicit(&element->sequence, memory_order_acquire) != position + lus + 1)
+				break;
+			if (element_perime(element)) { // passé sans être lu
+				lus++;
+				perimes++;
+				continue;
+			}
+			longueur = (size_t) element->longueur_message;
+			if (lens[recus] < longueur || longueur > ptr_file_de_messages->longueur_maximale_message)
+				break;
+		}
+
+		// void * memmove (void *to, const void *from, size_t size)
+		memmove(msgs[recus], message_element(ptr_file_de_messages, element), longueur);
+		lens[recus] = longueur;
+		recus++;
+		lus++;
+	}
+
+	atomic_thread_fence(memory_order_acquire); // les lectures des messages avant la vérification de etat
+	if (atomic_load_explicit(&lecteur->etat, memory_order_relaxed) != LECTEUR_ACTIF) {
+		raccrocher_lecteur(ptr_file_de_messages, lecteur);
+		errno = EOVERFLOW;
+		return 0; // échec
+	}
+
+	atomic_store_explicit(&lecteur->position, position + lus, memory_order_release);
+	reveiller_mpmc(ptr_file_de_messages, &ptr_file_de_messages->mpmc.signal_non_plein, &ptr_file_de_messages->mpmc.producteurs_en_attente, INT_MAX);
+	if (perimes > 0)
+		compter_perimes(ptr_file_de_messages, perimes);
+
+	return recus;
+}
+
+// Envoie un lot dans une seule section critique des moteurs M_MUTEX et M_PRIORITE
+static size_t envoi_lot_verrou(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msgs, const size_t* lens, size_t nb, int msgflag) {
+	size_t envoyes = 0, a_signaler = 0;
+	uint32_t canaux = 0;
+
+	verrouiller(ptr_file_de_messages);
+
+	while (envoyes < nb) {
+
+		// Pleine au milieu du lot : les lectures doivent voir les messages déjà publiés avant que l'envoi n'attende
+		if (ptr_file_de_messages->libre == -1 && a_signaler > 0 && msgflag == 0) {
+			signaler_messages(ptr_file_de_messages, canaux, a_signaler);
+			a_signaler = 0;
+			canaux = 0;
+		}
+
+		int index_libre = prendre_element_libre(ptr_file_de_messages, msgflag);
+		if (index_libre == -1)
+			break; // la file est pleine et msgflag == O_NONBLOCK
+
+		// Le message est copié avant d'être chaîné : un lecteur ne peut pas voir un élément à moitié rempli
+		//void * memmove (void *to, const void *from, size_t size)
+		memmove(place_message(ptr_file_de_messages, index_libre), msgs[envoyes].mtext, lens[envoyes]);
+		publier_element(ptr_file_de_messages, index_libre, msgs[envoyes].type, lens[envoyes]);
+
+		canaux |= canal_type(msgs[envoyes].type);
+		envoyes++;
+		a_signaler++;
+	}
+
+	deverrouiller(ptr_file_de_messages);
+
+	if (a_signaler > 0)
+		signaler_messages(ptr_file_de_messages, canaux, a_signaler);
+
+	return envoyes;
+}
+
+// Reçoit un lot dans une seule section critique des moteurs M_MUTEX et M_PRIORITE
+static size_t reception_lot_verrou(FILE_DE_MESSAGES* ptr_file_de_messages, void** msgs, size_t* lens, size_t nb, long type, int flags) {
+	size_t recus = 0;
+
+	verrouiller(ptr_file_de_messages);
+
+	while (recus < nb) {
+
+		// N'attendre que le premier message du lot
+		int index_message = chercher_message(ptr_file_de_messages, lens[recus], type, recus == 0 ? flags : O_NONBLOCK);
+		if (index_message == -1)
+			break; // pas de message du type demandé, ou message trop long : il reste dans la file
+
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_message);
+
+		// Un message hors ligne n'y laisse que sa poignée (cf. m_reception_lot)
+		lire_place(ptr_file_de_messages, element, msgs[recus], msgs[recus]);
+		lens[recus] = element->longueur_message;
+
+		retirer_message(ptr_file_de_messages, index_message);
+		rendre_element_libre(ptr_file_de_messages, index_message);
+		recus++;
+	}
+
+	deverrouiller(ptr_file_de_messages);
+
+	if (recus > 0)
+		signaler_places(ptr_file_de_messages, recus);
+
+	return recus;
+}
+
+// Envoie un lot dans une seule section critique du moteur M_OCTETS
+static size_t envoi_lot_octets(FILE_DE_MESSAGES* ptr_file_de_messages, const struct mon_message* msgs, const size_t* lens, size_t nb, int msgflag) {
+	size_t envoyes = 0, a_signaler = 0;
+
+	verrouiller(ptr_file_de_messages);
+
+	while (envoyes < nb) {
+		ENREGISTREMENT* enregistrement = allouer_enregistrement(ptr_file_de_messages, lens[envoyes], O_NONBLOCK);
+
+		// Pleine au milieu du lot : les lectures doivent voir les messages déjà publiés avant que l'envoi n'attende
+		if (enregistrement == NULL && msgflag == 0) {
+			if (a_signaler > 0)
+				signaler_messages(ptr_file_de_messages, 0, a_signaler);
+			a_signaler = 0;
+
+			enregistrement = allouer_enregistrement(ptr_file_de_messages, lens[envoyes], msgflag);
+		}
+		if (enregistrement == NULL)
+			break; // la file est pleine et msgflag == O_NONBLOCK
+
+		//void * memmove (void *to, const void *from, size_t size)
+		memmove(enregistrement + 1, msgs[envoyes].mtext, lens[envoyes]);
+		publier_enregistrement(ptr_file_de_messages, enregistrement, msgs[envoyes].type, lens[envoyes]);
+
+		envoyes++;
+		a_signaler++;
+	}
+
+	deverrouiller(ptr_file_de_messages);
+
+	if (a_signaler > 0)
+		signaler_messages(ptr_file_de_messages, 0, a_signaler);
+
+	return envoyes;
+}
+
+// Reçoit un lot dans une seule section critique du moteur M_OCTETS
+static size_t reception_lot_octets(FILE_DE_MESSAGES* ptr_file_de_messages, void** msgs, size_t* lens, size_t nb, int flags) {
+	size_t recus = 0;
+
+	verrouiller(ptr_file_de_messages);
+
+	while (recus < nb) {
+
+		// N'attendre que le premier message du lot
+		ENREGISTREMENT* enregistrement = chercher_enregistrement(ptr_file_de_messages, lens[recus], recus == 0 ? flags : O_NONBLOCK);
+		if (enregistrement == NULL)
+			break; // pas de message, ou message trop long : il reste dans la file
+
+		// void * memmove (void *to, const void *from, size_t size)
+		memmove(msgs[recus], enregistrement + 1, enregistrement->longueur);
+		lens[recus] = enregistrement->longueur;
+
+		retirer_enregistrement(ptr_file_de_messages, enregistrement);
+		liberer_enregistrement(ptr_file_de_messages, enregistrement);
+		recus++;
+	}
+
+	deverrouiller(ptr_file_de_messages);
+
+	if (recus > 0)
+		signaler_places(ptr_file_de_messages, recus);
+
+	return recus;
+}
+
+/*
+ * Le redimensionnement des files M_MUTEX et M_PRIORITE (m_redimensionner). La zone des messages finit l'objet mémoire,
+ * et chaque processus projette dès sa connexion toute la place de la file à capacite_maximale : changer la capacité
+ * ne change aucune adresse. Les autres processus apprennent le changement par generation, à leur opération suivante.
+ */
+
+/**
+ * La file a changé de taille depuis la dernière opération de ce processus : M_PRECHARGE et M_MLOCK s'étendent aux places
+ * ajoutées, mutex pris pour que la file ne rétrécisse pas pendant ce temps. Une connexion de m_observation ne peut pas
+ * prendre le mutex (PROT_READ) : ses nouvelles places sont seulement projetées, comme sans ces options.
+ */
+static void suivre_redimensionnement(MESSAGE* file) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+
+	if (file->options_projection == 0 || file->observation) {
+		file->generation = atomic_load_explicit(&ptr_file_de_messages->generation, memory_order_acquire);
+		return;
+	}
+
+	verrouiller(ptr_file_de_messages);
+
+	file->generation = atomic_load_explicit(&ptr_file_de_messages->generation, memory_order_relaxed);
+	size_t taille = taille_utilisee(ptr_file_de_messages);
+	if (taille > file->taille_utile) {
+		size_t page = (size_t) sysconf(_SC_PAGESIZE);
+		size_t debut = file->taille_utile / page * page;
+		char* adresse = (char *) ptr_file_de_messages + debut;
+
+		// Au-delà de RLIMIT_MEMLOCK, les nouvelles places restent simplement hors de mlock()
+		if (file->options_projection & M_MLOCK)
+			mlock(adresse, taille - debut);
+		else
+			toucher_pages(adresse, taille - debut);
+	}
+	file->taille_utile = taille;
+
+	deverrouiller(ptr_file_de_messages);
+}
+
+// La file de messages de la connexion file, au début de chaque fonction publique
+static FILE_DE_MESSAGES* file_de_messages(MESSAGE* file) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+
+	if (atomic_load_explicit(&ptr_file_de_messages->generation, memory_order_relaxed) != file->generation)
+		suivre_redimensionnement(file);
+
+	return ptr_file_de_messages;
+}
+
+/**
+ * Refait l'index des types (à sa taille pour la capacité actuelle) et les listes par type, en parcourant la file :
+ * la liste de chaque type suit l'ordre de la file, aucun message ne change de rang.
+ */
+static void reindexer_types(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	size_t i;
+	int index_element;
+
+	for(i = 0 ; i < ptr_file_de_messages->taille_index_types ; i++)
+		index_types(ptr_file_de_messages)[i].premier = -1;
+
+	for(index_element = ptr_file_de_messages->first ; index_element != -1 ; index_element = element_file(ptr_file_de_messages, index_element)->suivant) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_element);
+		INDEX_TYPE* entree = chercher_type(ptr_file_de_messages, element->type);
+
+		if (entree->premier == -1) {
+			entree->type = element->type;
+			entree->premier = index_element;
+		} else {
+			element_file(ptr_file_de_messages, entree->dernier)->suivant_meme_type = index_element;
+		}
+		entree->dernier = index_element;
+		element->suivant_meme_type = -1;
+	}
+}
+
+// Refait la liste des éléments libres avec ceux du tableau
+static void relier_elements_libres(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	size_t i;
+
+	ptr_file_de_messages->libre = -1;
+	for(i = ptr_file_de_messages->capacite ; i-- > 0 ; ) {
+		if (element_file(ptr_file_de_messages, i)->etat == ELEMENT_LIBRE) {
+			element_file(ptr_file_de_messages, i)->suivant = ptr_file_de_messages->libre;
+			ptr_file_de_messages->libre = i;
+		}
+	}
+}
+
+/**
+ * Déplace le message publié de l'élément source dans l'élément libre destination, au même rang dans la file et dans le tas ;
+ * les listes par type sont refaites ensuite (reindexer_types), la liste des éléments libres aussi.
+ */
+static void deplacer_element(FILE_DE_MESSAGES* ptr_file_de_messages, int source, int destination) {
+	FILE_ELEMENT* element = element_file(ptr_file_de_messages, destination);
+
+	*element = *element_file(ptr_file_de_messages, source);
+	memcpy(place_message(ptr_file_de_messages, destination), place_message(ptr_file_de_messages, source),
+	       element_hors_ligne(ptr_file_de_messages, element) ? sizeof(POIGNEE_HORS_LIGNE) : (size_t) element->longueur_message);
+
+	if (element->precedent == -1)
+		ptr_file_de_messages->first = destination;
+	else
+		element_file(ptr_file_de_messages, element->precedent)->suivant = destination;
+
+	if (element->suivant == -1)
+		ptr_file_de_messages->last = destination;
+	else
+		element_file(ptr_file_de_messages, element->suivant)->precedent = destination;
+
+	if (ptr_file_de_messages->moteur == M_PRIORITE)
+		tas_priorite(ptr_file_de_messages)[element->position_tas] = destination;
+
+	element_file(ptr_file_de_messages, source)->etat = ELEMENT_LIBRE;
+}
+
+/**
+ * Agrandit la file à nb_msg places (mutex pris) : l'objet mémoire grandit, les nouveaux éléments vont dans la liste
+ * des éléments libres, et l'index des types est refait s'il doit grandir lui aussi.
+ * Retourne 0, ou -1 (errno de ftruncate()).
+ */
+static int agrandir_tableau(MESSAGE* file, size_t nb_msg) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	size_t ancienne_capacite = ptr_file_de_messages->capacite;
+	size_t i;
+
+	// Une file anonyme a déjà toute sa place : ses pages n'existent qu'une fois touchées
+	if (file->descripteur != -1) {
+		size_t taille = taille_segment(ptr_file_de_messages->moteur, nb_msg, ptr_file_de_messages->capacite_maximale,
+		                               ptr_file_de_messages->longueur_maximale_message, 0, ptr_file_de_messages->alignement);
+		if (ftruncate(file->descripteur, (off_t) taille) == -1)
+			return -1; // échec
+	}
+
+	for(i = ancienne_capacite ; i < nb_msg ; i++) {
+		memset(element_file(ptr_file_de_messages, i), 0, sizeof(FILE_ELEMENT));
+		element_file(ptr_file_de_messages, i)->suivant = (i + 1 < nb_msg) ? (int) (i + 1) : ptr_file_de_messages->libre;
+	}
+	ptr_file_de_messages->libre = ancienne_capacite;
+	ptr_file_de_messages->capacite = nb_msg;
+
+	if (taille_index_types(ptr_file_de_messages->moteur, nb_msg) != ptr_file_de_messages->taille_index_types) {
+		ptr_file_de_messages->taille_index_types = taille_index_types(ptr_file_de_messages->moteur, nb_msg);
+		reindexer_types(ptr_file_de_messages);
+	}
+
+	return 0;
+}
+
+/**
+ * Rétrécit la file à nb_msg places (mutex pris) : les messages des places retirées passent dans des places libres
+ * restantes, sans changer de rang, puis la mémoire des places retirées est rendue.
+ * Retourne 0, ou -1 (errno == EBUSY si une place retirée est réservée ou en cours de lecture, ou si les messages ne tiennent pas).
+ */
+static int retrecir_tableau(MESSAGE* file, size_t nb_msg) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	size_t ancienne_taille = taille_utilisee(ptr_file_de_messages);
+	size_t a_deplacer = 0, places_libres = 0;
+	size_t i, destination;
+
+	for(i = 0 ; i < ptr_file_de_messages->capacite ; i++) {
+		int etat = element_file(ptr_file_de_messages, i)->etat;
+
+		if (i < nb_msg && etat == ELEMENT_LIBRE)
+			places_libres++;
+		else if (i >= nb_msg && etat == ELEMENT_PUBLIE)
+			a_deplacer++;
+		else if (i >= nb_msg && etat != ELEMENT_LIBRE) {
+			errno = EBUSY;
+			return -1; // échec
+		}
+	}
+
+	if (a_deplacer > places_libres) {
+		errno = EBUSY;
+		return -1; // échec
+	}
+
+	for(i = nb_msg, destination = 0 ; i < ptr_file_de_messages->capacite ; i++) {
+		if (element_file(ptr_file_de_messages, i)->etat != ELEMENT_PUBLIE)
+			continue;
+
+		while (element_file(ptr_file_de_messages, destination)->etat != ELEMENT_LIBRE)
+			destination++;
+		deplacer_element(ptr_file_de_messages, i, destination);
+	}
+
+	ptr_file_de_messages->capacite = nb_msg;
+	ptr_file_de_messages->taille_index_types = taille_index_types(ptr_file_de_messages->moteur, nb_msg);
+	reindexer_types(ptr_file_de_messages);
+	relier_elements_libres(ptr_file_de_messages);
+
+	// La mémoire des places retirées est rendue ; un échec n'empêche pas le rétrécissement
+	size_t taille = taille_utilisee(ptr_file_de_messages);
+	if (file->descripteur != -1) {
+		if (ftruncate(file->descripteur, (off_t) taille) == -1)
+			perror("Fonction ftruncate()");
+	} else if (file->bloc_local == NULL) {
+		size_t page = (size_t) sysconf(_SC_PAGESIZE);
+		size_t debut = ( taille + page - 1 ) / page * page;
+
+		// int madvise(void *addr, size_t length, int advice) : MADV_REMOVE libère les pages d'une projection partagée
+		if (ancienne_taille > debut)
+			madvise((char *) ptr_file_de_messages + debut, ancienne_taille - debut, MADV_REMOVE);
+	} else {
+		// File locale : MADV_DONTNEED rend les pages privées, relues à zéro ; seulement les pages entières du bloc de calloc()
+		uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+		uintptr_t debut = ( (uintptr_t) ptr_file_de_messages + taille + page - 1 ) / page * page;
+		uintptr_t fin = ( (uintptr_t) ptr_file_de_messages + ancienne_taille ) / page * page;
+
+		if (fin > debut)
+			madvise((void *) debut, fin - debut, MADV_DONTNEED);
+	}
+
+	return 0;
+}
+
+/*
+ * Les files M_FRAGMENTS : nombre_fragments files complètes (chacune avec son mutex ou ses curseurs, ses canaux, ses statistiques)
+ * dans le même objet mémoire, après un en-tête qui ne sert qu'à les trouver. Un message va dans le fragment de son type :
+ * les processus qui échangent des types différents ne se disputent ni le même mutex ni les mêmes lignes de cache.
+ * Les fonctions publiques se rappellent elles-mêmes sur le fragment, à travers un MESSAGE local.
+ */
+
+// Le MESSAGE qui désigne le fragment i, ouvert comme la file
+static MESSAGE message_fragment(MESSAGE* file, size_t i) {
+	MESSAGE sous_file = { file->type_ouverture_file_de_messages, fragment(file->ptr_memoire_partagee, i), 0, -1, 0, -1, 0, 0, 0, NULL,
+	                      file->longueur_hors_ligne, file->mode_hors_ligne, file->observation };
+
+	return sous_file;
+}
+
+// Le fragment qui contient zone (une adresse retournée par m_envoi_reserve ou m_reception_peek) ; nombre_fragments si aucun
+static size_t fragment_de_zone(FILE_DE_MESSAGES* ptr_file_de_messages, const void* zone) {
+	char* debut = (char *) fragment(ptr_file_de_messages, 0);
+
+	if ((char *) zone < debut)
+		return ptr_file_de_messages->nombre_fragments;
+
+	size_t i = ( (char *) zone - debut ) / ptr_file_de_messages->taille_fragment;
+	return i < ptr_file_de_messages->nombre_fragments ? i : ptr_file_de_messages->nombre_fragments;
+}
+
+/**
+ * Après un envoi dans un fragment : réveiller les lectures de n'importe quel type, qui attendent sur le canal
+ * attente_file_vide de l'en-tête (cf. lire_fragments). La barrière ordonne la publication du message avant la lecture
+ * de en_attente ; sans lecture en attente, un envoi n'écrit rien dans l'en-tête.
+ */
+static void signaler_fragments(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&ptr_file_de_messages->attente_file_vide.en_attente, memory_order_relaxed) > 0)
+		reveiller_canal(ptr_file_de_messages, &ptr_file_de_messages->attente_file_vide, INT_MAX);
+}
+
+// Les trois lectures qui peuvent prendre un message de n'importe quel fragment (type <= 0)
+typedef enum { LECTURE_COPIE, LECTURE_SANS_COPIE, LECTURE_LOT } SORTE_LECTURE;
+
+typedef struct arguments_lecture {
+	SORTE_LECTURE sorte;
+	void* msg; size_t len; // LECTURE_COPIE : comme m_reception()
+	size_t* longueur; const void* zone; // LECTURE_SANS_COPIE : comme m_reception_peek(), zone est le résultat
+	void** msgs; size_t* lens; size_t nb; // LECTURE_LOT : comme m_reception_lot()
+	long type;
+} ARGUMENTS_LECTURE ;
+
+// La lecture sans attente dans un fragment : le résultat de la fonction publique (0 si m_reception_peek() a réussi)
+static ssize_t lire_fragment(MESSAGE* sous_file, ARGUMENTS_LECTURE* arguments) {
+	switch (arguments->sorte) {
+		case LECTURE_COPIE :
+			return m_reception(sous_file, arguments->msg, arguments->len, arguments->type, O_NONBLOCK);
+		case LECTURE_SANS_COPIE :
+			arguments->zone = m_reception_peek(sous_file, arguments->longueur, arguments->type, O_NONBLOCK);
+			return arguments->zone == NULL ? -1 : 0;
+		default :
+			return m_reception_lot(sous_file, arguments->msgs, arguments->lens, arguments->nb, arguments->type, O_NONBLOCK);
+	}
+}
+
+static _Atomic size_t fragment_suivant = 0; // le premier fragment essayé par la prochaine lecture de ce processus (tourniquet, partagé par ses threads)
+
+// Un passage sur tous les fragments, sans attente ; les fragments vides sont sautés sans être comptés comme des refus
+static ssize_t parcourir_fragments(MESSAGE* file, ARGUMENTS_LECTURE* arguments) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	size_t k, nombre = ptr_file_de_messages->nombre_fragments;
+	size_t premier = atomic_load_explicit(&fragment_suivant, memory_order_relaxed);
+
+	for (k = 0 ; k < nombre ; k++) {
+		size_t i = ( premier + k ) % nombre;
+		if (nombre_messages(fragment(ptr_file_de_messages, i)) == 0)
+			continue;
+
+		MESSAGE sous_file = message_fragment(file, i);
+		ssize_t resultat = lire_fragment(&sous_file, arguments);
+		if (resultat != -1) {
+			atomic_store_explicit(&fragment_suivant, i + 1, memory_order_relaxed);
+			return resultat;
+		}
+		if (errno != EAGAIN)
+			return -1; // échec (EMSGSIZE ...)
+	}
+
+	errno = EAGAIN;
+	return -1;
+}
+
+/**
+ * Une lecture de type <= 0 : le premier message convenable d'un fragment, en commençant par celui qui suit le dernier
+ * fragment lu par ce processus. Avec type < 0, c'est le plus petit type de ce fragment, pas de toute la file.
+ * Sans message et sans O_NONBLOCK, le processus s'inscrit sur le canal de l'en-tête, refait un passage (un envoi
+ * antérieur à l'inscription est alors vu) puis dort jusqu'au prochain signalement.
+ */
+static ssize_t lire_fragments(MESSAGE* file, ARGUMENTS_LECTURE* arguments, int flags) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	CANAL_ATTENTE* canal = &ptr_file_de_messages->attente_file_vide;
+
+	for (;;) {
+		uint32_t sequence = atomic_load_explicit(&canal->sequence, memory_order_seq_cst);
+
+		ssize_t resultat = parcourir_fragments(file, arguments);
+		if (resultat != -1 || errno != EAGAIN)
+			return resultat;
+
+		if (flags == O_NONBLOCK) { // le refus est compté dans le premier fragment essayé
+			terminer_echec(fragment(ptr_file_de_messages, atomic_load_explicit(&fragment_suivant, memory_order_relaxed) % ptr_file_de_messages->nombre_fragments), ATTENTE_FILE_VIDE);
+			errno = EAGAIN;
+			return -1; // échec
+		}
+
+		if (echeance_depassee())
+			return -1; // échec, errno == ETIMEDOUT
+
+		atomic_fetch_add_explicit(&canal->en_attente, 1, memory_order_seq_cst);
+		resultat = parcourir_fragments(file, arguments);
+		if (resultat == -1 && errno == EAGAIN)
+			futex_attendre(ptr_file_de_messages, &canal->sequence, sequence);
+		atomic_fetch_sub_explicit(&canal->en_attente, 1, memory_order_seq_cst);
+
+		if (resultat != -1 || errno != EAGAIN)
+			return resultat;
+	}
+}
+
+/**
+ * Les mutex, les canaux d'attente, les descripteurs m_fd() et les notifications d'une file : tout ce qui n'a de sens que
+ * pour les processus connectés, préparé à la création de la file et refait quand une file durable est restaurée.
+ *
+ * Valeur de retour : 0 si OK, −1 si échec.
+ */
+static int initialiser_synchronisation(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	int i;
+
+	// Aucun descripteur m_fd()
+	memset(ptr_file_de_messages->descripteurs_armes, 0, sizeof(ptr_file_de_messages->descripteurs_armes));
+	memset(ptr_file_de_messages->descripteurs, 0, sizeof(ptr_file_de_messages->descripteurs));
+
+	pthread_mutexattr_t attr;
+
+	// int pthread_mutexattr_init(pthread_mutexattr_t *attr);
+	int mutexattr_init_result = pthread_mutexattr_init(&attr);
+	if(mutexattr_init_result != 0) {
+		char* error_msg = strerror( mutexattr_init_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutexattr_init() : %s \n", error_msg);
+		return -1; // échec
+	}
+
+	// int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr,int pshared);
+	// pshared: PTHREAD_PROCESS_PRIVATE, PTHREAD_PROCESS_SHARED (une file locale n'est vue que par les threads d'un processus)
+	// Valeur de retour : 0 si OK, numero d'erreur sinon
+	int mutexattr_setpshared_result = pthread_mutexattr_setpshared(&attr, ptr_file_de_messages->locale ? PTHREAD_PROCESS_PRIVATE : PTHREAD_PROCESS_SHARED);
+	if(mutexattr_setpshared_result != 0) {
+		char* error_msg = strerror( mutexattr_setpshared_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutexattr_setpshared() : %s \n", error_msg);
+		return -1; // échec
+	}
+
+	// int pthread_mutexattr_setrobust(pthread_mutexattr_t *attr, int robustness);
+	// Si le processus qui a le mutex meurt, le suivant qui le prend reçoit EOWNERDEAD au lieu de rester bloqué,
+	// et remet la file en état (cf. verifier_verrouillage) ; une file locale meurt avec son processus, son mutex reste ordinaire
+	int mutexattr_setrobust_result = pthread_mutexattr_setrobust(&attr, ptr_file_de_messages->locale ? PTHREAD_MUTEX_STALLED : PTHREAD_MUTEX_ROBUST);
+	if(mutexattr_setrobust_result != 0) {
+		char* error_msg = strerror( mutexattr_setrobust_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutexattr_setrobust() : %s \n", error_msg);
+		return -1; // échec
+	}
+
+	// int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+	int mutex_init_result = pthread_mutex_init( &(ptr_file_de_messages->mutex), &attr);
+	if(mutex_init_result != 0) {
+		char* error_msg = strerror( mutex_init_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutex_init() : %s \n", error_msg);
+		return -1; // échec
+	}
+
+	ptr_file_de_messages->proprietaire_mutex = 0;
+
+	// Le mutex des enregistrements de notifications, avec les mêmes attributs
+	mutex_init_result = pthread_mutex_init( &(ptr_file_de_messages->mutex_notifications), &attr);
+	if(mutex_init_result != 0) {
+		char* error_msg = strerror( mutex_init_result ); // char * strerror (int errnum)
+		fprintf(stderr, "Fonction pthread_mutex_init() : %s \n", error_msg);
+		return -1; // échec
+	}
+
+	// Les canaux d'attente des moteurs M_MUTEX et M_PRIORITE : personne n'attend
+	memset(&ptr_file_de_messages->attente_file_pleine, 0, sizeof(CANAL_ATTENTE));
+	memset(&ptr_file_de_messages->attente_file_vide, 0, sizeof(CANAL_ATTENTE));
+	memset(ptr_file_de_messages->attente_type, 0, sizeof(ptr_file_de_messages->attente_type));
+	memset(&ptr_file_de_messages->attente_priorite, 0, sizeof(CANAL_ATTENTE));
+
+	// Les enregistrements de notifications : toutes les listes sont vides, tous les enregistrements sont libres
+	atomic_init(&ptr_file_de_messages->nombre_notifications, 0);
+	for(i = 0 ; i < NB_LISTES_NOTIFICATIONS ; i++)
+		ptr_file_de_messages->notifications_par_type[i] = -1;
+	for(i = 0 ; i < NB_NOTIFICATIONS ; i++) {
+		memset(&ptr_file_de_messages->notifications[i], 0, sizeof(ENREGISTREMENT_NOTIFICATIONS));
+		ptr_file_de_messages->notifications[i].suivant = (i + 1 < NB_NOTIFICATIONS) ? i + 1 : -1;
+	}
+	ptr_file_de_messages->notifications_libres = 0;
+
+	return 0;
+}
+
+/**
+ * La préparation d'une file de nb_msg messages (après arrondi), qui pourra grandir jusqu'à capacite_maximale, dans la mémoire
+ * qui commence à ptr_file_de_messages : l'en-tête, l'index des types, les descripteurs et la zone des messages (ou l'anneau), les mutex, les canaux
+ * et les notifications ; partagés entre processus, sauf pour une file locale.
+ *
+ * Valeur de retour : 0 si OK, −1 si échec.
+ */
+static int initialiser_file(FILE_DE_MESSAGES* ptr_file_de_messages, int moteur, int options, int locale, size_t nb_msg, size_t capacite_maximale,
+                            size_t len_max, size_t taille_anneau, size_t alignement) {
+
+	ptr_file_de_messages->moteur = moteur;
+	ptr_file_de_messages->options = options & M_ALIGNE;
+	ptr_file_de_messages->durable = 0;
+	ptr_file_de_messages->locale = locale;
+	ptr_file_de_messages->nombre_fragments = 0;
+	ptr_file_de_messages->taille_fragment = 0;
+	ptr_file_de_messages->alignement = alignement;
+	ptr_file_de_messages->taille_place = taille_place(len_max, alignement);
+	ptr_file_de_messages->capacite = nb_msg;  // La longueur maximale d’un message
+	ptr_file_de_messages->longueur_maximale_message = len_max;  // capacité de la file (le nombre minimal de messages que la file peut stocker)
+	ptr_file_de_messages->nombre_elements_remplis = 0; // le nombre de messages actuellement dans la file
+	ptr_file_de_messages->first = -1; // l’indice du premier message de la file
+	ptr_file_de_messages->last = -1; // l’indice du dernier message de la file
+	ptr_file_de_messages->libre = 0; // l’indice du premier élément libre de tableau
+	ptr_file_de_messages->taille_index_types = taille_index_types(moteur, nb_msg);
+	ptr_file_de_messages->capacite_maximale = capacite_maximale;
+	ptr_file_de_messages->decalage_tableau = taille_avant_tableau(moteur, capacite_maximale);
+	ptr_file_de_messages->decalage_messages = ptr_file_de_messages->decalage_tableau + taille_descripteurs(capacite_maximale);
+	ptr_file_de_messages->taille_reservee = taille_segment(moteur, capacite_maximale, capacite_maximale, len_max, taille_anneau, alignement);
+	atomic_init(&ptr_file_de_messages->generation, 0);
+	ptr_file_de_messages->taille_tas = 0;
+	ptr_file_de_messages->numero_ordre_suivant = 0;
+
+	// Les indices des moteurs M_SPSC et M_MPMC
+	memset(&ptr_file_de_messages->spsc, 0, sizeof(CURSEURS_SPSC));
+	memset(&ptr_file_de_messages->mpmc, 0, sizeof(CURSEURS_MPMC));
+
+	// L'anneau du moteur M_OCTETS
+	memset(&ptr_file_de_messages->octets, 0, sizeof(CURSEURS_OCTETS));
+	ptr_file_de_messages->octets.taille_anneau = taille_anneau;
+
+	// Les statistiques
+	memset(&ptr_file_de_messages->statistiques, 0, sizeof(STATISTIQUES));
+
+	// La validation groupée des files durables (cf. m_connexion_fichier)
+	memset(&ptr_file_de_messages->durabilite, 0, sizeof(DURABILITE));
+
+	int i;
+
+	// Nettoyer (Clear) les descripteurs des elements du tableau circulaire (elements de type FILE_ELEMENT)
+	// void * memset (void *block, int c, size_t size)
+	// (le moteur M_OCTETS n'a pas d'éléments de taille fixe)
+	for(i = 0 ; moteur != M_OCTETS && i < nb_msg ; i++) {
+		memset(element_file(ptr_file_de_messages, i), 0, sizeof(FILE_ELEMENT));
+
+		// Moteur M_MPMC : au premier tour, l'élément i est libre pour la position i ;
+		// moteurs M_DIFFUSION : le message de la position i - nb_msg (avant le premier tour) est publié
+		atomic_init(&element_file(ptr_file_de_messages, i)->sequence, moteur_diffusion(moteur) ? (uint32_t) (i + 1 - nb_msg) : (uint32_t) i);
+
+		// Moteur M_MUTEX : tous les éléments sont dans la liste des éléments libres
+		element_file(ptr_file_de_messages, i)->suivant = (i + 1 < nb_msg) ? i + 1 : -1;
+	}
+
+	// Moteurs M_DIFFUSION : aucun lecteur
+	if (moteur_diffusion(moteur))
+		memset(lecteurs_diffusion(ptr_file_de_messages), 0, NB_LECTEURS * sizeof(LECTEUR_DIFFUSION));
+
+	// Vider l'index des types
+	for(i = 0 ; i < ptr_file_de_messages->taille_index_types ; i++)
+		index_types(ptr_file_de_messages)[i].premier = -1;
+
+	return initialiser_synchronisation(ptr_file_de_messages);
+}
+
+/**
+ * Files durables : la restauration par la première connexion après un arrêt (de la machine, ou de tous les processus
+ * connectés), seule sur la file. Les mutex, canaux, descripteurs et notifications des processus d'avant l'arrêt sont refaits.
+ * Une place réservée par un envoi inachevé redevient libre ; un message lu sans être rendu (m_reception_peek) revient dans la file ;
+ * un message dont la somme de contrôle est fausse (écrit à moitié sur le disque) est jeté. Les messages restants sont reliés
+ * dans leur ordre d'arrivée (cf. reparer_elements) ; leur durée de vie se compte sur l'horloge CLOCK_MONOTONIC du redémarrage.
+ *
+ * Valeur de retour : 0 si OK, −1 si échec.
+ */
+static int restaurer_file(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	DURABILITE* durabilite = &ptr_file_de_messages->durabilite;
+	size_t i;
+
+	if (initialiser_synchronisation(ptr_file_de_messages) == -1)
+		return -1; // échec
+
+	for(i = 0 ; i < ptr_file_de_messages->capacite ; i++) {
+		FILE_ELEMENT* element = element_file(ptr_file_de_messages, i);
+
+		if (element->etat == ELEMENT_LU)
+			element->etat = ELEMENT_PUBLIE;
+
+		if ( element->etat != ELEMENT_PUBLIE
+		     || (size_t) element->longueur_message > ptr_file_de_messages->longueur_maximale_message
+		     || element->somme_controle != somme_controle(ptr_file_de_messages, element) )
+			element->etat = ELEMENT_LIBRE;
+		element->pid = 0;
+	}
+	reparer_elements(ptr_file_de_messages);
+
+	// Toutes les opérations d'avant l'arrêt sont maintenant ce qui est sur le disque
+	atomic_store(&durabilite->operations_validees, atomic_load(&durabilite->operations));
+	atomic_store(&durabilite->heure_validation, horloge());
+	atomic_store(&durabilite->validation_en_cours, 0);
+
+	return 0;
+}
+
+/*
+ * Le format de la file. Tout ce que la mémoire partagée contient est un indice ou un décalage depuis l'en-tête : elle peut
+ * être projetée à une adresse différente dans chaque processus, et la connexion à une file existante n'y écrit rien.
+ * Le créateur scelle l'en-tête une fois la file prête ; chaque connexion vérifie le sceau, en temps constant.
+ */
+
+// La somme de contrôle des champs de l'en-tête fixés à la création ; pas de capacite ni de generation, que m_redimensionner change
+static uint32_t somme_controle_entete(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	size_t champs[] = { ptr_file_de_messages->version, (size_t) ptr_file_de_messages->moteur, (size_t) ptr_file_de_messages->options,
+	                    (size_t) ptr_file_de_messages->durable, (size_t) ptr_file_de_messages->locale,
+	                    ptr_file_de_messages->longueur_maximale_message, ptr_file_de_messages->alignement,
+	                    ptr_file_de_messages->taille_place, ptr_file_de_messages->capacite_maximale,
+	                    ptr_file_de_messages->decalage_tableau, ptr_file_de_messages->decalage_messages,
+	                    ptr_file_de_messages->taille_reservee,
+	                    ptr_file_de_messages->nombre_fragments, ptr_file_de_messages->taille_fragment,
+	                    ptr_file_de_messages->octets.taille_anneau };
+
+	return fnv1a(2166136261u, champs, sizeof(champs));
+}
+
+// Scelle l'en-tête d'une file que son créateur vient de préparer : la magie est écrite en dernier
+static void sceller_entete(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	ptr_file_de_messages->version = VERSION_FORMAT;
+	ptr_file_de_messages->somme_controle_entete = somme_controle_entete(ptr_file_de_messages);
+	atomic_store_explicit(&ptr_file_de_messages->magie, MAGIE_FILE, memory_order_release);
+}
+
+/**
+ * Vérifie, sans rien écrire, l'en-tête d'une file existante (l'objet mémoire est au moins aussi grand que l'en-tête).
+ * Retourne 0, ou -1 : errno == EAGAIN si la file est encore en cours de création, EINVAL si ce n'est pas une file
+ * (ou pas une file de ce format : version différente, en-tête abîmé).
+ */
+static int verifier_entete(FILE_DE_MESSAGES* ptr_file_de_messages) {
+	uint32_t magie = atomic_load_explicit(&ptr_file_de_messages->magie, memory_order_acquire);
+
+	if (magie == 0) {
+		errno = EAGAIN;
+		return -1; // échec
+	}
+
+	if (magie != MAGIE_FILE || ptr_file_de_messages->version != VERSION_FORMAT
+	    || ptr_file_de_messages->somme_controle_entete != somme_controle_entete(ptr_file_de_messages)) {
+		errno = EINVAL;
+		return -1; // échec
+	}
+
+	return 0;
+}
+
+#define CONNEXION_PARTAGEE 0 // m_connexion : objet mémoire de shm_open(), ou file anonyme si nom == NULL
+#define CONNEXION_FICHIER  1 // m_connexion_fichier : le fichier ordinaire nom
+#define CONNEXION_LOCALE   2 // m_connexion_locale : une nouvelle file dans la mémoire du processus (nom == NULL)
+#define CONNEXION_OBSERVATION 3 // m_observation : l'objet mémoire de shm_open() d'une file existante, projeté en lecture seule
+
+/**
+ * La connexion à une file, pour m_connexion(), m_connexion_fichier(), m_connexion_locale() et m_observation() selon sorte (CONNEXION_PARTAGEE ...).
+ * liste_parametres : les paramètres qui suivent options.
+ */
+static MESSAGE* connecter(const char *nom, int sorte, int options, va_list liste_parametres) {
+	int fichier = sorte == CONNEXION_FICHIER;
+	int locale = sorte == CONNEXION_LOCALE;
+	int observation = sorte == CONNEXION_OBSERVATION;
+
+	// void * malloc (size_t size)
+	MESSAGE* file = (MESSAGE*) malloc( sizeof(MESSAGE) );
+	if (file == NULL){
+		fprintf(stderr, "L'allocation de mémoire à l'aide de la fonction malloc() a échoué \n");
+		return NULL; // En cas d’échec, m_connexion retourne NULL
+	}
+
+	// On va stocker dans cette variable les valeurs qu'on veut passer plus tard pour l'argument protect de la fonction mmap()
+	int mmap_protect;
+
+	// options est un « OR » bit-à-bit de constantes : O_RDWR, O_RDONLY, O_WRONLY, O_CREAT, O_EXCL ....
+	// exactement une de ces constantes doit être spécifiée : O_RDWR, O_RDONLY, O_WRONLY
+	// Le but ici est de vérifier laquelle des trois constantes a été transférée à la fonction,
+	// afin de savoir si on est en mode lecture / écriture / lecture et écriture
+
+    // &  : l'opérateur AND binaire copie un bit dans le résultat s'il existe dans les deux opérandes.
+	   if ( ((O_RDWR & options) == O_RDWR)  ) {
+		   mmap_protect = PROT_READ | PROT_WRITE;
+		   file->type_ouverture_file_de_messages = O_RDWR;
+
+	   } else if ( ((O_WRONLY & options) == O_WRONLY) ){
+		   mmap_protect = PROT_READ | PROT_WRITE; // Pour mmap(), pour pouvoir écrire, il faut aussi ajouter la constante de lecture
+		   file->type_ouverture_file_de_messages = O_WRONLY;
+
+	   } else if ( ((O_RDONLY & options) == O_RDONLY) ) {
+			file->type_ouverture_file_de_messages = O_RDONLY;
+			// Lire un message écrit dans la file (mutex, curseurs, états des éléments) : seule m_observation projette en lecture seule
+		    mmap_protect = observation ? PROT_READ : PROT_READ | PROT_WRITE;
+	   } else {
+		   return NULL; // En cas d’échec, m_connexion retourne NULL
+	   }
+	file->observation = observation;
+
+    // Si options contient O_CREAT, alors la fonction m_connexion aura 3 paramètres de plus (4 avec M_OCTETS, 1 de plus avec M_FRAGMENTS) :
+	size_t nb_msg = 0, len_max = 0, taille_anneau = 0, nombre_fragments = 0, capacite_maximale = 0;
+	mode_t mode = 0;
+
+	// Le moteur de la file, pris en compte seulement si c'est une nouvelle file de messages
+	int moteur = options & M_MOTEUR_MASQUE;
+	if (moteur != M_MUTEX && moteur != M_SPSC && moteur != M_MPMC && moteur != M_PRIORITE && moteur != M_OCTETS && ! moteur_diffusion(moteur)) {
+		errno = EINVAL;
+		return NULL; // En cas d’échec, m_connexion retourne NULL
+	}
+
+	// m_connexion est une fonction à nombre variable d’arguments (soit 2, soit 5).
+	// Si options ne contient pas O_CREAT, alors la fonction m_connexion n’aura que les deux paramètres nom et options
+	if ( (O_CREAT & options) == O_CREAT) { // Si options contient O_CREAT
+		// va_arg(liste_parametres, type)
+		// On accede aux differents parametres de liste par la macro va_arg
+		// qui retourne le parametre suivant de la liste:
+		nb_msg = va_arg(liste_parametres, size_t);
+		len_max = va_arg(liste_parametres, size_t);
+		if (! locale) // m_connexion_locale : pas de permissions
+			mode = va_arg(liste_parametres, mode_t);
+		if (moteur == M_OCTETS)
+			taille_anneau = va_arg(liste_parametres, size_t);
+		if (options & M_FRAGMENTS)
+			nombre_fragments = va_arg(liste_parametres, size_t);
+		if (options & M_EXTENSIBLE)
+			capacite_maximale = va_arg(liste_parametres, size_t);
+	}
+
+	// m_connexion_fichier : restaurer_file() ne sait relier que les messages des moteurs M_MUTEX et M_PRIORITE
+	if (fichier && nb_msg != 0 && ( (moteur != M_MUTEX && moteur != M_PRIORITE) || (options & M_FRAGMENTS) )) {
+		errno = EINVAL;
+		return NULL; // En cas d’échec, m_connexion retourne NULL
+	}
+
+	// m_connexion_locale : la file n'a qu'une connexion, partagée par les threads (un seul lecteur M_DIFFUSION),
+	// et n'est pas projetée
+	if (locale && (nb_msg == 0 || moteur_diffusion(moteur) || (options & (M_GRANDES_PAGES | M_PRECHARGE | M_MLOCK)))) {
+		errno = EINVAL;
+		return NULL; // En cas d’échec, m_connexion_locale retourne NULL
+	}
+
+	// M_FRAGMENTS : chaque fragment a sa part de la capacité et de l'anneau ; le moteur M_SPSC n'a qu'un producteur, rien à partager,
+	// et les lecteurs des moteurs M_DIFFUSION lisent tous les messages, dans l'ordre
+	if (options & M_FRAGMENTS && nb_msg != 0) {
+		if (nombre_fragments == 0 || nombre_fragments > NB_FRAGMENTS_MAX || moteur == M_SPSC || moteur_diffusion(moteur)) {
+			errno = EINVAL;
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		nb_msg = ( nb_msg + nombre_fragments - 1 ) / nombre_fragments;
+		taille_anneau = ( taille_anneau + nombre_fragments - 1 ) / nombre_fragments;
+	}
+
+	// Les indices des moteurs sans verrou sont des masques : la capacité (minimale) est arrondie à une puissance de 2
+	if (moteur == M_SPSC || moteur == M_MPMC || moteur_diffusion(moteur))
+		nb_msg = puissance_de_deux(nb_msg);
+
+	// Avec un seul élément, « rempli pour la position p » et « libre pour la position p + 1 » auraient la même sequence
+	if (moteur == M_MPMC && nb_msg == 1)
+		nb_msg = 2;
+
+	// La place de chaque élément ou enregistrement est un multiple de alignement
+	size_t alignement = alignement_places(moteur, options);
+
+	// L'anneau du moteur M_OCTETS : par défaut aussi grand que nb_msg messages de len_max octets,
+	// au moins assez grand pour un message de len_max octets, et un multiple de alignement
+	if (moteur == M_OCTETS) {
+		if (len_max > UINT32_MAX - 2 * alignement) { // les longueurs sont sur 32 bits
+			errno = EINVAL;
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		if (taille_anneau == 0)
+			taille_anneau = nb_msg * taille_enregistrement(len_max, alignement);
+		if (taille_anneau < taille_enregistrement(len_max, alignement))
+			taille_anneau = taille_enregistrement(len_max, alignement);
+		taille_anneau = ( taille_anneau + alignement - 1 ) / alignement * alignement;
+	}
+
+	// M_EXTENSIBLE : la file pourra grandir jusqu'à capacite_maximale (cf. m_redimensionner), seulement avec les moteurs M_MUTEX
+	// et M_PRIORITE, sans M_FRAGMENTS, ni anonyme avec M_GRANDES_PAGES (MAP_HUGETLB ne sait pas réserver sans engager la mémoire).
+	// L'index, le tas et les descripteurs sont prévus pour capacite_maximale : sans M_EXTENSIBLE, l'objet mémoire n'a que nb_msg places
+	if (options & M_EXTENSIBLE && nb_msg != 0) {
+		if ( (moteur != M_MUTEX && moteur != M_PRIORITE) || (options & M_FRAGMENTS) || (nom == NULL && (options & M_GRANDES_PAGES))
+		     || capacite_maximale < nb_msg ) {
+			errno = EINVAL;
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+	}
+	else
+		capacite_maximale = nb_msg;
+
+	// Taille de l'espace mémoire pour l'objet mémoire POSIX que nous voulons projeter en mémoire à l'aide de mmap()
+	size_t taille_memoire = taille_segment(moteur, nb_msg, capacite_maximale, len_max, taille_anneau, alignement);
+
+	// La place que chaque processus projette : l'objet mémoire quand la file aura atteint capacite_maximale
+	size_t taille_reservee = taille_segment(moteur, capacite_maximale, capacite_maximale, len_max, taille_anneau, alignement);
+
+	// M_FRAGMENTS : l'en-tête, puis les fragments, chacun sur ses propres lignes de cache
+	size_t taille_fragment = 0;
+	if (nombre_fragments > 0) {
+		taille_fragment = taille_lignes(taille_memoire);
+		taille_memoire = taille_reservee = sizeof(FILE_DE_MESSAGES) + nombre_fragments * taille_fragment;
+	}
+
+	void* ptr_mmap = NULL; // le pointeur vers la mémoire partagée qui contient la file
+	int seul = 0; // m_connexion_fichier : la connexion a le verrou exclusif du fichier
+	if (nom != NULL) { // <=> une file PAS anonyme
+		// int shm_open(cont char *name, int oflag, mode_t mode);
+		// Le troisième paramètre est ignoré si on ouvre un objet mémoire existant.
+		// Retourne un descripteur fichier si OK, -1 sinon
+		// Les options M_ ne concernent pas shm_open()
+		// mmap() en écriture exige un descripteur ouvert en lecture et en écriture : O_WRONLY et O_RDONLY deviennent O_RDWR
+		// pour shm_open(), sauf pour m_observation
+		int oflag = options & ~M_OPTIONS;
+		if (! observation)
+			oflag = (oflag & ~O_ACCMODE) | O_RDWR;
+		// m_connexion_fichier : open() avec les mêmes paramètres, pour un fichier ordinaire
+		int shm_descripteur = fichier ? open(nom, oflag, mode) : shm_open(nom, oflag, mode);
+		if(shm_descripteur == -1){
+			perror(fichier ? "Fonction open()" : "Fonction shm_open()");
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		if (fichier) {
+			// int flock(int fd, int operation) : chaque connexion (sauf O_RDONLY) garde un verrou partagé sur le fichier ;
+			// celle qui obtient le verrou exclusif est seule et crée ou restaure la file, les autres attendent qu'elle ait fini
+			if (file->type_ouverture_file_de_messages != O_RDONLY) {
+				seul = flock(shm_descripteur, LOCK_EX | LOCK_NB) == 0;
+				if(! seul && flock(shm_descripteur, LOCK_SH) == -1) {
+					perror("Fonction flock()");
+					close(shm_descripteur);
+					return NULL; // En cas d’échec, m_connexion retourne NULL
+				}
+			}
+
+			struct stat buf;
+			if(fstat(shm_descripteur, &buf) == -1){
+				perror("Fonction fstat()");
+				close(shm_descripteur);
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+
+			// Un fichier qui contient déjà une file n'est pas recréé, même avec O_CREAT : il est restauré
+			if (buf.st_size > 0) {
+				nb_msg = 0;
+			} else if (nb_msg == 0 || ! seul) { // fichier vide, sans O_CREAT (ou dont le créateur a échoué)
+				close(shm_descripteur);
+				errno = EINVAL;
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+		}
+
+		if(nb_msg != 0) { // <=> Si c'est une nouvelle file de messages
+
+			 // int ftruncate (int fd, off_t length)
+			 // La fonction ftruncate change la taille d'un fichier a la valeur de length.
+			 int ftruncate_result = ftruncate(shm_descripteur, (off_t) taille_memoire);
+			 if(ftruncate_result == -1) {
+				perror("Fonction ftruncate()"); //  void perror (const char *message)
+				close(shm_descripteur);
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			 }
+
+		} else { // <=> Si c'est PAS une nouvelle file de messages
+			struct stat buf;
+
+			// int fstat (int filedes, struct stat *buf)
+			int fstat_resultat = fstat(shm_descripteur, &buf);
+			if(fstat_resultat == -1){
+				perror("Fonction fstat()");
+				close(shm_descripteur);
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+
+			taille_memoire = buf.st_size;
+
+			// Un objet mémoire vide vient d'être créé par shm_open() : la file n'y est pas encore ;
+			// plus petit que l'en-tête, ce n'est pas une file (et le lire par la projection lèverait SIGBUS)
+			if (taille_memoire < sizeof(FILE_DE_MESSAGES)) {
+				close(shm_descripteur);
+				errno = taille_memoire == 0 ? EAGAIN : EINVAL;
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+
+			// ssize_t pread(int fd, void *buf, size_t count, off_t offset) : la place réservée par le créateur de la file,
+			// lue avant de projeter ; une file déjà agrandie par m_redimensionner ne change pas d'adresse
+			ssize_t pread_resultat = pread(shm_descripteur, &taille_reservee, sizeof(size_t), offsetof(FILE_DE_MESSAGES, taille_reservee));
+			if(pread_resultat != (ssize_t) sizeof(size_t)) {
+				perror("Fonction pread()");
+				close(shm_descripteur);
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+			if (taille_reservee < taille_memoire)
+				taille_reservee = taille_memoire;
+		}
+
+		// mmap(), avec les options de projection de ce processus (M_GRANDES_PAGES, M_PRECHARGE, M_MLOCK)
+		ptr_mmap = projeter(shm_descripteur, &taille_reservee, taille_memoire, mmap_protect, options);
+		if(ptr_mmap == MAP_FAILED) {
+			perror("Fonction mmap()"); //  void perror (const char *message)
+			close(shm_descripteur);
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		// Une file existante est vérifiée sans rien y écrire : une connexion de m_observation (PROT_READ) y suffit
+		if (nb_msg == 0 && verifier_entete((FILE_DE_MESSAGES *) ptr_mmap) == -1) {
+			int erreur = errno;
+			munmap(ptr_mmap, taille_reservee);
+			close(shm_descripteur);
+			free(file);
+			errno = erreur;
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		// Le descripteur reste ouvert : m_redimensionner change la taille de l'objet mémoire avec ftruncate()
+		file->descripteur = shm_descripteur;
+
+	} else if (! locale) { // (nom == NULL) => file anonyme
+
+		// mmap(), avec les options de projection de ce processus (M_GRANDES_PAGES, M_PRECHARGE, M_MLOCK)
+		ptr_mmap = projeter(-1, &taille_reservee, taille_memoire, mmap_protect, options);
+		if(ptr_mmap == MAP_FAILED) {
+			perror("Fonction mmap()"); //  void perror (const char *message)
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
+
+		file->descripteur = -1;
+	} else { // file locale
+
+		// void * calloc (size_t count, size_t eltsize) : de la mémoire à zéro, alignée ici sur une ligne de cache ;
+		// un grand bloc vient de pages neuves, celles de la place réservée ne sont engagées qu'une fois touchées
+		file->bloc_local = calloc(1, taille_reservee + TAILLE_LIGNE_CACHE);
+		if (file->bloc_local == NULL) {
+			perror("Fonction calloc()");
+			free(file);
+			return NULL; // En cas d’échec, m_connexion_locale retourne NULL
+		}
+
+		ptr_mmap = (char *) file->bloc_local + TAILLE_LIGNE_CACHE - (uintptr_t) file->bloc_local % TAILLE_LIGNE_CACHE;
+		file->descripteur = -1;
+	}
+	if (! locale)
+		file->bloc_local = NULL;
+
+	// le pointeur vers la mémoire partagée qui contient la file
+	file->ptr_memoire_partagee = ptr_mmap;
+	file->taille_projection = taille_reservee;
+	file->taille_utile = taille_memoire;
+	file->options_projection = options & (M_PRECHARGE | M_MLOCK);
+	file->longueur_hors_ligne = 0;
+	file->mode_hors_ligne = 0600;
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) ptr_mmap;
+	if(nb_msg != 0) { // <=> Si c'est une nouvelle file de messages
+
+		// Les autres connexions attendent le sceau de l'en-tête (O_CREAT sans O_EXCL refait une file existante)
+		atomic_store_explicit(&ptr_file_de_messages->magie, 0, memory_order_relaxed);
+
+		int resultat = 0;
+		if (nombre_fragments == 0) {
+			resultat = initialiser_file(ptr_file_de_messages, moteur, options, locale, nb_msg, capacite_maximale, len_max, taille_anneau, alignement);
+		} else {
+			// L'en-tête de la file ne sert qu'à trouver les fragments ; ses canaux servent aux lectures de type <= 0
+			memset(ptr_file_de_messages, 0, sizeof(FILE_DE_MESSAGES));
+			ptr_file_de_messages->moteur = moteur;
+			ptr_file_de_messages->locale = locale;
+			ptr_file_de_messages->options = options & (M_ALIGNE | M_FRAGMENTS);
+			ptr_file_de_messages->alignement = alignement;
+			ptr_file_de_messages->taille_place = taille_place(len_max, alignement);
+			ptr_file_de_messages->capacite = nombre_fragments * nb_msg;
+			ptr_file_de_messages->capacite_maximale = ptr_file_de_messages->capacite;
+			ptr_file_de_messages->taille_reservee = taille_memoire;
+			ptr_file_de_messages->longueur_maximale_message = len_max;
+			ptr_file_de_messages->nombre_fragments = nombre_fragments;
+			ptr_file_de_messages->taille_fragment = taille_fragment;
+
+			size_t i;
+			for (i = 0 ; i < nombre_fragments && resultat == 0 ; i++)
+				resultat = initialiser_file(fragment(ptr_file_de_messages, i), moteur, options, locale, nb_msg, nb_msg, len_max, taille_anneau, alignement);
+		}
 
+		// La file ne sera jamais scellée : l'objet mémoire créé est supprimé (les connexions suivantes échoueraient sinon
+		// avec EAGAIN), le fichier d'une file durable redevient vide
+		if (resultat == -1) {
+			int erreur = errno;
+			if (locale) {
+				free(file->bloc_local);
+			} else {
+				munmap(ptr_mmap, taille_reservee);
+				if (fichier && ftruncate(file->descripteur, 0) == -1)
+					perror("Fonction ftruncate()");
+				else if (nom != NULL && ! fichier)
+					shm_unlink(nom); // int shm_unlink (const char *name)
+				if (file->descripteur != -1)
+					close(file->descripteur);
+			}
+			free(file);
+			errno = erreur;
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		}
 
-// Nous stockons dans une variable globale un pointeur vers notre mutex, pour une utilisation future :
-//  une fonction exit_mutex() qu'on appellera automatiquement à chaque exit effectuée au milieu de la section critique
-// (à l'aide de la fonction atexit). Objectif de cette fonction : pthread_mutex_unlock( mutex )
-pthread_mutex_t* mutex;
+		// Une nouvelle file durable : la validation groupée par défaut
+		if (fichier) {
+			ptr_file_de_messages->durable = 1;
+			ptr_file_de_messages->durabilite.operations_par_validation = VALIDATION_OPERATIONS;
+			ptr_file_de_messages->durabilite.delai_validation = (uint64_t) VALIDATION_DELAI_US * 1000;
+		}
 
-// Afin de savoir si au moment du exit le processus était dans la section critique
-int flag_processus_dans_section_critique;
+		sceller_entete(ptr_file_de_messages);
+	}
 
+	if (fichier) {
+		if (nb_msg == 0 && ! ptr_file_de_messages->durable) {
+			munmap(ptr_mmap, taille_reservee);
+			close(file->descripteur);
+			free(file);
+			errno = EINVAL; // le fichier ne contient pas une file durable
+			return NULL; // En cas d’échec, m_connexion retourne NULL
+		} else if (nb_msg == 0 && seul) {
+			// Un arrêt pendant m_redimensionner a pu laisser le fichier plus court que la file : la fin est relue vide
+			size_t taille = taille_utilisee(ptr_file_de_messages);
+			if ( (taille > taille_memoire && ftruncate(file->descripteur, (off_t) taille) == -1)
+			     || restaurer_file(ptr_file_de_messages) == -1 ) {
+				munmap(ptr_mmap, taille_reservee);
+				close(file->descripteur);
+				free(file);
+				return NULL; // En cas d’échec, m_connexion retourne NULL
+			}
+			file->taille_utile = taille;
+		}
 
-void exit_mutex() {
+		// La file créée ou restaurée est sur le disque avant que les autres connexions ne s'en servent
+		if (seul) {
+			if (valider_file(ptr_file_de_messages) == -1)
+				perror("Fonction msync()");
+			flock(file->descripteur, LOCK_SH);
+		}
+	}
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	if (flag_processus_dans_section_critique) {
-		int mutex_unlock_result = pthread_mutex_unlock( mutex );
-		if(mutex_unlock_result != 0) {
-			char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
+	// Les places ajoutées ensuite par m_redimensionner sont préchargées ou verrouillées par la première opération qui les voit
+	file->generation = atomic_load_explicit(&ptr_file_de_messages->generation, memory_order_acquire);
+
+	// Moteurs M_DIFFUSION : une connexion en lecture et écriture est un lecteur, qui lit les messages envoyés après elle
+	file->lecteur = -1;
+	file->pid_lecteur = 0;
+	if (moteur_diffusion(ptr_file_de_messages->moteur) && file->type_ouverture_file_de_messages == O_RDWR) {
+		file->pid_lecteur = mon_pid();
+		file->lecteur = accrocher_lecteur(ptr_file_de_messages, NULL);
+		if (file->lecteur == -1) {
+			munmap(ptr_mmap, taille_reservee);
+			if (file->descripteur != -1)
+				close(file->descripteur);
+			free(file);
+			return NULL; // En cas d’échec, m_connexion retourne NULL
 		}
 	}
 
-	flag_processus_dans_section_critique = 0;
+	return file;
 }
 
 /**
-  * Signature   : MESSAGE *m_connexion( const char *nom, int options [, size_t nb_msg, size_t len_max, mode_t mode]);
+  * Signature   : MESSAGE *m_connexion( const char *nom, int options [, size_t nb_msg, size_t len_max, mode_t mode [, size_t taille_octets] [, size_t nb_fragments] [, size_t capacite_maximale]]);
   * Description : Une fonction qui permet soit de se connecter à une file de message existante, soit de créer
   *               une nouvelle file de messages et s’y connecter.
   *
@@ -71,588 +4326,1492 @@ void exit_mutex() {
   **                   -- O_CREAT pour demander la création de la file
   **                   -- O_EXCL, en combinaison avec O_CREAT, indique qu’il faut créer la file seulement si
   **                              elle n’existe pas ; si la file existe déjà, m_connexion doit échouer.
+  **                   -- avec O_CREAT, au plus un moteur :
+  **                      M_MUTEX (par défaut) : un mutex partagé et des canaux d'attente sur futex, n'importe quel nombre de processus ;
+  **                      M_SPSC : anneau sans verrou, pour exactement un processus qui envoie et un processus qui reçoit ;
+  **                               m_envoi/m_reception ne prennent aucun verrou et n'entrent dans le noyau que pour
+  **                               dormir quand l'anneau est plein ou vide. nb_msg est arrondi à une puissance de 2.
+  **                      M_MPMC : anneau sans verrou global pour plusieurs processus qui envoient et reçoivent ;
+  **                               chaque processus réserve sa place par compare-and-swap et ne dort (futex)
+  **                               que si l'anneau est plein ou vide. nb_msg est arrondi à une puissance de 2 (au moins 2).
+  **                      M_PRIORITE : comme M_MUTEX, avec en plus un tas binaire des messages ordonné par (type, ordre d'arrivée) :
+  **                               m_envoi et m_reception sont en O(log n), et une lecture avec type < 0 prend la racine
+  **                               du tas, sans parcourir la file ; les messages de même type restent dans l'ordre FIFO.
+  **                      M_OCTETS : un mutex et un anneau d'octets où chaque message n'occupe que sa longueur
+  **                               (plus un petit en-tête) au lieu de len_max octets ; la file est pleine quand l'anneau
+  **                               n'a plus assez d'octets libres ou qu'elle contient nb_msg messages.
+  **                               Les lectures se font dans l'ordre d'arrivée (type == 0).
+  **                      M_DIFFUSION : un anneau écrit une fois et lu par tous : chaque connexion O_RDWR est un lecteur
+  **                               (au plus NB_LECTEURS) qui lit, dans l'ordre d'arrivée, tous les messages envoyés
+  **                               après sa connexion. Une place n'est réutilisée qu'après la lecture du lecteur
+  **                               le plus lent : les envois attendent (ou échouent avec EAGAIN) tant qu'il la retient.
+  **                               Les connexions O_WRONLY ne font qu'envoyer. nb_msg est arrondi à une puissance de 2.
+  **                               Après fork() (une file anonyme se partage ainsi), l'enfant prend son propre lecteur
+  **                               à sa première lecture, à la position de celui du père : chacun reçoit tous les messages.
+  **                               Le père reste un lecteur, qui retient l'anneau tant qu'il ne lit pas.
+  **                      M_DIFFUSION_ABANDON : comme M_DIFFUSION, mais un lecteur qui retient l'anneau plein est décroché :
+  **                               sa lecture suivante échoue avec EOVERFLOW, puis il reprend aux nouveaux messages.
+  **                   -- avec O_CREAT, M_ALIGNE : chaque message commence sur une ligne de cache.
+  **                   -- avec O_CREAT, M_FRAGMENTS : nb_fragments sous-files indépendantes dans le même objet mémoire,
+  **                      chacune avec son mutex (ou ses curseurs) et sa part de nb_msg et de taille_octets.
+  **                      Un message va dans le fragment de son type : l'ordre d'arrivée n'est garanti qu'entre messages
+  **                      du même type. Une lecture avec type > 0 ne regarde que le fragment de ce type ; avec type <= 0,
+  **                      elle prend le premier message convenable d'un fragment, à tour de rôle (avec type < 0, le plus
+  **                      petit type de ce fragment). m_envoi_reserve répartit les places entre les fragments : l'ordre
+  **                      des envois sans copie n'est pas garanti, même pour un type. Pas avec M_SPSC ; pas de m_fd().
+  **                   -- avec O_CREAT, M_EXTENSIBLE : seulement M_MUTEX et M_PRIORITE, sans M_FRAGMENTS (ni M_GRANDES_PAGES
+  **                      pour une file anonyme) ; m_redimensionner pourra faire grandir la file jusqu'à capacite_maximale.
+  **                      L'index des types, le tas et les descripteurs sont prévus pour capacite_maximale dès la création :
+  **                      l'objet mémoire, M_PRECHARGE et M_MLOCK comptent leur place. Sans M_EXTENSIBLE, la file ne grandit
+  **                      pas au-delà de nb_msg.
+  **                   -- avec ou sans O_CREAT, les options de projection de ce processus :
+  **                      M_GRANDES_PAGES : des grandes pages (MAP_HUGETLB pour une file anonyme, sinon grandes pages
+  **                               transparentes) ; à défaut, la file est projetée sur des pages normales.
+  **                      M_PRECHARGE : toutes les pages sont touchées dès la connexion (MAP_POPULATE).
+  **                      M_MLOCK : les pages sont verrouillées en mémoire ; m_connexion échoue si mlock() échoue (RLIMIT_MEMLOCK).
   ** size_t nb_msg   : le nombre (minimal) de messages qu’on peut stocker avant que la file soit pleine
   ** size_t len_max  : la longueur maximale d’un message.
   ** mode_t mode     : les permissions accordées pour la nouvelle file de messages
   **                   (« OR » bit-à-bit des constantes définies pour chmod, cf man 2 chmod).
+  ** size_t taille_octets : seulement avec O_CREAT et M_OCTETS, la taille de l'anneau en octets ;
+  **                   0 pour autant que nb_msg messages de len_max octets. Elle est arrondie, et au moins assez grande
+  **                   pour un message de len_max octets.
+  ** size_t nb_fragments : seulement avec O_CREAT et M_FRAGMENTS, le nombre de fragments, dans [1..NB_FRAGMENTS_MAX].
+  ** size_t capacite_maximale : seulement avec O_CREAT et M_EXTENSIBLE, la capacité jusqu'à laquelle la file pourra grandir,
+  **                   au moins nb_msg.
   *
-  * m_connexion est une fonction à nombre variable d’arguments (soit 2, soit 5).
+  * m_connexion est une fonction à nombre variable d’arguments (soit 2, soit 5, plus un pour chacune des options M_OCTETS,
+  * M_FRAGMENTS et M_EXTENSIBLE, dans cet ordre).
   * Si options ne contient pas O_CREAT, alors la fonction m_connexion n’aura que les deux paramètres nom et options
   *
   * m_connexion retourne un pointeur vers un objet de type MESSAGE qui identifie la file de messages et sera utilisé par d’autres fonctions.
-  * En cas d’échec, m_connexion retourne NULL.
+  * En cas d’échec, m_connexion retourne NULL. Une file existante est vérifiée sans rien y écrire (magie, version du format et
+  * somme de contrôle de l’en-tête) : errno prend la valeur EAGAIN si elle est encore en cours de création, EINVAL si l’objet
+  * mémoire ne contient pas une file de ce format.
   */
 MESSAGE *m_connexion(const char *nom, int options, ...) { // Fonction avec un nombre variable de parametres
+	// Fonctions avec un nombre variable de parametres,
+	// source : https://www.rocq.inria.fr/secret/Anne.Canteaut/COURS_C/cours.pdf
 
-	// void * malloc (size_t size)
-	MESSAGE* file = (MESSAGE*) malloc( sizeof(MESSAGE) );
-	if (file == NULL){
-		fprintf(stderr, "L'allocation de mémoire à l'aide de la fonction malloc() a échoué \n");
-		return NULL; // En cas d’échec, m_connexion retourne NULL
+	va_list liste_parametres; // une variable pointant sur la liste des parametres de l’appel
+
+	// va_start(liste_parametres, dernier_parametre);
+	// La variable liste_parametres est d’abord initialisee a l’aide de la macro va_start
+	// dernier_parametre designe l’identificateur du dernier parametre formel fixe de la fonction.
+	va_start(liste_parametres, options);
+
+	MESSAGE* file = connecter(nom, CONNEXION_PARTAGEE, options, liste_parametres);
+
+	// Apres traitement des parametres, on libere la liste a l’aide de va_end :
+	va_end(liste_parametres);
+
+	return file;
+}
+
+/**
+  * Signature   : MESSAGE *m_connexion_fichier( const char *chemin, int options [, size_t nb_msg, size_t len_max, mode_t mode [, size_t capacite_maximale]]);
+  * Description : Une fonction qui se connecte, comme m_connexion(), à une file durable placée dans le fichier ordinaire chemin
+  *               (créé avec O_CREAT) : la file survit à l’arrêt de la machine. Seulement les moteurs M_MUTEX et M_PRIORITE,
+  *               sans M_FRAGMENTS.
+  *               Chaque connexion (sauf O_RDONLY) garde un verrou flock() partagé sur le fichier ; celle qui obtient le verrou
+  *               exclusif est seule sur la file : elle crée la file si le fichier est vide, la restaure sinon (cf. restaurer_file),
+  *               même avec O_CREAT. Les autres attendent la fin de la création ou de la restauration.
+  *               Les pages modifiées sont écrites sur le disque par msync(), par groupes d’opérations (cf. m_validation_groupee),
+  *               puis à la déconnexion.
+  *
+  * Parametres : ceux de m_connexion() ; chemin ne peut pas être NULL.
+  *
+  * m_connexion_fichier retourne un pointeur vers un objet de type MESSAGE, ou NULL en cas d’échec
+  * (EINVAL : moteur impossible, ou fichier qui ne contient pas une file durable).
+  */
+MESSAGE *m_connexion_fichier(const char *chemin, int options, ...) {
+
+	if (chemin == NULL) {
+		errno = EINVAL;
+		return NULL; // En cas d’échec, m_connexion_fichier retourne NULL
 	}
 
-	// On va stocker dans cette variable les valeurs qu'on veut passer plus tard pour l'argument protect de la fonction mmap()
-	int mmap_protect;
+	va_list liste_parametres;
+	va_start(liste_parametres, options);
+
+	MESSAGE* file = connecter(chemin, CONNEXION_FICHIER, options, liste_parametres);
+
+	va_end(liste_parametres);
+
+	return file;
+}
+
+/**
+  * Signature   : MESSAGE *m_connexion_locale(int options, size_t nb_msg, size_t len_max [, size_t taille_octets] [, size_t nb_fragments] [, size_t capacite_maximale]);
+  * Description : Une fonction qui crée une file locale : une file anonyme pour les threads du processus appelant seulement.
+  *               Elle est allouée par calloc() au lieu d’être projetée par mmap(), et ses mutex et ses futex sont privés
+  *               (PTHREAD_PROCESS_PRIVATE, FUTEX_PRIVATE_FLAG) : la création ne fait aucun appel système, et chaque
+  *               attente ou réveil coûte moins au noyau. Tous les threads se servent du MESSAGE retourné ; m_deconnexion()
+  *               libère la file, quand plus aucun thread ne s’en sert.
+  *
+  * Parametres : ceux de m_connexion() pour une nouvelle file, sans nom ni mode ; O_CREAT et O_RDWR sont implicites.
+  *              Tous les moteurs sauf M_DIFFUSION et M_DIFFUSION_ABANDON (la file n'a qu'une connexion, donc qu'un lecteur),
+  *              et aucune option de projection (M_GRANDES_PAGES, M_PRECHARGE, M_MLOCK).
+  *
+  * m_connexion_locale retourne un pointeur vers un objet de type MESSAGE, ou NULL en cas d’échec (EINVAL : moteur ou option impossible).
+  */
+MESSAGE *m_connexion_locale(int options, ...) {
+
+	va_list liste_parametres;
+	va_start(liste_parametres, options);
+
+	MESSAGE* file = connecter(NULL, CONNEXION_LOCALE, (options & ~O_ACCMODE) | O_RDWR | O_CREAT, liste_parametres);
+
+	va_end(liste_parametres);
+
+	return file;
+}
+
+// connecter() sans paramètres variables (sans O_CREAT), pour m_observation()
+static MESSAGE* connecter_existante(const char *nom, int sorte, int options, ...) {
+
+	va_list liste_parametres;
+	va_start(liste_parametres, options);
+
+	MESSAGE* file = connecter(nom, sorte, options, liste_parametres);
+
+	va_end(liste_parametres);
+
+	return file;
+}
+
+/**
+  * Signature   : MESSAGE *m_observation(const char *nom, int options);
+  * Description : Une fonction qui se connecte à la file existante nom pour la surveiller : l’objet mémoire est ouvert
+  *               en O_RDONLY et projeté en lecture seule (PROT_READ), et la connexion n’écrit rien dans la file.
+  *               Un processus qui n’a que le droit de lecture sur l’objet mémoire peut ainsi lire l’état de la file
+  *               (m_nb, m_capacite, m_capacite_octets, m_message_len, m_stats).
+  *               Les fonctions qui écrivent dans la file échouent avec EBADF : les envois, les lectures de messages
+  *               (m_reception, m_reception_peek, m_reception_release, m_reception_lot ...), m_fd(),
+  *               enregistrement_notifications() et annuler_enregistrement().
+  *
+  * Parametres :
+  ** const char *nom : le nom de la file, qui ne peut pas être NULL.
+  ** int options     : 0, ou les options de projection de ce processus (M_GRANDES_PAGES, M_PRECHARGE, M_MLOCK) ;
+  **                   les autres bits sont ignorés.
+  *
+  * m_observation retourne un pointeur vers un objet de type MESSAGE, ou NULL en cas d’échec
+  * (EINVAL si nom est NULL ; sinon comme m_connexion() sans O_CREAT).
+  */
+MESSAGE *m_observation(const char *nom, int options) {
+
+	if (nom == NULL) {
+		errno = EINVAL;
+		return NULL; // En cas d’échec, m_observation retourne NULL
+	}
+
+	return connecter_existante(nom, CONNEXION_OBSERVATION, O_RDONLY | (options & (M_GRANDES_PAGES | M_PRECHARGE | M_MLOCK)));
+}
+
+/**
+  * Signature : int m_deconnexion(MESSAGE *file);
+  * Description : Une fonction qui déconnecte le processus de la file de messages ;
+  *               celle-ci n’est pas détruite, mais devient inutilisable.
+  *
+  * Parametres :
+  ** MESSAGE *file : la file de messages.
+  *
+  * Valeur de retour : 0 si OK et −1 en cas d’erreur.
+  */
+int m_deconnexion(MESSAGE *file) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+
+	// Fermer les descripteurs de m_fd() ouverts sur cette file, et les FIFO des autres processus gardées ouvertes pour leur écrire
+	pthread_mutex_lock(&mutex_descripteurs);
+	DESCRIPTEUR_LOCAL** local = &descripteurs_locaux;
+	while (*local != NULL) {
+		DESCRIPTEUR_LOCAL* courant = *local;
+		if (courant->file == ptr_file_de_messages) {
+			fermer_descripteur(courant);
+			*local = courant->suivant;
+			free(courant);
+			atomic_fetch_sub_explicit(&nombre_descripteurs_locaux, 1, memory_order_relaxed);
+		} else {
+			local = &courant->suivant;
+		}
+	}
+
+	FIFO_OUVERTE** fifo = &fifos_ouvertes;
+	while (*fifo != NULL) {
+		FIFO_OUVERTE* courante = *fifo;
+		if (courante->file == ptr_file_de_messages) {
+			if (courante->fd != -1)
+				close(courante->fd);
+			*fifo = courante->suivant;
+			free(courante);
+		} else {
+			fifo = &courante->suivant;
+		}
+	}
+	pthread_mutex_unlock(&mutex_descripteurs);
+
+	// Moteurs M_DIFFUSION : les envois n'attendent plus ce lecteur
+	// (un enfant qui n'a pas encore lu n'a pas de lecteur à lui : celui de la connexion reste au père)
+	if (file->lecteur != -1 && file->pid_lecteur == mon_pid())
+		decrocher_lecteur(ptr_file_de_messages, &lecteurs_diffusion(ptr_file_de_messages)[file->lecteur]);
+
+	// Files durables : les dernières opérations sont écrites sur le disque
+	if (ptr_file_de_messages->durable && file->type_ouverture_file_de_messages != O_RDONLY && valider_file(ptr_file_de_messages) == -1)
+		perror("Fonction msync()");
+
+	// Le verrou flock() d'une file durable est rendu avec le descripteur
+	if (file->descripteur != -1)
+		close(file->descripteur);
+
+	// Une file locale disparaît avec sa seule connexion
+	if (file->bloc_local != NULL) {
+		free(file->bloc_local);
+		return 0;
+	}
+
+	// int munmap(vois *adr, size_t len) ; la taille projetée peut dépasser celle de la file (grandes pages, place réservée)
+	return munmap( (void *) ptr_file_de_messages, file->taille_projection);
+}
+
+/**
+  * Signature : int m_destruction(const char *nom);
+  * Description : Une fonction qui demande la suppression de la file de messages ;
+  *               la suppression effective n’a lieu que quand le dernier processus connecté se déconnecte de la file ;
+  *               en revanche, une fois m_destruction() exécutée par un processus, toutes les tentatives de m_connexion ultérieures échouent.
+  *
+  * Parametres :
+  ** const char *nom : le nom de la file.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec.
+  */
+int m_destruction(const char *nom) {
+
+	// int shm_unlink(cont char *name);
+	return shm_unlink(nom);
+}
+
+/**
+  * Signature : int m_envoi(MESSAGE *file, const void *msg, size_t len, int msgflag);
+  * Description : Une fonction qui envoie le message dans la file.
+  *
+  * Parametres :
+  ** MESSAGE *file   : la file de messages.
+  ** const void *msg : un pointeur vers le message à envoyer.
+  ** size_t len      : la longueur du message en octets (la longueur du champ mtext de struct mon_message).
+  ** int msgflag     : le paramètre msgflag peut prendre deux valeurs,
+  **                   -- 0 :  le processus appelant est bloqué jusqu’à ce que le message soit envoyé;
+  **                           cela peut arriver quand il n’y a plus de place dans la file
+  **                   -- O_NONBLOCK : s’il n’y a pas de place dans la file, alors l’appel retourne tout de suite
+  **                                   avec la valeur de retour −1 et errno prend la valeur EAGAIN.
+  *
+  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon
+  * Si la longueur du message est plus grande que la longueur maximale supportée par la file (et que celle des messages
+  * hors ligne de la connexion, cf. m_hors_ligne), la fonction retourne immédiatement −1 et met EMSGSIZE dans errno.
+  */
+int m_envoi(MESSAGE *file, const void *msg, size_t len, int msgflag) {
+
+	// Vérifier que l’opération est autorisée, par exemple m_envoi() échoue si la file a été ouverte seulement en lecture
+	if (file->type_ouverture_file_de_messages == O_RDONLY)
+		return -1; // échec
+
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+
+	// Si la longueur du message est plus grande que la longueur maximale supportée par la file,
+	//la fonction retourne immédiatement −1 et met EMSGSIZE dans errno (sauf message hors ligne, cf. m_hors_ligne).
+	if(len > ptr_file_de_messages->longueur_maximale_message && len > file->longueur_hors_ligne) {
+		errno = EMSGSIZE;
+		return -1;  // échec
+
+	}
+
+	struct mon_message* ptr_message = (struct mon_message *) msg;
+
+	// M_FRAGMENTS : l'envoi dans le fragment du type
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		MESSAGE sous_file = message_fragment(file, fragment_du_type(ptr_file_de_messages, ptr_message->type));
+		if (m_envoi(&sous_file, msg, len, msgflag) == -1)
+			return -1; // échec
+
+		signaler_fragments(ptr_file_de_messages);
+		return 0;
+	}
+
+	if (ptr_file_de_messages->moteur == M_OCTETS) {
+		if (envoi_octets(ptr_file_de_messages, ptr_message, len, msgflag) == -1) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+			return -1; // échec
+		}
+
+		terminer_envois(ptr_file_de_messages, 1, len);
+		return 0;
+	}
+
+	// Message hors ligne : son objet mémoire est rempli avant de prendre une place, qui ne recevra que la poignée
+	POIGNEE_HORS_LIGNE poignee;
+	if (len > ptr_file_de_messages->longueur_maximale_message) {
+		void* adresse = creer_hors_ligne(len, file->mode_hors_ligne, &poignee);
+		if (adresse == NULL)
+			return -1; // échec
+
+		copier_envoi(adresse, ptr_message->mtext, len);
+		munmap(adresse, len);
+	}
+
+	// Les moteurs sans verrou n'utilisent ni le mutex ni les canaux d'attente
+	if (moteur_sans_verrou(ptr_file_de_messages)) {
+		FILE_ELEMENT* element = reserver_envoi(ptr_file_de_messages, msgflag);
+		if (element == NULL) {
+			if (len > ptr_file_de_messages->longueur_maximale_message)
+				supprimer_hors_ligne(&poignee);
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+			return -1; // échec
+		}
+
+		ecrire_place(ptr_file_de_messages, message_element(ptr_file_de_messages, element), ptr_message->mtext, len, &poignee);
+		publier_envoi(ptr_file_de_messages, element, ptr_message->type, len);
+
+		terminer_envois(ptr_file_de_messages, 1, len);
+		return 0;
+	}
+
+	// Une seule section critique : prendre un élément libre, y copier le message et le chaîner
+	verrouiller(ptr_file_de_messages);
+
+	int index_libre = prendre_element_libre(ptr_file_de_messages, msgflag);
+	if (index_libre == -1) { // échec : ne pas garder le mutex
+		deverrouiller(ptr_file_de_messages);
+		if (len > ptr_file_de_messages->longueur_maximale_message)
+			supprimer_hors_ligne(&poignee);
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+		return -1;
+	}
+
+	// Le message est copié avant d'être chaîné : un lecteur ne peut pas voir un élément à moitié rempli
+	ecrire_place(ptr_file_de_messages, place_message(ptr_file_de_messages, index_libre), ptr_message->mtext, len, &poignee);
+	publier_element(ptr_file_de_messages, index_libre, ptr_message->type, len);
+
+	deverrouiller(ptr_file_de_messages);
+
+	// Signaler le nouveau message aux processus suspendus sur les canaux d'attente
+	signaler_messages(ptr_file_de_messages, canal_type(ptr_message->type), 1);
+	envoyer_notifications(ptr_file_de_messages, ptr_message->type);
+
+	terminer_envois(ptr_file_de_messages, 1, len);
+	return 0 ; // La fonction retourne 0 quand l’envoi réussit
+}
+
+/**
+  * Signature : ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags);
+  * Description : Une fonction qui lit le premier message convenable sur la file, le copie à l’adresse msg et le
+  *               supprime de la file. Une file de messages est une file FIFO : si on écrit les messages a, b, c dans cet ordre,
+  *               et si on lit avec type==0, alors les lectures successives retournent a, b, c dans le même ordre.
+  *
+  * Parametres :
+  ** MESSAGE *file : la file de messages.
+  ** void *msg     : l’adresse à laquelle la fonction doit copier le message lu ; ce message sera supprimé de la file.
+  ** size_t len    : la longueur (en octets) de mémoire à l’adresse msg.
+  ** long type     : Le paramètre type précise la demande,
+  **                 -- type == 0 : lire le premier message dans la file
+  **                 -- type > 0 : lire le premier message dont le type est type ;
+  **                    grâce au type, plusieurs processus peuvent utiliser la même file de messages,
+  **                    par exemple chaque processus peut utiliser son pid comme valeur de type ;
+  **                 -- type < 0 : traiter la file comme une file de priorité ; en l’occurrence, cela signifie :
+  **                               lire le premier message dont le type est inférieur ou égal à la valeur absolue de type.
+  ** int flags     : Le paramètre flags peut prendre soit la valeur 0, soit O_NONBLOCK
+  **                 -- flags == 0 : l’appel est bloquant jusqu’à ce que la lecture réussisse.
+  **                 -- si flags == O_NONBLOCK, et s’il n’y a pas de message du type demandé dans la file,
+  **                                l’appel retourne tout de suite avec la valeur −1 et errno == EAGAIN.
+  *
+  * Le moteur M_MUTEX chaîne les messages de chaque type et les retrouve par une table de hachage : une lecture avec type > 0
+  * ne parcourt pas la file, et elle attend sur son propre canal, indépendamment des lectures des autres types.
+  * Le moteur M_PRIORITE tient aussi un tas : une lecture avec type < 0 est alors en O(log n).
+  * Les moteurs M_SPSC, M_MPMC et M_OCTETS ne lisent que dans l’ordre d’arrivée : type doit valoir 0, sinon errno prend la valeur EINVAL.
+  * Avec les moteurs M_DIFFUSION, chaque connexion lit tous les messages : le message lu n’est supprimé que pour elle.
+  *
+  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec.
+  * si len est inférieur à la longueur du message à lire, m_reception() échoue et retourne −1 et errno prend la valeur EMSGSIZE.
+  * Avec M_DIFFUSION_ABANDON, errno prend la valeur EOVERFLOW si des messages ont été perdus pour ce lecteur trop lent.
+  * Un message hors ligne (cf. m_hors_ligne) est copié depuis son objet mémoire ; si l’objet ne peut pas être ouvert ou projeté,
+  * le message est perdu, et errno est celui de shm_open() ou de mmap().
+  */
+ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags){
+
+	// Vérifier que l’opération est autorisée, par exemple m_reception() échoue si la file a été ouverte seulement en ecriture
+	// (ou par m_observation, en lecture seule)
+	if (file->type_ouverture_file_de_messages == O_WRONLY || file->observation) {
+		errno = EBADF;
+		return -1; // échec
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	if (lecture_fifo_seulement(ptr_file_de_messages) && type != 0) {
+		errno = EINVAL;
+		return -1; // échec
+	}
+
+	// M_FRAGMENTS : le fragment du type, ou n'importe quel fragment
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		if (type > 0) {
+			MESSAGE sous_file = message_fragment(file, fragment_du_type(ptr_file_de_messages, type));
+			return m_reception(&sous_file, msg, len, type, flags);
+		}
+
+		ARGUMENTS_LECTURE arguments = { .sorte = LECTURE_COPIE, .msg = msg, .len = len, .type = type };
+		return lire_fragments(file, &arguments, flags);
+	}
+
+	if (ptr_file_de_messages->moteur == M_OCTETS) {
+		ssize_t nombre_octets_message_lu = reception_octets(ptr_file_de_messages, msg, len, flags);
+		if (nombre_octets_message_lu == -1) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+			return -1; // échec
+		}
+
+		terminer_receptions(ptr_file_de_messages, 1, nombre_octets_message_lu);
+		return nombre_octets_message_lu;
+	}
+
+	// Moteurs M_DIFFUSION : le prochain message de ce lecteur
+	if (moteur_diffusion(ptr_file_de_messages->moteur)) {
+		if (file->lecteur == -1) {
+			errno = EBADF;
+			return -1; // échec : cette connexion n'est pas un lecteur
+		}
+
+		LECTEUR_DIFFUSION* lecteur = lecteur_diffusion(file);
+		ssize_t nombre_octets_message_lu = lecteur == NULL ? -1 : reception_diffusion(ptr_file_de_messages, lecteur, msg, len, flags);
+		if (nombre_octets_message_lu == -1) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+			return -1; // échec
+		}
+
+		terminer_receptions(ptr_file_de_messages, 1, nombre_octets_message_lu);
+		return nombre_octets_message_lu;
+	}
+
+	// Les moteurs sans verrou n'utilisent ni le mutex ni les canaux d'attente
+	if (moteur_sans_verrou(ptr_file_de_messages)) {
+		FILE_ELEMENT* element = reserver_reception(ptr_file_de_messages, len, type, flags);
+		if (element == NULL) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+			return -1; // échec
+		}
+
+		ssize_t nombre_octets_message_lu = element->longueur_message;
+		POIGNEE_HORS_LIGNE poignee;
+
+		lire_place(ptr_file_de_messages, element, msg, &poignee);
+		liberer_reception(ptr_file_de_messages, element);
+
+		return achever_reception(ptr_file_de_messages, nombre_octets_message_lu, &poignee, msg);
+	}
+
+	// Une seule section critique : trouver le message, le copier et rendre son élément
+	verrouiller(ptr_file_de_messages);
+
+	int index_message = chercher_message(ptr_file_de_messages, len, type, flags);
+	if (index_message == -1) { // échec : ne pas garder le mutex
+		deverrouiller(ptr_file_de_messages);
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+		return -1;
+	}
+
+	FILE_ELEMENT* element = element_file(ptr_file_de_messages, index_message);
+	ssize_t nombre_octets_message_lu = element->longueur_message;
+	POIGNEE_HORS_LIGNE poignee;
+
+	lire_place(ptr_file_de_messages, element, msg, &poignee);
+
+	// Retirer le message de la file et de la liste de son type, puis rendre l'élément à la liste des éléments libres
+	retirer_message(ptr_file_de_messages, index_message);
+	rendre_element_libre(ptr_file_de_messages, index_message);
+
+	deverrouiller(ptr_file_de_messages);
+
+	// Signaler la nouvelle place libre aux processus suspendus sur le canal d'attente
+	signaler_places(ptr_file_de_messages, 1);
+
+	return achever_reception(ptr_file_de_messages, nombre_octets_message_lu, &poignee, msg);
+}
+
+/* Les attentes bornées et la durée de vie des messages */
+
+// Une échéance valide : tv_nsec dans [0, 1e9[ (NULL veut dire sans échéance)
+static int echeance_valide(const struct timespec *echeance) {
+	return echeance == NULL || (echeance->tv_sec >= 0 && echeance->tv_nsec >= 0 && echeance->tv_nsec < 1000000000);
+}
+
+/**
+  * Signature : int m_envoi_timeout(MESSAGE *file, const void *msg, size_t len, const struct timespec *echeance);
+  * Description : Une fonction qui envoie le message comme m_envoi() avec msgflag == 0, mais qui n’attend une place
+  *               que jusqu’à l’heure echeance de l’horloge CLOCK_MONOTONIC : une échéance absolue, que l’appelant
+  *               calcule une fois (clock_gettime(CLOCK_MONOTONIC, ...) plus son délai) et peut passer à plusieurs appels.
+  *
+  * Parametres :
+  ** MESSAGE *file                  : la file de messages.
+  ** const void *msg                : le message à envoyer (un struct mon_message, comme pour m_envoi()).
+  ** size_t len                     : la longueur du message en octets.
+  ** const struct timespec *echeance : l’heure limite, ou NULL pour attendre sans limite.
+  *
+  * L’échéance borne les attentes d’une place ; le mutex de la file, tenu le temps d’une copie, est pris sans limite.
+  *
+  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon.
+  * errno prend la valeur ETIMEDOUT si l’échéance est passée avant qu’une place se libère, EINVAL si echeance n’est pas valide.
+  */
+int m_envoi_timeout(MESSAGE *file, const void *msg, size_t len, const struct timespec *echeance) {
+
+	if (! echeance_valide(echeance)) {
+		errno = EINVAL;
+		return -1; // échec
+	}
+
+	echeance_attente = echeance;
+	int resultat = m_envoi(file, msg, len, 0);
+	echeance_attente = NULL;
+
+	return resultat;
+}
+
+/**
+  * Signature : ssize_t m_reception_timeout(MESSAGE *file, void *msg, size_t len, long type, const struct timespec *echeance);
+  * Description : Une fonction qui lit un message comme m_reception() avec flags == 0, mais qui ne l’attend que
+  *               jusqu’à l’heure echeance de l’horloge CLOCK_MONOTONIC (cf. m_envoi_timeout).
+  *
+  * Parametres :
+  ** MESSAGE *file                  : la file de messages.
+  ** void *msg, size_t len, long type : comme pour m_reception().
+  ** const struct timespec *echeance : l’heure limite, ou NULL pour attendre sans limite.
+  *
+  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec.
+  * errno prend la valeur ETIMEDOUT si l’échéance est passée sans message convenable, EINVAL si echeance n’est pas valide.
+  */
+ssize_t m_reception_timeout(MESSAGE *file, void *msg, size_t len, long type, const struct timespec *echeance) {
 
-	// options est un « OR » bit-à-bit de constantes : O_RDWR, O_RDONLY, O_WRONLY, O_CREAT, O_EXCL ....
-	// exactement une de ces constantes doit être spécifiée : O_RDWR, O_RDONLY, O_WRONLY
-	// Le but ici est de vérifier laquelle des trois constantes a été transférée à la fonction,
-	// afin de savoir si on est en mode lecture / écriture / lecture et écriture
+	if (! echeance_valide(echeance)) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-    // &  : l'opérateur AND binaire copie un bit dans le résultat s'il existe dans les deux opérandes.
-	   if ( ((O_RDWR & options) == O_RDWR)  ) {
-		   mmap_protect = PROT_READ | PROT_WRITE;
-		   file->type_ouverture_file_de_messages = O_RDWR;
+	echeance_attente = echeance;
+	ssize_t resultat = m_reception(file, msg, len, type, 0);
+	echeance_attente = NULL;
 
-	   } else if ( ((O_WRONLY & options) == O_WRONLY) ){
-		   mmap_protect = PROT_READ | PROT_WRITE; // Pour mmap(), pour pouvoir écrire, il faut aussi ajouter la constante de lecture
-		   file->type_ouverture_file_de_messages = O_WRONLY;
+	return resultat;
+}
 
-	   } else if ( ((O_RDONLY & options) == O_RDONLY) ) {
-			file->type_ouverture_file_de_messages = O_RDONLY;
-		    mmap_protect = PROT_READ ;
-	   } else {
-		   return NULL; // En cas d’échec, m_connexion retourne NULL
-	   }
+/**
+  * Signature : int m_envoi_ttl(MESSAGE *file, const void *msg, size_t len, int msgflag, const struct timespec *duree_vie);
+  * Description : Une fonction qui envoie le message comme m_envoi(), avec une durée de vie : s’il n’est pas lu
+  *               avant duree_vie (comptée à partir de sa publication), il est périmé. Les lectures (m_reception,
+  *               m_reception_lot, m_reception_peek ...) jettent les messages périmés qu’elles rencontrent au lieu de
+  *               les retourner, rendent leur place à la file et passent au message suivant.
+  *
+  * Parametres :
+  ** MESSAGE *file                    : la file de messages.
+  ** const void *msg, size_t len, int msgflag : comme pour m_envoi().
+  ** const struct timespec *duree_vie : la durée de vie du message ; NULL ou zéro : il ne périme pas.
+  *
+  * Un message périmé n’est jeté que lorsqu’une lecture arrive à lui : il occupe sa place jusque-là,
+  * et une lecture d’un autre type (moteurs M_MUTEX et M_PRIORITE) ne le voit pas.
+  * Les messages jetés sont comptés dans le champ messages_perimes de m_stats().
+  * Le moteur M_OCTETS ne garde pas de durée de vie dans ses enregistrements.
+  *
+  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon (errno prend la valeur EINVAL si duree_vie n’est pas valide
+  *                    ou si la file utilise le moteur M_OCTETS).
+  */
+int m_envoi_ttl(MESSAGE *file, const void *msg, size_t len, int msgflag, const struct timespec *duree_vie) {
 
-    // Si options contient O_CREAT, alors la fonction m_connexion aura 3 paramètres de plus :
-	size_t nb_msg = 0, len_max = 0;
-	mode_t mode = 0;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	// m_connexion est une fonction à nombre variable d’arguments (soit 2, soit 5).
-	// Si options ne contient pas O_CREAT, alors la fonction m_connexion n’aura que les deux paramètres nom et options
-	if ( (O_CREAT & options) == O_CREAT) { // Si options contient O_CREAT
-		// Fonctions avec un nombre variable de parametres,
-		// source : https://www.rocq.inria.fr/secret/Anne.Canteaut/COURS_C/cours.pdf
+	if (! echeance_valide(duree_vie) || ptr_file_de_messages->moteur == M_OCTETS) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-		va_list liste_parametres; // une variable pointant sur la liste des parametres de l’appel
+	duree_vie_envoi = duree_vie == NULL ? 0 : (uint64_t) duree_vie->tv_sec * 1000000000u + (uint64_t) duree_vie->tv_nsec;
+	int resultat = m_envoi(file, msg, len, msgflag);
+	duree_vie_envoi = 0;
 
-		// va_start(liste_parametres, dernier_parametre);
-		// La variable liste_parametres est d’abord initialisee a l’aide de la macro va_start
-		// dernier_parametre designe l’identificateur du dernier parametre formel fixe de la fonction.
-		va_start(liste_parametres, options);
+	return resultat;
+}
 
-		// va_arg(liste_parametres, type)
-		// On accede aux differents parametres de liste par la macro va_arg
-		// qui retourne le parametre suivant de la liste:
-		nb_msg = va_arg(liste_parametres, size_t);
-		len_max = va_arg(liste_parametres, size_t);
-		mode = va_arg(liste_parametres, mode_t);
+/* L’envoi et la réception sans copie */
 
-		// Apres traitement des parametres, on libere la liste a l’aide de va_end :
-		va_end(liste_parametres);
+/**
+ * m_envoi_reserve() d'un message hors ligne : l'objet mémoire est créé et projeté, puis une place est réservée pour sa poignée.
+ * Retourne la projection, que l'appelant remplit, ou NULL en cas d'échec.
+ */
+static void* reserver_hors_ligne(MESSAGE* file, FILE_DE_MESSAGES* ptr_file_de_messages, size_t len, int msgflag) {
+	POIGNEE_HORS_LIGNE poignee;
+
+	void* adresse = creer_hors_ligne(len, file->mode_hors_ligne, &poignee);
+	if (adresse == NULL)
+		return NULL; // échec
+
+	PROJECTION_HORS_LIGNE* projection = retenir_projection(adresse, len, NULL, 1);
+	FILE_ELEMENT* element = projection == NULL ? NULL : reserver_envoi(ptr_file_de_messages, msgflag);
+	if (element == NULL) {
+		int erreur = errno;
+		if (projection != NULL)
+			oublier_projection(projection);
+		else
+			munmap(adresse, len);
+		supprimer_hors_ligne(&poignee);
+		errno = erreur;
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+		return NULL; // échec
 	}
 
-	// Taille de l'espace mémoire pour l'objet mémoire POSIX que nous voulons projeter en mémoire à l'aide de mmap()
-	int taille_memoire = sizeof(FILE_DE_MESSAGES) + ( nb_msg * sizeof(FILE_ELEMENT) ) + ( len_max * nb_msg );
+	projection->place = message_element(ptr_file_de_messages, element);
+	memcpy(projection->place, &poignee, sizeof(poignee));
 
-	void* ptr_mmap = NULL; // le pointeur vers la mémoire partagée qui contient la file
-	if (nom != NULL) { // <=> une file PAS anonyme
-		// int shm_open(cont char *name, int oflag, mode_t mode);
-		// Le troisième paramètre est ignoré si on ouvre un objet mémoire existant.
-		// Retourne un descripteur fichier si OK, -1 sinon
-		int shm_descripteur = shm_open(nom, options, mode);
-		if(shm_descripteur == -1){
-			perror("Fonction shm_open()");
-			return NULL; // En cas d’échec, m_connexion retourne NULL
-		}
+	return adresse;
+}
 
-		if(nb_msg != 0) { // <=> Si c'est une nouvelle file de messages
+/**
+ * m_reception_peek() d'un message hors ligne, retiré de la file : son objet mémoire est projeté en lecture.
+ * Retourne la projection, ou NULL en cas d'échec ; la place est alors rendue, et le message perdu.
+ */
+static const void* projeter_hors_ligne(FILE_DE_MESSAGES* ptr_file_de_messages, FILE_ELEMENT* element) {
+	POIGNEE_HORS_LIGNE poignee;
+	size_t longueur = (size_t) element->longueur_message;
+
+	memcpy(&poignee, message_element(ptr_file_de_messages, element), sizeof(poignee));
+	void* adresse = ouvrir_hors_ligne(&poignee, longueur);
+	if (adresse != NULL && retenir_projection(adresse, longueur, message_element(ptr_file_de_messages, element), 0) != NULL)
+		return adresse;
+
+	int erreur = errno;
+	if (adresse != NULL)
+		munmap(adresse, longueur);
+	liberer_reception(ptr_file_de_messages, element);
+	errno = erreur;
+	return NULL; // échec
+}
 
-			 // int ftruncate (int fd, off_t length)
-			 // La fonction ftruncate change la taille d'un fichier a la valeur de length.
-			 int ftruncate_result = ftruncate(shm_descripteur, (off_t) taille_memoire);
-			 if(ftruncate_result == -1) {
-				perror("Fonction ftruncate()"); //  void perror (const char *message)
-				return NULL; // En cas d’échec, m_connexion retourne NULL
-			 }
+/**
+  * Signature : void *m_envoi_reserve(MESSAGE *file, size_t len, int msgflag);
+  * Description : Une fonction qui réserve dans la file la place d’un message de len octets au plus, et retourne l’adresse
+  *               où l’écrire. Le message n’est visible des lecteurs qu’après m_envoi_commit() : entre les deux appels,
+  *               l’appelant écrit directement dans la mémoire partagée, sans passer par un tampon intermédiaire.
+  *
+  * Parametres :
+  ** MESSAGE *file : la file de messages.
+  ** size_t len    : la longueur maximale du message qui sera écrit.
+  ** int msgflag   : 0 ou O_NONBLOCK, comme pour m_envoi().
+  *
+  * Une place réservée compte parmi les places occupées : elle doit être publiée par m_envoi_commit().
+  * Avec le moteur M_SPSC, le producteur ne peut réserver qu’une place à la fois.
+  *
+  * Si len est plus grand que la longueur maximale supportée par la file, la place est hors ligne quand la connexion
+  * le permet (cf. m_hors_ligne) : l’adresse retournée est une projection d’un objet mémoire de len octets, où le message
+  * est écrit directement ; la file n’en reçoit que la poignée.
+  *
+  * Valeur de retour : l’adresse de la place réservée (longueur_maximale_message octets, len octets avec le moteur M_OCTETS
+  *                    ou hors ligne), ou NULL en cas d’échec.
+  * Si len est plus grand que la longueur maximale supportée par la file (et que celle des messages hors ligne de la connexion),
+  * errno prend la valeur EMSGSIZE.
+  */
+void *m_envoi_reserve(MESSAGE *file, size_t len, int msgflag) {
 
-		} else { // <=> Si c'est PAS une nouvelle file de messages
-			struct stat buf;
+	if (file->type_ouverture_file_de_messages == O_RDONLY) {
+		errno = EBADF;
+		return NULL; // échec
+	}
 
-			// int fstat (int filedes, struct stat *buf)
-			int fstat_resultat = fstat(shm_descripteur, &buf);
-			if(fstat_resultat == -1){
-				perror("Fonction fstat()");
-				return NULL; // En cas d’échec, m_connexion retourne NULL
-			}
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-			taille_memoire = buf.st_size;
-		}
+	if (len > ptr_file_de_messages->longueur_maximale_message && len > file->longueur_hors_ligne) {
+		errno = EMSGSIZE;
+		return NULL; // échec
+	}
 
-		// void * mmap (void *address, size_t length,int protect, int flags, int filedes, off_t offset)
-		ptr_mmap = mmap((void *) 0, taille_memoire, mmap_protect , MAP_SHARED, shm_descripteur, 0);
-		if(ptr_mmap == MAP_FAILED) {
-			perror("Fonction mmap()"); //  void perror (const char *message)
-			return NULL; // En cas d’échec, m_connexion retourne NULL
+	// M_FRAGMENTS : le type n'est connu qu'à m_envoi_commit ; une place dans le premier fragment qui en a une, à tour de rôle
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		static _Atomic size_t fragment_reserve = 0; // le premier fragment essayé par la prochaine réservation de ce processus
+		size_t k, nombre = ptr_file_de_messages->nombre_fragments;
+		size_t premier = atomic_fetch_add_explicit(&fragment_reserve, 1, memory_order_relaxed) % nombre;
+
+		for (k = 0 ; k < nombre ; k++) {
+			MESSAGE sous_file = message_fragment(file, ( premier + k ) % nombre);
+			void* zone = m_envoi_reserve(&sous_file, len, O_NONBLOCK);
+			if (zone != NULL || errno != EAGAIN || ( msgflag == O_NONBLOCK && k + 1 == nombre ))
+				return zone;
 		}
 
-	} else  { // (nom == NULL) => file anonyme
+		// Tous les fragments sont pleins : attendre une place dans le premier
+		MESSAGE sous_file = message_fragment(file, premier);
+		return m_envoi_reserve(&sous_file, len, msgflag);
+	}
 
-		// void * mmap (void *address, size_t length,int protect, int flags, int filedes, off_t offset)
-		ptr_mmap = mmap((void *) 0, taille_memoire, mmap_protect , MAP_ANON | MAP_SHARED, -1, 0);
-		if(ptr_mmap == MAP_FAILED) {
-			perror("Fonction mmap()"); //  void perror (const char *message)
-			return NULL; // En cas d’échec, m_connexion retourne NULL
-		}
+	if (ptr_file_de_messages->moteur == M_OCTETS) { // la place réservée est de len octets
+		verrouiller(ptr_file_de_messages);
+		ENREGISTREMENT* enregistrement = allouer_enregistrement(ptr_file_de_messages, len, msgflag);
+		deverrouiller(ptr_file_de_messages);
 
+		if (enregistrement == NULL) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+			return NULL; // échec
+		}
+		return enregistrement + 1;
 	}
-	// le pointeur vers la mémoire partagée qui contient la file
-	file->ptr_memoire_partagee = ptr_mmap;
 
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) ptr_mmap;
-	if(nb_msg != 0) { // <=> Si c'est une nouvelle file de messages
+	if (len > ptr_file_de_messages->longueur_maximale_message)
+		return reserver_hors_ligne(file, ptr_file_de_messages, len, msgflag);
 
-		ptr_file_de_messages->capacite = nb_msg;  // La longueur maximale d’un message
-		ptr_file_de_messages->longueur_maximale_message = len_max;  // capacité de la file (le nombre minimal de messages que la file peut stocker)
-		ptr_file_de_messages->nombre_elements_remplis = 0; // le nombre de messages actuellement dans la file
-		ptr_file_de_messages->first = 0; // l’indice du premier élément de la file
-		ptr_file_de_messages->last = 0; // l’indice de premier élément libre de tableau
+	FILE_ELEMENT* element = reserver_envoi(ptr_file_de_messages, msgflag);
+	if (element == NULL) {
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+		return NULL; // échec
+	}
 
-		pthread_mutexattr_t attr;
+	return message_element(ptr_file_de_messages, element);
+}
 
-		// int pthread_mutexattr_init(pthread_mutexattr_t *attr);
-		int mutexattr_init_result = pthread_mutexattr_init(&attr);
-		if(mutexattr_init_result != 0) {
-			char* error_msg = strerror( mutexattr_init_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutexattr_init() : %s \n", error_msg);
-			return NULL; // En cas d’échec, m_connexion retourne NULL
-		}
+// m_envoi_commit() de la place zone ; hors_ligne : la place contient la poignée d'un message de len octets
+static int publier_zone(MESSAGE* file, void* zone, long type, size_t len, int hors_ligne) {
 
-		// int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr,int pshared);
-		// pshared: PTHREAD_PROCESS_PRIVATE, PTHREAD_PROCESS_SHARED
-		// Valeur de retour : 0 si OK, numero d'erreur sinon
-		int mutexattr_setpshared_result = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
-		if(mutexattr_setpshared_result != 0) {
-			char* error_msg = strerror( mutexattr_setpshared_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutexattr_setpshared() : %s \n", error_msg);
-			return NULL; // En cas d’échec, m_connexion retourne NULL
-		}
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-		// int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
-		int mutex_init_result = pthread_mutex_init( &(ptr_file_de_messages->mutex), &attr);
-		if(mutex_init_result != 0) {
-			char* error_msg = strerror( mutex_init_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutex_init() : %s \n", error_msg);
-			return NULL; // En cas d’échec, m_connexion retourne NULL
+	// M_FRAGMENTS : le fragment qui contient la place
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		size_t i = fragment_de_zone(ptr_file_de_messages, zone);
+		if (i == ptr_file_de_messages->nombre_fragments) {
+			errno = EINVAL;
+			return -1; // échec
 		}
 
-		pthread_condattr_t condattr;
+		MESSAGE sous_file = message_fragment(file, i);
+		if (publier_zone(&sous_file, zone, type, len, hors_ligne) == -1)
+			return -1; // échec
 
-		// int pthread_condattr_init(pthread_condattr_t *attr);
-		// Valeur de retour : 0 si OK, numero d'erreur sinon
-		int result_value = pthread_condattr_init(&condattr);
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_condattr_init() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
-		}
+		signaler_fragments(ptr_file_de_messages);
+		return 0;
+	}
 
+	if (ptr_file_de_messages->moteur == M_OCTETS) {
+		verrouiller(ptr_file_de_messages);
 
-		// int pthread_condattr_setpshared(pthread_condattr_t *attr, int pshared);
-		// pshared: PTHREAD_PROCESS_PRIVATE, PTHREAD_PROCESS_SHARED
-		// Valeur de retour : 0 si OK, numero d'erreur sinon
-		result_value = pthread_condattr_setpshared(&condattr ,PTHREAD_PROCESS_SHARED);
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_condattr_setpshared() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
-		}
+		ENREGISTREMENT* enregistrement = enregistrement_de_zone(ptr_file_de_messages, zone, ENREGISTREMENT_RESERVE);
+		int erreur = enregistrement == NULL ? EINVAL : len > enregistrement->longueur ? EMSGSIZE : 0;
+		if (erreur == 0)
+			publier_enregistrement(ptr_file_de_messages, enregistrement, type, len);
 
-		// int pthread_cond_init(pthread_cond_t *restrict cond, const pthread_condattr_t *restrict attr);
-		// Valeur de retour : 0 si OK, numero d'erreur sinon
-		result_value = pthread_cond_init(&(ptr_file_de_messages->attente_file_pleine) ,&condattr);
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_cond_init() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
-		}
+		deverrouiller(ptr_file_de_messages);
 
-		result_value = pthread_cond_init(&(ptr_file_de_messages->attente_file_vide) ,&condattr);
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_cond_init() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
+		if (erreur != 0) {
+			errno = erreur;
+			return -1; // échec
 		}
 
-		// Pointer vers le debut de la file (debut du tableau circulaire)
-		ptr_file_de_messages->tableau_circulaire = (FILE_ELEMENT *) (ptr_file_de_messages + 1);
+		signaler_messages(ptr_file_de_messages, 0, 1);
+		envoyer_notifications(ptr_file_de_messages, type);
 
-		int i;
-		// Nettoyer (Clear) les elements du tableau circulaire (elements de type FILE_ELEMENT)
-		// void * memset (void *block, int c, size_t size)
-		for(i = 0 ; i < nb_msg ; i++)
-			memset(&ptr_file_de_messages->tableau_circulaire[i], 0, sizeof(FILE_ELEMENT) + ptr_file_de_messages->longueur_maximale_message);
-
-		// Nettoyer (Clear) les elements du tableau circulaire (elements de type FILE_ELEMENT)
-		// void * memset (void *block, int c, size_t size)
-		for(i = 0 ; i < NB_PROCESSUS ; i++)
-			memset(&ptr_file_de_messages->notifications[i], 0, sizeof(ENREGISTREMENT_NOTIFICATIONS));
+		terminer_envois(ptr_file_de_messages, 1, len);
+		return 0;
+	}
 
-	} else { // <=> Si c'est PAS une nouvelle file de messages
+	FILE_ELEMENT* element = element_de_zone(ptr_file_de_messages, zone);
+	if (element == NULL) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-		// Lorsque nous ouvrons un objet mémoire existant, nous devons mettre à jour le pointeur
-		// les adresses virtuelles après chaque mmap sont différentes même si mmap est effectué sur le même objet mémoire.
-		ptr_file_de_messages->tableau_circulaire = (FILE_ELEMENT *) (ptr_file_de_messages + 1);
+	if (len > ptr_file_de_messages->longueur_maximale_message && ! hors_ligne) {
+		errno = EMSGSIZE;
+		return -1; // échec
 	}
 
-	// Nous stockons dans une variable globale un pointeur vers notre mutex, pour une utilisation future :
-	// nous définirons une fonction qu'on appellera automatiquement à chaque exit effectuée au milieu de la section critique
-	// (à l'aide de la fonction atexit). Objectif de cette fonction : pthread_mutex_unlock( mutex )
-	mutex = &(ptr_file_de_messages->mutex);
+	publier_envoi(ptr_file_de_messages, element, type, len);
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	flag_processus_dans_section_critique = 0;
-	return file;
+	terminer_envois(ptr_file_de_messages, 1, len);
+	return 0;
 }
 
 /**
-  * Signature : int m_deconnexion(MESSAGE *file);
-  * Description : Une fonction qui déconnecte le processus de la file de messages ;
-  *               celle-ci n’est pas détruite, mais devient inutilisable.
+  * Signature : int m_envoi_commit(MESSAGE *file, void *zone, long type, size_t len);
+  * Description : Une fonction qui publie le message de len octets écrit à l’adresse zone retournée par m_envoi_reserve().
   *
   * Parametres :
   ** MESSAGE *file : la file de messages.
+  ** void *zone    : l’adresse retournée par m_envoi_reserve().
+  ** long type     : le type du message.
+  ** size_t len    : la longueur du message écrit.
   *
-  * Valeur de retour : 0 si OK et −1 en cas d’erreur.
+  * Avec une place hors ligne (cf. m_hors_ligne), le message écrit dans la projection est publié sans copie ;
+  * s’il tient dans la longueur maximale de la file, il est recopié dans sa place et son objet mémoire supprimé.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec ; la place reste alors réservée.
+  * Si zone n’est pas une place de la file, errno prend la valeur EINVAL ;
+  * si len est plus grand que la longueur maximale supportée par la file (que la longueur réservée avec le moteur M_OCTETS
+  * ou pour un message hors ligne),
+  * errno prend la valeur EMSGSIZE.
   */
-int m_deconnexion(MESSAGE *file) {
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
-	int taille_memoire = sizeof(FILE_DE_MESSAGES) + ( ptr_file_de_messages->capacite * sizeof(FILE_ELEMENT) ) + ( ptr_file_de_messages->longueur_maximale_message * ptr_file_de_messages->capacite );
+int m_envoi_commit(MESSAGE *file, void *zone, long type, size_t len) {
+
+	// Place hors ligne : zone est la projection de l'objet mémoire, la place dans la file contient sa poignée
+	PROJECTION_HORS_LIGNE* projection = chercher_projection(zone, 1);
+	if (projection == NULL)
+		return publier_zone(file, zone, type, len, 0);
+
+	if (len > projection->taille) {
+		errno = EMSGSIZE;
+		return -1; // échec
+	}
+
+	void* place = projection->place;
+	int hors_ligne = len > file_de_messages(file)->longueur_maximale_message;
+	if (! hors_ligne) { // le message tient dans sa place : l'objet mémoire ne sert plus
+		POIGNEE_HORS_LIGNE poignee;
+		memcpy(&poignee, place, sizeof(poignee));
+		memcpy(place, projection->adresse, len);
+		supprimer_hors_ligne(&poignee);
+	}
+	oublier_projection(projection);
 
-	// int munmap(vois *adr, size_t len)
-	return munmap( (void *) ptr_file_de_messages, taille_memoire);
+	return publier_zone(file, place, type, len, hors_ligne);
 }
 
 /**
-  * Signature : int m_destruction(const char *nom);
-  * Description : Une fonction qui demande la suppression de la file de messages ;
-  *               la suppression effective n’a lieu que quand le dernier processus connecté se déconnecte de la file ;
-  *               en revanche, une fois m_destruction() exécutée par un processus, toutes les tentatives de m_connexion ultérieures échouent.
+  * Signature : const void *m_reception_peek(MESSAGE *file, size_t *len, long type, int flags);
+  * Description : Une fonction qui retire de la file le premier message convenable, comme m_reception(), mais ne le copie pas :
+  *               elle retourne son adresse dans la mémoire partagée. La place du message n’est rendue à la file
+  *               qu’après m_reception_release().
   *
   * Parametres :
-  ** const char *nom : le nom de la file.
+  ** MESSAGE *file : la file de messages.
+  ** size_t *len   : si len n’est pas NULL, la longueur du message lu y est écrite.
+  ** long type     : la demande, comme pour m_reception().
+  ** int flags     : 0 ou O_NONBLOCK, comme pour m_reception().
   *
-  * Valeur de retour : 0 si OK, −1 si échec.
+  * Un message hors ligne (cf. m_hors_ligne) n’est pas dans la file : l’adresse retournée est une projection en lecture
+  * de son objet mémoire, défaite par m_reception_release(). Si l’objet ne peut pas être projeté, le message est perdu.
+  *
+  * Valeur de retour : l’adresse du message lu, ou NULL en cas d’échec.
   */
-int m_destruction(const char *nom) {
+const void *m_reception_peek(MESSAGE *file, size_t *len, long type, int flags) {
 
-	// int shm_unlink(cont char *name);
-	return shm_unlink(nom);
+	if (file->type_ouverture_file_de_messages == O_WRONLY || file->observation) {
+		errno = EBADF;
+		return NULL; // échec
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	// M_FRAGMENTS : le fragment du type, ou n'importe quel fragment
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		if (type > 0) {
+			MESSAGE sous_file = message_fragment(file, fragment_du_type(ptr_file_de_messages, type));
+			return m_reception_peek(&sous_file, len, type, flags);
+		}
+
+		ARGUMENTS_LECTURE arguments = { .sorte = LECTURE_SANS_COPIE, .longueur = len, .type = type };
+		return lire_fragments(file, &arguments, flags) == -1 ? NULL : arguments.zone;
+	}
+
+	if (ptr_file_de_messages->moteur == M_OCTETS) {
+		if (type != 0) {
+			errno = EINVAL;
+			return NULL; // échec
+		}
+
+		verrouiller(ptr_file_de_messages);
+		ENREGISTREMENT* enregistrement = chercher_enregistrement(ptr_file_de_messages, SIZE_MAX, flags);
+		if (enregistrement != NULL)
+			retirer_enregistrement(ptr_file_de_messages, enregistrement);
+		deverrouiller(ptr_file_de_messages);
+
+		if (enregistrement == NULL) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+			return NULL; // échec
+		}
+
+		compter_receptions(ptr_file_de_messages, 1, enregistrement->longueur); // la place n'est libre qu'après m_reception_release()
+		if (len != NULL)
+			*len = enregistrement->longueur;
+		return enregistrement + 1;
+	}
+
+	// Moteurs M_DIFFUSION : le message reste celui de ce lecteur jusqu'à m_reception_release()
+	if (moteur_diffusion(ptr_file_de_messages->moteur)) {
+		if (file->lecteur == -1 || type != 0) {
+			errno = file->lecteur == -1 ? EBADF : EINVAL;
+			return NULL; // échec
+		}
+
+		size_t longueur;
+		LECTEUR_DIFFUSION* lecteur = lecteur_diffusion(file);
+		FILE_ELEMENT* element = lecteur == NULL ? NULL : reserver_reception_diffusion(ptr_file_de_messages, lecteur, SIZE_MAX, &longueur, flags);
+		if (element == NULL) {
+			terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+			return NULL; // échec
+		}
+
+		compter_receptions(ptr_file_de_messages, 1, longueur);
+		if (len != NULL)
+			*len = longueur;
+		return message_element(ptr_file_de_messages, element);
+	}
+
+	// Aucune limite de longueur : le message n’est pas copié
+	FILE_ELEMENT* element = reserver_reception(ptr_file_de_messages, SIZE_MAX, type, flags);
+	if (element == NULL) {
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+		return NULL; // échec
+	}
+
+	compter_receptions(ptr_file_de_messages, 1, element->longueur_message); // la place n'est libre qu'après m_reception_release()
+	if (len != NULL)
+		*len = element->longueur_message;
+
+	if (element_hors_ligne(ptr_file_de_messages, element))
+		return projeter_hors_ligne(ptr_file_de_messages, element);
+
+	return message_element(ptr_file_de_messages, element);
 }
 
 /**
-  * Signature : int m_envoi(MESSAGE *file, const void *msg, size_t len, int msgflag);
-  * Description : Une fonction qui envoie le message dans la file.
+  * Signature : int m_reception_release(MESSAGE *file, const void *zone);
+  * Description : Une fonction qui rend à la file la place du message retourné par m_reception_peek() ;
+  *               le message ne doit plus être lu après cet appel.
   *
   * Parametres :
-  ** MESSAGE *file   : la file de messages.
-  ** const void *msg : un pointeur vers le message à envoyer.
-  ** size_t len      : la longueur du message en octets (la longueur du champ mtext de struct mon_message).
-  ** int msgflag     : le paramètre msgflag peut prendre deux valeurs,
-  **                   -- 0 :  le processus appelant est bloqué jusqu’à ce que le message soit envoyé;
-  **                           cela peut arriver quand il n’y a plus de place dans la file
-  **                   -- O_NONBLOCK : s’il n’y a pas de place dans la file, alors l’appel retourne tout de suite
-  **                                   avec la valeur de retour −1 et errno prend la valeur EAGAIN.
+  ** MESSAGE *file    : la file de messages.
+  ** const void *zone : l’adresse retournée par m_reception_peek().
   *
-  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon
-  * Si la longueur du message est plus grande que la longueur maximale supportée par la file,
-  * la fonction retourne immédiatement −1 et met EMSGSIZE dans errno.
+  * Valeur de retour : 0 si OK, −1 si échec (errno prend la valeur EINVAL si zone n’est pas une place de la file).
   */
-int m_envoi(MESSAGE *file, const void *msg, size_t len, int msgflag) {
+int m_reception_release(MESSAGE *file, const void *zone) {
 
-	// Vérifier que l’opération est autorisée, par exemple m_envoi() échoue si la file a été ouverte seulement en lecture
-	if (file->type_ouverture_file_de_messages == O_RDONLY)
+	if (file->observation) { // m_observation : aucun message n'a pu être retiré
+		errno = EBADF;
 		return -1; // échec
+	}
 
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	// Message hors ligne : zone est la projection de son objet mémoire, défaite ; c'est sa place dans la file qui est rendue
+	PROJECTION_HORS_LIGNE* projection = chercher_projection(zone, 0);
+	if (projection != NULL) {
+		zone = projection->place;
+		oublier_projection(projection);
+	}
+
+	// M_FRAGMENTS : le fragment qui contient le message
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		size_t i = fragment_de_zone(ptr_file_de_messages, zone);
+		if (i == ptr_file_de_messages->nombre_fragments) {
+			errno = EINVAL;
+			return -1; // échec
+		}
 
+		MESSAGE sous_file = message_fragment(file, i);
+		return m_reception_release(&sous_file, zone);
+	}
 
-	// Si la longueur du message est plus grande que la longueur maximale supportée par la file,
-	//la fonction retourne immédiatement −1 et met EMSGSIZE dans errno.
-	if(len > ptr_file_de_messages->longueur_maximale_message) {
-		errno = EMSGSIZE;
-		return -1;  // échec
+	if (ptr_file_de_messages->moteur == M_OCTETS) {
+		verrouiller(ptr_file_de_messages);
+		ENREGISTREMENT* enregistrement = enregistrement_de_zone(ptr_file_de_messages, zone, ENREGISTREMENT_LU);
+		if (enregistrement != NULL)
+			liberer_enregistrement(ptr_file_de_messages, enregistrement);
+		deverrouiller(ptr_file_de_messages);
+
+		if (enregistrement == NULL) {
+			errno = EINVAL;
+			return -1; // échec
+		}
 
+		signaler_places(ptr_file_de_messages, 1);
+		signaler_descripteurs(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+		return 0;
 	}
 
-	int peut_continuer;
-	int index_last;
+	// Moteurs M_DIFFUSION : zone doit être le message à la position du lecteur
+	if (moteur_diffusion(ptr_file_de_messages->moteur)) {
+		LECTEUR_DIFFUSION* lecteur = lecteur_diffusion(file);
+		uint32_t masque = (uint32_t) ptr_file_de_messages->capacite - 1;
 
-	int mutex_lock_result = pthread_mutex_lock( &(ptr_file_de_messages->mutex) );
-	if(mutex_lock_result != 0) {
-		char* error_msg = strerror( mutex_lock_result ); // char * strerror (int errnum)
-		fprintf(stderr, "Function pthread_mutex_lock() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+		if (lecteur == NULL || element_de_zone(ptr_file_de_messages, zone)
+		                       != element_file(ptr_file_de_messages, atomic_load_explicit(&lecteur->position, memory_order_relaxed) & masque)) {
+			errno = EINVAL;
+			return -1; // échec
+		}
+
+		if (liberer_reception_diffusion(ptr_file_de_messages, lecteur) == -1) {
+			raccrocher_lecteur(ptr_file_de_messages, lecteur);
+			return -1; // échec, errno == EOVERFLOW : le message a peut-être été réécrit pendant sa lecture
+		}
+		return 0;
 	}
 
+	FILE_ELEMENT* element = element_de_zone(ptr_file_de_messages, zone);
+	if (element == NULL) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-	/* SECTION CRITIQUE - DEBUT */
+	liberer_reception(ptr_file_de_messages, element);
+	signaler_descripteurs(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
 
-	//  une fonction exit_mutex() qu'on appellera automatiquement à chaque exit effectuée au milieu de la section critique
-	// (à l'aide de la fonction atexit). Objectif de cette fonction : pthread_mutex_unlock( mutex )
-	int atexit_result = atexit(exit_mutex); // int atexit (void (*function) (void))
+	return 0;
+}
 
-	if(atexit_result != 0) {
-		fprintf(stderr,"Fonction atexit() a echoue \n");
+/* Les messages en plusieurs morceaux */
 
-		int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
-		if(mutex_unlock_result != 0) {
-			char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
-		}
+/**
+ * La longueur totale des iovcnt morceaux iov : SSIZE_MAX si elle déborde (aucune file n'a de messages aussi longs),
+ * -1 et errno == EINVAL si iovcnt n'est pas dans [0, IOV_MAX].
+ */
+static ssize_t longueur_morceaux(const struct iovec *iov, int iovcnt) {
+	size_t longueur = 0;
+	int i;
 
-		exit(EXIT_FAILURE);
+	if (iovcnt < 0 || iovcnt > IOV_MAX) {
+		errno = EINVAL;
+		return -1; // échec
 	}
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	flag_processus_dans_section_critique = 1;
+	for (i = 0 ; i < iovcnt ; i++) {
+		if (iov[i].iov_len > SSIZE_MAX - longueur)
+			return SSIZE_MAX;
+		longueur += iov[i].iov_len;
+	}
 
+	return (ssize_t) longueur;
+}
 
-	if(ptr_file_de_messages->capacite == ptr_file_de_messages->nombre_elements_remplis) { // Si pas de place dans la file
+/**
+  * Signature : int m_envoiv(MESSAGE *file, long type, const struct iovec *iov, int iovcnt, int msgflag);
+  * Description : Une fonction qui envoie comme m_envoi() un message de type type fait de plusieurs morceaux (un en-tête
+  *               et un corps, par exemple) : les iovcnt morceaux iov[i] sont mis bout à bout directement dans la place
+  *               du message, sans les rassembler d’abord dans un tampon de l’appelant.
+  *
+  * Parametres :
+  ** MESSAGE *file          : la file de messages.
+  ** long type              : le type du message.
+  ** const struct iovec *iov : les morceaux du message, dans l’ordre (iov_base, iov_len).
+  ** int iovcnt             : le nombre de morceaux, dans [0, IOV_MAX].
+  ** int msgflag            : 0 ou O_NONBLOCK, comme pour m_envoi().
+  *
+  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon.
+  * Si la somme des longueurs des morceaux est plus grande que la longueur maximale supportée par la file, errno prend
+  * la valeur EMSGSIZE ; si iovcnt n’est pas valide, EINVAL.
+  */
+int m_envoiv(MESSAGE *file, long type, const struct iovec *iov, int iovcnt, int msgflag) {
 
-		switch(msgflag) {
-			case O_NONBLOCK : // Si pas de place dans la file, alors lappel retourne tout de suite avec la valeur de retour −1
-				              // et errno prend la valeur EAGAIN.
-				              errno = EAGAIN; // errno prend la valeur EAGAIN
-			                  return -1; // échec
-				              //break; Pas besioin de break car return
-			case 0 : // Le processus appelant est bloqué jusqu’à ce que le message soit envoyé
-				      peut_continuer = 0;
-				      break;
-			default : return -1; // échec
-		}
+	ssize_t len = longueur_morceaux(iov, iovcnt);
+	if (len == -1)
+		return -1; // échec
 
-	} else {
-		peut_continuer = 1;
-	}
+	struct mon_message message = { type, NULL };
 
+	morceaux_envoi = iov;
+	nombre_morceaux_envoi = iovcnt;
+	int resultat = m_envoi(file, &message, (size_t) len, msgflag);
+	morceaux_envoi = NULL;
 
+	return resultat;
+}
 
-	// Attendre la condition
-	while( ! peut_continuer ){
-	   // int pthread_cond_wait(pthread_cond_t *restrict cond, pthread_mutex_t *restrict mutex);
-	  // Valeur de retour : 0 si OK, numero d'erreur sinon
-		int result_value = pthread_cond_wait( &(ptr_file_de_messages->attente_file_pleine), &(ptr_file_de_messages->mutex) );
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_cond_wait() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
-		}
+/**
+  * Signature : ssize_t m_receptionv(MESSAGE *file, const struct iovec *iov, int iovcnt, long type, int flags);
+  * Description : Une fonction qui lit un message comme m_reception() et le répartit directement dans les iovcnt
+  *               morceaux iov[i] : le premier est rempli, puis le suivant ... jusqu’à la fin du message.
+  *
+  * Parametres :
+  ** MESSAGE *file          : la file de messages.
+  ** const struct iovec *iov : les morceaux où copier le message, dans l’ordre.
+  ** int iovcnt             : le nombre de morceaux, dans [0, IOV_MAX].
+  ** long type, int flags   : comme pour m_reception().
+  *
+  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec.
+  * Si la somme des longueurs des morceaux est inférieure à la longueur du message à lire, errno prend la valeur EMSGSIZE
+  * (et le message reste dans la file) ; si iovcnt n’est pas valide, EINVAL.
+  */
+ssize_t m_receptionv(MESSAGE *file, const struct iovec *iov, int iovcnt, long type, int flags) {
+
+	ssize_t len = longueur_morceaux(iov, iovcnt);
+	if (len == -1)
+		return -1; // échec
+
+	morceaux_reception = iov;
+	nombre_morceaux_reception = iovcnt;
+	ssize_t resultat = m_reception(file, NULL, (size_t) len, type, flags);
+	morceaux_reception = NULL;
+
+	return resultat;
+}
 
-		if(ptr_file_de_messages->nombre_elements_remplis < ptr_file_de_messages->capacite)
-			peut_continuer = 1;
+/* Les grands messages hors ligne */
+
+/**
+  * Signature : int m_hors_ligne(MESSAGE *file, size_t longueur_maximale);
+  * Description : Une fonction qui permet à cette connexion d’envoyer des messages plus longs que la longueur maximale de la file,
+  *               jusqu’à longueur_maximale octets. Un tel message est écrit dans son propre objet mémoire (shm_open), avec
+  *               les droits de la file ; sa place ne contient qu’une poignée, et la lecture (ou la péremption) qui le retire
+  *               de la file supprime l’objet. Les places restent à la taille des messages courants, et un grand message
+  *               n’est copié qu’une fois de chaque côté, ou pas du tout avec m_envoi_reserve() et m_reception_peek(), qui
+  *               retournent une projection de l’objet.
+  *               Toute connexion reçoit les messages hors ligne ; seules celles qui ont appelé m_hors_ligne() en envoient,
+  *               et jamais par m_envoi_lot(). Les objets des messages encore dans la file quand elle est détruite (ou refaite
+  *               par O_CREAT) restent dans /dev/shm.
+  *
+  * Parametres :
+  ** MESSAGE *file            : la file de messages.
+  ** size_t longueur_maximale : la longueur maximale d’un message hors ligne ; 0 : aucun message hors ligne (comme à la connexion).
+  *
+  * Valeur de retour : 0 si OK, −1 si échec.
+  * errno prend la valeur EBADF si la connexion est seulement en lecture ; EINVAL si la file est M_OCTETS (ses messages
+  * n’occupent déjà que leur longueur), M_DIFFUSION (un message est lu par chaque lecteur) ou durable (l’objet ne serait pas
+  * dans le fichier), si sa longueur maximale est plus petite qu’une poignée, ou si longueur_maximale dépasse INT_MAX.
+  */
+int m_hors_ligne(MESSAGE *file, size_t longueur_maximale) {
+
+	if (file->type_ouverture_file_de_messages == O_RDONLY) {
+		errno = EBADF;
+		return -1; // échec
 	}
 
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	index_last = ptr_file_de_messages->last;
-	ptr_file_de_messages->last++;
+	if ( longueur_maximale != 0
+	     && ( ptr_file_de_messages->moteur == M_OCTETS || moteur_diffusion(ptr_file_de_messages->moteur) || ptr_file_de_messages->durable
+	          || ptr_file_de_messages->longueur_maximale_message < sizeof(POIGNEE_HORS_LIGNE) || longueur_maximale > INT_MAX ) ) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-	if(ptr_file_de_messages->last == ptr_file_de_messages->capacite)
-		ptr_file_de_messages->last = 0;
+	// Les objets mémoire ont les droits de celui de la file ; 0600 pour une file anonyme ou locale
+	struct stat etat;
+	file->mode_hors_ligne = ( file->descripteur != -1 && fstat(file->descripteur, &etat) == 0 ) ? etat.st_mode & 0777 : 0600;
+	file->longueur_hors_ligne = longueur_maximale;
 
-	ptr_file_de_messages->nombre_elements_remplis++;
+	return 0;
+}
+
+/* Les lots */
+
+/**
+  * Signature : ssize_t m_envoi_lot(MESSAGE *file, const struct mon_message *msgs, const size_t *lens, size_t nb, int msgflag);
+  * Description : Une fonction qui envoie les nb messages msgs[0], ..., msgs[nb-1] dans la file, dans cet ordre,
+  *               avec une seule section critique et un seul réveil des lectures pour tout le lot.
+  *
+  * Parametres :
+  ** MESSAGE *file                  : la file de messages.
+  ** const struct mon_message *msgs : les messages à envoyer.
+  ** const size_t *lens             : lens[i] est la longueur du message msgs[i] en octets.
+  ** size_t nb                      : le nombre de messages du lot.
+  ** int msgflag                    : le paramètre msgflag peut prendre deux valeurs,
+  **                                  -- 0 : le processus appelant est bloqué jusqu’à ce que tous les messages soient envoyés ;
+  **                                  -- O_NONBLOCK : seuls les messages qui trouvent une place sont envoyés ;
+  **                                                  s’il n’y a aucune place, l’appel retourne −1 et errno prend la valeur EAGAIN.
+  *
+  * Valeur de retour : le nombre de messages envoyés (les premiers du lot), ou −1 si aucun message n’a été envoyé.
+  * Si un des messages est plus long que la longueur maximale supportée par la file,
+  * la fonction n’envoie rien, retourne immédiatement −1 et met EMSGSIZE dans errno.
+  */
+ssize_t m_envoi_lot(MESSAGE *file, const struct mon_message *msgs, const size_t *lens, size_t nb, int msgflag) {
 
+	if (file->type_ouverture_file_de_messages == O_RDONLY)
+		return -1; // échec
 
-	/* SECTION CRITIQUE - FIN */
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
-	if(mutex_unlock_result != 0) {
-		char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
-		fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+	size_t i;
+	for (i = 0 ; i < nb ; i++) {
+		if (lens[i] > ptr_file_de_messages->longueur_maximale_message) {
+			errno = EMSGSIZE;
+			return -1;  // échec
+		}
 	}
 
+	if (nb == 0)
+		return 0;
 
+	// M_FRAGMENTS : chaque suite de messages consécutifs du même fragment est un lot de ce fragment
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		size_t debut = 0;
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	flag_processus_dans_section_critique = 0;
-
-	struct mon_message* ptr_message = (struct mon_message *) msg;
-	ptr_file_de_messages->tableau_circulaire[index_last + (index_last * ptr_file_de_messages->longueur_maximale_message)].longueur_message = len;
-	ptr_file_de_messages->tableau_circulaire[index_last + (index_last * ptr_file_de_messages->longueur_maximale_message)].type = ptr_message->type;
-	ptr_file_de_messages->tableau_circulaire[index_last + (index_last * ptr_file_de_messages->longueur_maximale_message)].message = &(ptr_file_de_messages->tableau_circulaire[index_last + (index_last * ptr_file_de_messages->longueur_maximale_message)]) + 1;
+		while (debut < nb) {
+			size_t fin = debut + 1, f = fragment_du_type(ptr_file_de_messages, msgs[debut].type);
+			while (fin < nb && fragment_du_type(ptr_file_de_messages, msgs[fin].type) == f)
+				fin++;
 
-	//void * memmove (void *to, const void *from, size_t size)
-	memmove(ptr_file_de_messages->tableau_circulaire[index_last + (index_last * ptr_file_de_messages->longueur_maximale_message)].message, ptr_message->mtext, len);
+			MESSAGE sous_file = message_fragment(file, f);
+			ssize_t resultat = m_envoi_lot(&sous_file, msgs + debut, lens + debut, fin - debut, msgflag);
+			if (resultat == -1)
+				break;
 
+			signaler_fragments(ptr_file_de_messages);
+			debut += (size_t) resultat;
+			if (debut < fin) // le fragment est plein : les messages suivants attendent, pour garder l'ordre de l'appel
+				break;
+		}
 
-	// Signaler le nouveau message à tous les processus suspendu sur la condition
+		return debut > 0 ? (ssize_t) debut : -1;
+	}
 
-	// int pthread_cond_signal(pthread_cond_t *cond);
-	// Valeur de retour : 0 si OK, numero d'erreur sinon
-	int result_value =  pthread_cond_signal( &(ptr_file_de_messages->attente_file_vide) );
-	if(result_value != 0) {
-		char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-		fprintf(stderr, "Fonction pthread_cond_signal() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+	size_t envoyes;
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC : envoyes = envoi_lot_spsc(ptr_file_de_messages, msgs, lens, nb, msgflag);
+		              break;
+		case M_MPMC : envoyes = envoi_lot_mpmc(ptr_file_de_messages, msgs, lens, nb, msgflag);
+		              break;
+		case M_DIFFUSION :
+		case M_DIFFUSION_ABANDON : envoyes = envoi_lot_diffusion(ptr_file_de_messages, msgs, lens, nb, msgflag);
+		              break;
+		case M_OCTETS : envoyes = envoi_lot_octets(ptr_file_de_messages, msgs, lens, nb, msgflag);
+		              break;
+		default :     envoyes = envoi_lot_verrou(ptr_file_de_messages, msgs, lens, nb, msgflag);
 	}
 
-	int i;
-	for(i = 0 ; i < NB_PROCESSUS ; i++) {
-		if (ptr_file_de_messages->notifications[i].type == ptr_message->type ) {
-			// int kill (pid_t pid, int signum)
-			int kill_result = kill(ptr_file_de_messages->notifications[i].pid, ptr_file_de_messages->notifications[i].signum);
-			if (kill_result == -1){
-				perror("kill()");
-				exit(EXIT_FAILURE);
-			}
+	size_t octets = 0;
+	for (i = 0 ; i < envoyes ; i++) {
+		envoyer_notifications(ptr_file_de_messages, msgs[i].type);
+		octets += lens[i];
+	}
 
-			// Quand le signal de notification est envoyé, le processus enregistré doit être automatiquement désenregistré.
-			memset(&ptr_file_de_messages->notifications[i], 0, sizeof(ENREGISTREMENT_NOTIFICATIONS));
-		}
+	if (envoyes == 0) {
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
+		return -1; // échec
 	}
 
-	return 0 ; // La fonction retourne 0 quand l’envoi réussit
+	terminer_envois(ptr_file_de_messages, envoyes, octets);
+	return (ssize_t) envoyes;
 }
 
 /**
-  * Signature : ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags);
-  * Description : Une fonction qui lit le premier message convenable sur la file, le copie à l’adresse msg et le
-  *               supprime de la file. Une file de messages est une file FIFO : si on écrit les messages a, b, c dans cet ordre,
-  *               et si on lit avec type==0, alors les lectures successives retournent a, b, c dans le même ordre.
+  * Signature : ssize_t m_reception_lot(MESSAGE *file, void **msgs, size_t *lens, size_t nb, long type, int flags);
+  * Description : Une fonction qui lit jusqu’à nb messages convenables sur la file, avec une seule section critique
+  *               et un seul réveil des envois pour tout le lot : le i-ème message lu est copié à l’adresse msgs[i].
   *
   * Parametres :
   ** MESSAGE *file : la file de messages.
-  ** void *msg     : l’adresse à laquelle la fonction doit copier le message lu ; ce message sera supprimé de la file.
-  ** size_t len    : la longueur (en octets) de mémoire à l’adresse msg.
-  ** long type     : Le paramètre type précise la demande,
-  **                 -- type == 0 : lire le premier message dans la file
-  **                 -- type > 0 : lire le premier message dont le type est type ;
-  **                    grâce au type, plusieurs processus peuvent utiliser la même file de messages,
-  **                    par exemple chaque processus peut utiliser son pid comme valeur de type ;
-  **                 -- type < 0 : traiter la file comme une file de priorité ; en l’occurrence, cela signifie :
-  **                               lire le premier message dont le type est inférieur ou égal à la valeur absolue de type.
+  ** void **msgs   : les adresses auxquelles la fonction copie les messages lus.
+  ** size_t *lens  : en entrée, lens[i] est la longueur (en octets) de mémoire à l’adresse msgs[i] ;
+  **                 en sortie, la longueur du i-ème message lu.
+  ** size_t nb     : le nombre maximal de messages à lire.
+  ** long type     : la demande, comme pour m_reception().
   ** int flags     : Le paramètre flags peut prendre soit la valeur 0, soit O_NONBLOCK
-  **                 -- flags == 0 : l’appel est bloquant jusqu’à ce que la lecture réussisse.
+  **                 -- flags == 0 : l’appel est bloquant jusqu’à ce qu’au moins un message soit lu ;
   **                 -- si flags == O_NONBLOCK, et s’il n’y a pas de message du type demandé dans la file,
   **                                l’appel retourne tout de suite avec la valeur −1 et errno == EAGAIN.
+  ** L’appel n’attend jamais après le premier message : il retourne les messages déjà présents dans la file.
   *
-  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec.
-  * si len est inférieur à la longueur du message à lire, m_reception() échoue et retourne −1 et errno prend la valeur EMSGSIZE.
+  * Valeur de retour : le nombre de messages lus, ou −1 en cas d’échec.
+  * La lecture s’arrête au premier message plus long que la mémoire qui lui est destinée : ce message reste dans la file ;
+  * si c’est le premier, m_reception_lot() retourne −1 et errno prend la valeur EMSGSIZE.
+  * Un message hors ligne dont l’objet mémoire ne peut pas être lu arrête aussi le lot : lui et les messages suivants du lot
+  * sont perdus (errno de shm_open() ou de mmap() s’il était le premier).
   */
-ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags){
+ssize_t m_reception_lot(MESSAGE *file, void **msgs, size_t *lens, size_t nb, long type, int flags) {
 
-	// Vérifier que l’opération est autorisée, par exemple m_reception() échoue si la file a été ouverte seulement en ecriture
-	if (file->type_ouverture_file_de_messages == O_WRONLY)
+	if (file->type_ouverture_file_de_messages == O_WRONLY || file->observation) {
+		errno = EBADF;
 		return -1; // échec
+	}
 
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	if (lecture_fifo_seulement(ptr_file_de_messages) && type != 0) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-	int peut_continuer;
-	int index_first;
+	if (nb == 0)
+		return 0;
 
-	int mutex_lock_result = pthread_mutex_lock( &(ptr_file_de_messages->mutex) );
-	if(mutex_lock_result != 0) {
-		char* error_msg = strerror( mutex_lock_result ); // char * strerror (int errnum)
-		fprintf(stderr, "Function pthread_mutex_lock() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+	LECTEUR_DIFFUSION* lecteur = NULL;
+	if (moteur_diffusion(ptr_file_de_messages->moteur)) {
+		if (file->lecteur == -1) {
+			errno = EBADF;
+			return -1; // échec : cette connexion n'est pas un lecteur
+		}
+		lecteur = lecteur_diffusion(file);
+		if (lecteur == NULL)
+			return -1; // échec, errno == ENOSPC
 	}
 
-	/* SECTION CRITIQUE - DEBUT */
+	// M_FRAGMENTS : le lot est lu dans un seul fragment
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		if (type > 0) {
+			MESSAGE sous_file = message_fragment(file, fragment_du_type(ptr_file_de_messages, type));
+			return m_reception_lot(&sous_file, msgs, lens, nb, type, flags);
+		}
+
+		ARGUMENTS_LECTURE arguments = { .sorte = LECTURE_LOT, .msgs = msgs, .lens = lens, .nb = nb, .type = type };
+		return lire_fragments(file, &arguments, flags);
+	}
 
-	//  une fonction exit_mutex() qu'on appellera automatiquement à chaque exit effectuée au milieu de la section critique
-	// (à l'aide de la fonction atexit). Objectif de cette fonction : pthread_mutex_unlock( mutex )
-	int atexit_result = atexit(exit_mutex); // int atexit (void (*function) (void))
+	size_t recus;
+	switch (ptr_file_de_messages->moteur) {
+		case M_SPSC : recus = reception_lot_spsc(ptr_file_de_messages, msgs, lens, nb, flags);
+		              break;
+		case M_MPMC : recus = reception_lot_mpmc(ptr_file_de_messages, msgs, lens, nb, flags);
+		              break;
+		case M_DIFFUSION :
+		case M_DIFFUSION_ABANDON : recus = reception_lot_diffusion(ptr_file_de_messages, lecteur, msgs, lens, nb, flags);
+		              break;
+		case M_OCTETS : recus = reception_lot_octets(ptr_file_de_messages, msgs, lens, nb, flags);
+		              break;
+		default :     recus = reception_lot_verrou(ptr_file_de_messages, msgs, lens, nb, type, flags);
+	}
 
-	if(atexit_result != 0) {
-		fprintf(stderr,"Fonction atexit() a echoue \n");
+	if (recus == 0) {
+		terminer_echec(ptr_file_de_messages, ATTENTE_FILE_VIDE);
+		return -1; // échec
+	}
 
-		int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
-		if(mutex_unlock_result != 0) {
-			char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
+	// Les messages hors ligne : le lot n'a copié que leurs poignées, leurs objets mémoire sont lus maintenant, hors du mutex.
+	// Un objet illisible arrête le lot : ce message et les suivants sont perdus
+	size_t i, octets = 0, lisibles = recus;
+	int erreur = 0;
+	for (i = 0 ; i < recus ; i++) {
+		if (lens[i] > ptr_file_de_messages->longueur_maximale_message) {
+			POIGNEE_HORS_LIGNE poignee;
+			memcpy(&poignee, msgs[i], sizeof(poignee));
+			if (erreur != 0)
+				supprimer_hors_ligne(&poignee);
+			else if (recevoir_hors_ligne(&poignee, msgs[i], lens[i]) == -1) {
+				erreur = errno;
+				lisibles = i;
+			}
 		}
+		octets += lens[i];
+	}
 
-		exit(EXIT_FAILURE);
+	terminer_receptions(ptr_file_de_messages, recus, octets);
+
+	if (lisibles == 0) {
+		errno = erreur;
+		return -1; // échec
 	}
+	return (ssize_t) lisibles;
+}
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	flag_processus_dans_section_critique = 1;
+/* Les files durables */
 
-	if(ptr_file_de_messages->nombre_elements_remplis == 0) { // Si la file est vide
+/**
+  * Signature   : int m_validation_groupee(MESSAGE *file, size_t nb_operations, unsigned long delai_us);
+  * Description : Une fonction qui règle, pour tous les processus connectés, quand une file durable est écrite sur le disque :
+  *               msync() dès que nb_operations envois et lectures attendent, ou dès qu’une opération arrive plus de delai_us
+  *               microsecondes après la validation précédente (0 : pas de seuil). Avec nb_operations == 1, chaque
+  *               opération est sur le disque quand elle se termine.
+  *
+  * Parametres :
+  ** MESSAGE* file            : la file de messages.
+  ** size_t nb_operations     : le seuil en nombre d'opérations.
+  ** unsigned long delai_us   : le seuil en microsecondes.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec (EINVAL si la file n’est pas durable, EBADF si elle est ouverte seulement en lecture).
+  */
+int m_validation_groupee(MESSAGE *file, size_t nb_operations, unsigned long delai_us) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-		switch(flags) {
-			case O_NONBLOCK : // Si il ny a pas de message du type demandé dans la file,
-				             // l’appel retourne tout de suite avec la valeur −1 et errno == EAGAIN.
-				              errno = EAGAIN; // errno prend la valeur EAGAIN
-			                  return -1; // échec
-				              //break; Pas besioin de break car return
-			case 0 : // L’appel est bloquant jusqu’à ce que la lecture réussisse.
-				      peut_continuer = 0;
-				      break;
-			default : return -1; // échec
-		}
+	if (! ptr_file_de_messages->durable) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
-	} else {
-		peut_continuer = 1;
+	if (file->type_ouverture_file_de_messages == O_RDONLY) {
+		errno = EBADF;
+		return -1; // échec
 	}
 
-	// Attendre la condition
-	while( ! peut_continuer ){
+	ptr_file_de_messages->durabilite.operations_par_validation = nb_operations;
+	ptr_file_de_messages->durabilite.delai_validation = (uint64_t) delai_us * 1000;
 
-	   // int pthread_cond_wait(pthread_cond_t *restrict cond, pthread_mutex_t *restrict mutex);
-	  // Valeur de retour : 0 si OK, numero d'erreur sinon
-		int result_value = pthread_cond_wait( &(ptr_file_de_messages->attente_file_vide), &(ptr_file_de_messages->mutex) );
-		if(result_value != 0) {
-			char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-			fprintf(stderr, "Fonction pthread_cond_wait() : %s \n", error_msg);
-			exit (EXIT_FAILURE);
-		}
+	return 0;
+}
 
-		if(ptr_file_de_messages->nombre_elements_remplis > 0)
-			peut_continuer = 1;
+/**
+  * Signature   : int m_synchroniser(MESSAGE *file);
+  * Description : Une fonction qui écrit tout de suite sur le disque les opérations faites sur une file durable,
+  *               par exemple quand la file reste inactive après la dernière opération (les seuils de m_validation_groupee
+  *               ne sont vérifiés qu’après chaque opération).
+  *
+  * Parametres :
+  ** MESSAGE* file : la file de messages.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec (EINVAL si la file n’est pas durable, EBADF si elle est ouverte seulement en lecture,
+  *                    ou l’erreur de msync()).
+  */
+int m_synchroniser(MESSAGE *file) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
+	if (! ptr_file_de_messages->durable) {
+		errno = EINVAL;
+		return -1; // échec
+	}
 
+	if (file->type_ouverture_file_de_messages == O_RDONLY) {
+		errno = EBADF;
+		return -1; // échec
 	}
 
-	index_first = ptr_file_de_messages->first;
-	ptr_file_de_messages->first++;
-	if(ptr_file_de_messages->first == ptr_file_de_messages->capacite)
-		ptr_file_de_messages->first = 0;
+	return valider_file(ptr_file_de_messages);
+}
 
-	ptr_file_de_messages->nombre_elements_remplis--;
+/* L’état de la file */
 
-	/* SECTION CRITIQUE - FIN */
+/**
+  * Signature   : int m_redimensionner(MESSAGE *file, size_t nb_msg);
+  * Description : Une fonction qui change la capacité d’une file M_MUTEX ou M_PRIORITE (sans M_FRAGMENTS) pendant qu’elle sert,
+  *               jusqu’à capacite_maximale (celle de M_EXTENSIBLE à la création, sinon la capacité à la création) :
+  *               l’objet mémoire grandit ou rétrécit avec ftruncate(), dans la place que chaque processus a réservée en se connectant.
+  *               Les messages de la file restent, dans le même ordre ; en rétrécissant, ceux des places retirées sont déplacés.
+  *
+  * Parametres :
+  ** MESSAGE* file : la file de messages.
+  ** size_t nb_msg : la nouvelle capacité.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec (EBADF : file ouverte seulement en lecture ; EINVAL : moteur ou capacité impossible ;
+  *                    EBUSY : des places à retirer sont réservées ou en cours de lecture, ou les messages ne tiennent pas).
+  */
+int m_redimensionner(MESSAGE *file, size_t nb_msg) {
 
-	int mutex_unlock_result = pthread_mutex_unlock( &(ptr_file_de_messages->mutex) );
-	if(mutex_unlock_result != 0) {
-		char* error_msg = strerror( mutex_unlock_result ); // char * strerror (int errnum)
-		fprintf(stderr, "Fonction pthread_mutex_unlock() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+	if (file->type_ouverture_file_de_messages == O_RDONLY) {
+		errno = EBADF;
+		return -1; // échec
 	}
 
-	// Afin de savoir si au moment du exit le processus était dans la section critique
-	flag_processus_dans_section_critique = 0;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	ssize_t nombre_octets_message_lu = ptr_file_de_messages->tableau_circulaire[index_first + (index_first * ptr_file_de_messages->longueur_maximale_message)].longueur_message;
-	if (len < nombre_octets_message_lu) {
-		errno = EMSGSIZE;
+	if ( (ptr_file_de_messages->moteur != M_MUTEX && ptr_file_de_messages->moteur != M_PRIORITE)
+	     || ptr_file_de_messages->nombre_fragments > 0 || nb_msg == 0 || nb_msg > ptr_file_de_messages->capacite_maximale ) {
+		errno = EINVAL;
 		return -1; // échec
 	}
 
-	// void * memmove (void *to, const void *from, size_t size)
-	memmove(msg, ptr_file_de_messages->tableau_circulaire[index_first + (index_first * ptr_file_de_messages->longueur_maximale_message)].message, nombre_octets_message_lu);
+	verrouiller(ptr_file_de_messages);
 
-	// void * memset (void *block, int c, size_t size)
-	memset(&ptr_file_de_messages->tableau_circulaire[index_first + (index_first * ptr_file_de_messages->longueur_maximale_message)], 0,  sizeof(FILE_ELEMENT) + ptr_file_de_messages->longueur_maximale_message);
+	size_t ancienne_capacite = ptr_file_de_messages->capacite;
+	int resultat = 0;
+	if (nb_msg > ancienne_capacite)
+		resultat = agrandir_tableau(file, nb_msg);
+	else if (nb_msg < ancienne_capacite)
+		resultat = retrecir_tableau(file, nb_msg);
 
-	// Signaler la nouvelle place libre à tous les processus suspendu sur la condition
+	// Les autres processus verront le changement à leur prochaine opération
+	if (resultat == 0 && nb_msg != ancienne_capacite)
+		atomic_fetch_add_explicit(&ptr_file_de_messages->generation, 1, memory_order_release);
 
-	// int pthread_cond_signal(pthread_cond_t *cond);
-	// Valeur de retour : 0 si OK, numero d'erreur sinon
-	int result_value =  pthread_cond_signal( &(ptr_file_de_messages->attente_file_pleine) );
-	if(result_value != 0) {
-		char* error_msg = strerror( result_value ); // char * strerror (int errnum)
-		fprintf(stderr, "Fonction pthread_cond_signal() : %s \n", error_msg);
-		exit (EXIT_FAILURE);
+	deverrouiller(ptr_file_de_messages);
+
+	if (resultat == 0 && nb_msg > ancienne_capacite) {
+		// Les envois qui attendent une place, et les descripteurs m_fd() POLLOUT
+		signaler_places(ptr_file_de_messages, nb_msg - ancienne_capacite);
+		signaler_descripteurs(ptr_file_de_messages, ATTENTE_FILE_PLEINE);
 	}
 
-	return nombre_octets_message_lu;
-}
+	// Ce processus suit tout de suite le changement (M_PRECHARGE, M_MLOCK)
+	file_de_messages(file);
 
-/* L’état de la file */
+	return resultat;
+}
 
 /**
   * Signature   : size_t m_message_len(MESSAGE* message);
@@ -662,7 +5821,7 @@ ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags){
   ** MESSAGE* file : la file de messages.
   */
 size_t m_message_len(MESSAGE* file){
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
 	return ptr_file_de_messages->longueur_maximale_message;
 }
@@ -675,11 +5834,32 @@ size_t m_message_len(MESSAGE* file){
   ** MESSAGE* file : la file de messages.
   */
 size_t m_capacite(MESSAGE* file){
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
 	return ptr_file_de_messages->capacite;
 }
 
+/**
+  * Signature   : size_t m_capacite_octets(MESSAGE* file);
+  * Description : Une fonction qui retourne le nombre d'octets que la file réserve aux messages :
+  *               la taille de l'anneau avec le moteur M_OCTETS, capacite × longueur_maximale_message sinon.
+  *
+  * Parametres :
+  ** MESSAGE* file : la file de messages.
+  */
+size_t m_capacite_octets(MESSAGE* file){
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	// M_FRAGMENTS : tous les fragments ont la même taille
+	if (ptr_file_de_messages->nombre_fragments > 0 && ptr_file_de_messages->moteur == M_OCTETS)
+		return ptr_file_de_messages->nombre_fragments * fragment(ptr_file_de_messages, 0)->octets.taille_anneau;
+
+	if (ptr_file_de_messages->moteur == M_OCTETS)
+		return ptr_file_de_messages->octets.taille_anneau;
+
+	return ptr_file_de_messages->capacite * ptr_file_de_messages->longueur_maximale_message;
+}
+
 /**
   * Signature   : size_t m_nb(MESSAGE* file);
   * Description : Une fonction qui retourne le nombre de messages actuellement dans la file.
@@ -688,77 +5868,334 @@ size_t m_capacite(MESSAGE* file){
   ** MESSAGE* file : la file de messages.
   */
 size_t m_nb(MESSAGE* file){
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
 
-	return ptr_file_de_messages->nombre_elements_remplis;
+	return nombre_messages(ptr_file_de_messages);
+}
+
+/**
+  * Signature   : int m_fd(MESSAGE *file, int evenements);
+  * Description : Une fonction qui retourne un descripteur de fichier à surveiller avec poll(), select() ou epoll,
+  *               pour multiplexer de nombreuses files dans une boucle d’événements au lieu d’un processus bloqué par file.
+  *
+  * Parametres :
+  ** MESSAGE *file  : la file de messages.
+  ** int evenements : -- POLLIN : le descripteur devient lisible quand la file n’est pas vide ;
+  **                  -- POLLOUT : le descripteur devient lisible quand la file a une place libre
+  **                               (avec le moteur M_OCTETS, une place pour un message de longueur maximale).
+  *
+  * Dans les deux cas, c’est en lecture (POLLIN, EPOLLIN) qu’il faut surveiller le descripteur ; il ne faut ni le lire ni y écrire.
+  * Il reste lisible jusqu’à ce qu’un appel O_NONBLOCK de ce processus (m_reception pour POLLIN, m_envoi pour POLLOUT)
+  * échoue avec EAGAIN : la boucle d’événements lit (ou envoie) donc jusqu’à EAGAIN, comme avec epoll en mode EPOLLET.
+  * Un descripteur peut être lisible sans que la condition soit encore vraie (un autre processus a été plus rapide).
+  *
+  * Le descripteur est l’extrémité lecture d’une FIFO nommée /tmp/m_file.<uid>/<pid>.<numero>, dans un répertoire
+  * fermé aux autres utilisateurs (0700), créé au besoin : les processus qui envoient
+  * n’y écrivent un octet que lorsque le descripteur est armé, sans aucun appel système tant qu’aucun descripteur ne l’est.
+  * Il est fermé par m_fermeture_fd() ou m_deconnexion().
+  *
+  * Valeur de retour : le descripteur, ou −1 en cas d’échec.
+  * errno prend la valeur EINVAL si evenements n’est ni POLLIN ni POLLOUT (ou si la file a des fragments, ou un moteur M_DIFFUSION), ENOSPC si NB_DESCRIPTEURS descripteurs sont déjà ouverts,
+  * EBADF pour une connexion de m_observation(), EACCES si /tmp/m_file.<uid> existe sans être un répertoire de cet utilisateur fermé aux autres.
+  */
+int m_fd(MESSAGE *file, int evenements) {
+
+	if (file->observation) { // m_observation : l'abonnement s'écrit dans la file
+		errno = EBADF;
+		return -1; // échec
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	if ( (evenements != POLLIN && evenements != POLLOUT) || ptr_file_de_messages->nombre_fragments > 0 || moteur_diffusion(ptr_file_de_messages->moteur) ) {
+		errno = EINVAL;
+		return -1; // échec
+	}
+	static _Atomic unsigned numero = 0; // avec le pid, un nom de FIFO différent pour chaque descripteur de ce processus
+
+	DESCRIPTEUR_LOCAL* local = (DESCRIPTEUR_LOCAL *) malloc(sizeof(DESCRIPTEUR_LOCAL));
+	if (local == NULL)
+		return -1; // échec
+
+	local->file = ptr_file_de_messages;
+	local->pid = getpid();
+	uid_t uid = geteuid(); // uid_t geteuid (void)
+	if (preparer_repertoire_fifo(uid) == -1) {
+		free(local);
+		return -1; // échec
+	}
+	unsigned numero_fifo = atomic_fetch_add_explicit(&numero, 1, memory_order_relaxed) + 1;
+	snprintf(local->chemin, sizeof(local->chemin), CHEMIN_FIFO, (unsigned long) uid, (long) local->pid, numero_fifo);
+
+	// int mkfifo (const char *filename, mode_t mode) ; une FIFO laissée par un processus disparu qui avait le même pid est remplacée
+	if (mkfifo(local->chemin, 0600) == -1 && (errno != EEXIST || unlink(local->chemin) == -1 || mkfifo(local->chemin, 0600) == -1)) {
+		perror("Fonction mkfifo()");
+		free(local);
+		return -1; // échec
+	}
+
+	// L'extrémité lecture d'abord : avec O_NONBLOCK, l'ouverture en écriture échoue tant qu'il n'y a pas de lecteur
+	local->fd = open(local->chemin, O_RDONLY | O_NONBLOCK | O_NOFOLLOW);
+	local->fd_ecriture = local->fd == -1 ? -1 : open(local->chemin, O_WRONLY | O_NONBLOCK);
+	if (local->fd_ecriture == -1) {
+		perror("Fonction open()");
+		if (local->fd != -1)
+			close(local->fd);
+		unlink(local->chemin);
+		free(local);
+		return -1; // échec
+	}
+
+	// Prendre un abonnement libre
+	int i;
+	for (i = 0 ; i < NB_DESCRIPTEURS ; i++) {
+		uint32_t libre = DESCRIPTEUR_LIBRE;
+		if (atomic_compare_exchange_strong(&ptr_file_de_messages->descripteurs[i].etat, &libre, DESCRIPTEUR_INSCRIT))
+			break;
+	}
+
+	if (i == NB_DESCRIPTEURS) {
+		close(local->fd);
+		close(local->fd_ecriture);
+		unlink(local->chemin);
+		free(local);
+		errno = ENOSPC;
+		return -1; // échec
+	}
+
+	ABONNEMENT_DESCRIPTEUR* abonnement = &ptr_file_de_messages->descripteurs[i];
+	abonnement->generation++;
+	abonnement->sorte = evenements == POLLIN ? ATTENTE_FILE_VIDE : ATTENTE_FILE_PLEINE;
+	abonnement->pid = local->pid;
+	abonnement->uid = uid;
+	abonnement->numero = numero_fifo;
+
+	local->index = i;
+
+	// Armer le descripteur ; il est lisible tout de suite si la condition est déjà vraie
+	pthread_mutex_lock(&mutex_descripteurs);
+	local->suivant = descripteurs_locaux;
+	descripteurs_locaux = local;
+	atomic_fetch_add_explicit(&nombre_descripteurs_locaux, 1, memory_order_relaxed);
+	armer_descripteur(local);
+	pthread_mutex_unlock(&mutex_descripteurs);
+
+	return local->fd;
+}
+
+/**
+  * Signature   : int m_fermeture_fd(MESSAGE *file, int fd);
+  * Description : Une fonction qui ferme un descripteur retourné par m_fd() et supprime sa FIFO.
+  *
+  * Parametres :
+  ** MESSAGE *file : la file de messages.
+  ** int fd        : le descripteur retourné par m_fd().
+  *
+  * Valeur de retour : 0 si OK, −1 si échec (errno prend la valeur EBADF si fd n’est pas un descripteur de m_fd() sur cette file).
+  */
+int m_fermeture_fd(MESSAGE *file, int fd) {
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+	DESCRIPTEUR_LOCAL** local;
+
+	pthread_mutex_lock(&mutex_descripteurs);
+	for (local = &descripteurs_locaux ; *local != NULL ; local = &(*local)->suivant) {
+		DESCRIPTEUR_LOCAL* courant = *local;
+
+		if (courant->file == ptr_file_de_messages && courant->fd == fd) {
+			*local = courant->suivant;
+			atomic_fetch_sub_explicit(&nombre_descripteurs_locaux, 1, memory_order_relaxed);
+			pthread_mutex_unlock(&mutex_descripteurs);
+
+			fermer_descripteur(courant);
+			free(courant);
+			return 0;
+		}
+	}
+	pthread_mutex_unlock(&mutex_descripteurs);
+
+	errno = EBADF;
+	return -1; // échec
+}
+
+// Ajoute aux champs de stats les compteurs de la file (ou d'un fragment), lus sans prendre le mutex
+static void ajouter_statistiques(FILE_DE_MESSAGES* ptr_file_de_messages, struct m_statistiques *stats) {
+	int i;
+	for (i = 0 ; i < NB_LIGNES_STATISTIQUES ; i++) {
+		STATISTIQUES_LIGNE* ligne = &ptr_file_de_messages->statistiques.lignes[i];
+
+		stats->envois += atomic_load_explicit(&ligne->envois, memory_order_relaxed);
+		stats->receptions += atomic_load_explicit(&ligne->receptions, memory_order_relaxed);
+		stats->octets_envoyes += atomic_load_explicit(&ligne->octets_envoyes, memory_order_relaxed);
+		stats->octets_recus += atomic_load_explicit(&ligne->octets_recus, memory_order_relaxed);
+		stats->envois_refuses += atomic_load_explicit(&ligne->refus[ATTENTE_FILE_PLEINE], memory_order_relaxed);
+		stats->receptions_refusees += atomic_load_explicit(&ligne->refus[ATTENTE_FILE_VIDE], memory_order_relaxed);
+		stats->messages_perimes += atomic_load_explicit(&ligne->perimes, memory_order_relaxed);
+		stats->attentes_file_pleine += atomic_load_explicit(&ligne->attentes[ATTENTE_FILE_PLEINE], memory_order_relaxed);
+		stats->attentes_file_vide += atomic_load_explicit(&ligne->attentes[ATTENTE_FILE_VIDE], memory_order_relaxed);
+		stats->attentes_verrou += atomic_load_explicit(&ligne->attentes[ATTENTE_VERROU], memory_order_relaxed);
+		stats->duree_attente_file_pleine += atomic_load_explicit(&ligne->duree_attentes[ATTENTE_FILE_PLEINE], memory_order_relaxed);
+		stats->duree_attente_file_vide += atomic_load_explicit(&ligne->duree_attentes[ATTENTE_FILE_VIDE], memory_order_relaxed);
+		stats->duree_attente_verrou += atomic_load_explicit(&ligne->duree_attentes[ATTENTE_VERROU], memory_order_relaxed);
+	}
+
+	stats->occupation_maximale += atomic_load_explicit(&ptr_file_de_messages->statistiques.occupation_maximale, memory_order_relaxed);
+}
+
+/**
+  * Signature   : int m_stats(MESSAGE *file, struct m_statistiques *stats);
+  * Description : Une fonction qui remplit stats avec les compteurs de la file : messages et octets envoyés et lus,
+  *               appels O_NONBLOCK refusés (EAGAIN), messages périmés, nombre et durée des attentes d’une place, d’un message et du mutex,
+  *               occupation actuelle et maximale. Elle ne prend pas le mutex de la file : un outil de surveillance
+  *               peut l’appeler à tout moment, les compteurs étant lus pendant que les autres processus les incrémentent.
+  *
+  * Parametres :
+  ** MESSAGE *file                : la file de messages.
+  ** struct m_statistiques *stats : la structure à remplir.
+  *
+  * Un processus compte ses opérations dans la ligne de compteurs de son processeur (cf. STATISTIQUES_LIGNE) :
+  * les processus qui envoient et ceux qui lisent n'écrivent pas la même ligne de cache.
+  *
+  * Valeur de retour : 0 si OK, −1 si échec (errno prend la valeur EINVAL si stats est NULL).
+  */
+int m_stats(MESSAGE *file, struct m_statistiques *stats) {
+
+	if (stats == NULL) {
+		errno = EINVAL;
+		return -1; // échec
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	// void * memset (void *block, int c, size_t size)
+	memset(stats, 0, sizeof(struct m_statistiques));
+
+	// M_FRAGMENTS : la somme des fragments ; l'occupation maximale est alors la somme de leurs maxima, une borne supérieure
+	size_t i;
+	for (i = 0 ; i < ptr_file_de_messages->nombre_fragments ; i++)
+		ajouter_statistiques(fragment(ptr_file_de_messages, i), stats);
+	if (ptr_file_de_messages->nombre_fragments == 0)
+		ajouter_statistiques(ptr_file_de_messages, stats);
+
+	stats->occupation = nombre_messages(ptr_file_de_messages);
+
+	return 0;
 }
 
 /**
-  * Signature   : int enregistrement_notifications(MESSAGE* file, long type, int signal, pid_t pid);
+  * Signature   : int enregistrement_notifications(MESSAGE* file, long type, int signum);
   * Description : Un processus peut s’enregistrer sur la file de messages pour recevoir un signal quand
-  *               un message arrive dans la file.
+  *               un message de ce type arrive dans la file. Quand le signal de notification est envoyé,
+  *               le processus enregistré est automatiquement désenregistré.
   *
   * Parametres :
   ** MESSAGE *file : la file de messages.
-  ** void *msg     : l’adresse à laquelle la fonction doit copier le message lu ; ce message sera supprimé de la file.
-  ** size_t len    : la longueur (en octets) de mémoire à l’adresse msg.
-  ** long type     : Le paramètre type précise la demande,
-  **                 -- type == 0 : lire le premier message dans la file
-  **                 -- type > 0 : lire le premier message dont le type est type ;
-  **                    grâce au type, plusieurs processus peuvent utiliser la même file de messages,
-  **                    par exemple chaque processus peut utiliser son pid comme valeur de type ;
-  **                 -- type < 0 : traiter la file comme une file de priorité ; en l’occurrence, cela signifie :
-  **                               lire le premier message dont le type est inférieur ou égal à la valeur absolue de type.
-  ** int flags     : Le paramètre flags peut prendre soit la valeur 0, soit O_NONBLOCK
-  **                 -- flags == 0 : l’appel est bloquant jusqu’à ce que la lecture réussisse.
-  **                 -- si flags == O_NONBLOCK, et s’il n’y a pas de message du type demandé dans la file,
-  **                                l’appel retourne tout de suite avec la valeur −1 et errno == EAGAIN.
+  ** long type     : le type des messages attendus.
+  ** int signum    : le signal à recevoir, dans [1..NSIG].
   *
-  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec.
+  * Un processus peut s’enregistrer plusieurs fois, pour plusieurs types ou plusieurs signaux.
+  * Un envoi ne parcourt que les enregistrements dont le type a le même hachage que le sien. Quand les NB_NOTIFICATIONS
+  * enregistrements sont pris, ceux des processus qui n’existent plus sont libérés.
+  *
+  * Valeur de retour : 1 si OK, −1 en cas d’échec (errno prend la valeur EINVAL si signum n’est pas un signal,
+  *                    ENOSPC s’il n’y a plus d’enregistrement libre).
   */
 int enregistrement_notifications(MESSAGE* file, long type, int signum) {
 
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	if (file->observation) { // m_observation : l'enregistrement s'écrit dans la file
+		errno = EBADF;
+		return -1;
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	// M_FRAGMENTS : les envois d'un type ne notifient que les enregistrements de son fragment
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		MESSAGE sous_file = message_fragment(file, fragment_du_type(ptr_file_de_messages, type));
+		return enregistrement_notifications(&sous_file, type, signum);
+	}
 	pid_t pid = getpid(); // pid_t getpid (void)
-	int i;
 
 	// Contrôle si signum ∈ [1..NSIG]
-	if (signum < 1 || signum > NSIG)
+	if (signum < 1 || signum > NSIG) {
+		errno = EINVAL;
 		return -1;
+	}
 
-	for(i = 0 ; i < NB_PROCESSUS ; i++) {
-		if(ptr_file_de_messages->notifications[i].pid == 0) { // Il y a de la place disponible pour une nouvelle enregistrement
+	verrouiller_notifications(ptr_file_de_messages);
 
-			// int kill (pid_t pid, int signum)
-			// si signum == 0 aucun signal n'est envoyé; kill vérifie si le signal peut être envoyé.
-			int kill_result = kill(pid, 0);
-			if (kill_result == -1)
-				return -1;
+	if (ptr_file_de_messages->notifications_libres == -1 && liberer_notifications_orphelines(ptr_file_de_messages) == 0) {
+		deverrouiller_notifications(ptr_file_de_messages);
+		errno = ENOSPC;
+		return -1;
+	}
 
-			ptr_file_de_messages->notifications[i].pid = pid;
-			ptr_file_de_messages->notifications[i].signum = signum;
-			ptr_file_de_messages->notifications[i].type = type;
+	// Prendre un enregistrement libre et le mettre en tête de la liste de son type
+	int index = ptr_file_de_messages->notifications_libres;
+	ENREGISTREMENT_NOTIFICATIONS* enregistrement = &ptr_file_de_messages->notifications[index];
+	int* liste = liste_notifications(ptr_file_de_messages, type);
 
-			return 1;
-		}
-	}
+	ptr_file_de_messages->notifications_libres = enregistrement->suivant;
+	enregistrement->signum = signum;
+	enregistrement->type = type;
+	enregistrement->pid = pid; // en dernier : reparer_notifications() garde les enregistrements dont pid n'est pas nul
+	enregistrement->suivant = *liste;
+	*liste = index;
 
-	return -1;
+	atomic_fetch_add_explicit(&ptr_file_de_messages->nombre_notifications, 1, memory_order_relaxed);
+
+	deverrouiller_notifications(ptr_file_de_messages);
+
+	return 1;
 }
 
+/**
+  * Signature   : int annuler_enregistrement(MESSAGE* file);
+  * Description : Une fonction qui supprime tous les enregistrements de notifications du processus sur la file.
+  *
+  * Parametres :
+  ** MESSAGE *file : la file de messages.
+  *
+  * Valeur de retour : 1 si au moins un enregistrement a été supprimé, −1 sinon.
+  */
 int annuler_enregistrement(MESSAGE* file) {
 
-	FILE_DE_MESSAGES* ptr_file_de_messages = (FILE_DE_MESSAGES *) file->ptr_memoire_partagee;
+	if (file->observation) { // m_observation : aucun enregistrement n'a pu être fait
+		errno = EBADF;
+		return -1;
+	}
+
+	FILE_DE_MESSAGES* ptr_file_de_messages = file_de_messages(file);
+
+	// M_FRAGMENTS : les enregistrements de tous les fragments
+	if (ptr_file_de_messages->nombre_fragments > 0) {
+		size_t i;
+		int resultat = -1;
+		for (i = 0 ; i < ptr_file_de_messages->nombre_fragments ; i++) {
+			MESSAGE sous_file = message_fragment(file, i);
+			if (annuler_enregistrement(&sous_file) == 1)
+				resultat = 1;
+		}
+		return resultat;
+	}
 	pid_t pid = getpid(); // pid_t getpid (void)
-	int i;
+	int liste, nombre = 0;
 
-	for(i = 0 ; i < NB_PROCESSUS ; i++) {
-		if(ptr_file_de_messages->notifications[i].pid == pid) {
-			// void * memset (void *block, int c, size_t size)
-			memset(&ptr_file_de_messages->notifications[i], 0, sizeof(ENREGISTREMENT_NOTIFICATIONS));
-			return 1;
+	verrouiller_notifications(ptr_file_de_messages);
+
+	for (liste = 0 ; liste < NB_LISTES_NOTIFICATIONS ; liste++) {
+		int* lien = &ptr_file_de_messages->notifications_par_type[liste];
+
+		while (*lien != -1) {
+			if (ptr_file_de_messages->notifications[*lien].pid == pid) {
+				liberer_notification(ptr_file_de_messages, lien);
+				nombre++;
+			} else {
+				lien = &ptr_file_de_messages->notifications[*lien].suivant;
+			}
 		}
 	}
 
-	return -1;
+	deverrouiller_notifications(ptr_file_de_messages);
+
+	return nombre > 0 ? 1 : -1;
 }
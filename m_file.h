@@ -10,64 +10,454 @@
 #ifndef M_FILE_H_
 	#define M_FILE_H_
 	#include <pthread.h> // pthread_mutex_t
+	#include <stdint.h> // uint32_t
+	#include <stdatomic.h> // _Atomic
+	#include <time.h> // struct timespec
+	#include <sys/uio.h> // struct iovec
 
-	#define NB_PROCESSUS 10 // Le nombre de processus qui peuvent être enregistrés en même temps est limité.
+	#define NB_NOTIFICATIONS 1024 // Le nombre d'enregistrements de notifications en même temps, tous processus et types confondus
+	#define NB_LISTES_NOTIFICATIONS 64 // Les enregistrements sont chaînés par type, dans NB_LISTES_NOTIFICATIONS listes (une puissance de 2)
+
+	#define TAILLE_LIGNE_CACHE 64 // Taille d'une ligne de cache, pour séparer les données écrites par des processus différents
+
+	#define NB_TOURS_ATTENTE 1000 // Le nombre de tours d'attente active (quelques microsecondes) avant de dormir sur un futex
+
+	#define NB_CANAUX_TYPE 32 // Le nombre de canaux d'attente sur lesquels attendent les lectures d'un type donné (type > 0) ; au plus 32
+
+	#define NB_DESCRIPTEURS 64 // Le nombre de descripteurs m_fd() qui peuvent être ouverts en même temps sur une file
+
+	#define NB_LECTEURS 64 // Le nombre de connexions en lecture en même temps sur une file M_DIFFUSION
+
+	#define NB_FRAGMENTS_MAX 64 // Le nombre maximal de fragments d'une file M_FRAGMENTS
+
+	#define MAGIE_FILE 0x4C49464Du // « MFIL » : les premiers octets d'une file prête (cf. FILE_DE_MESSAGES::magie)
+
+	#define VERSION_FORMAT 3 // la disposition de la file dans la mémoire partagée ; augmentée à chaque changement incompatible
+
+	#define VALIDATION_OPERATIONS 64 // Files durables : msync() au plus tard après ce nombre d'envois et de lectures (cf. m_validation_groupee)
+
+	#define VALIDATION_DELAI_US 1000 // Files durables : ... ou quand la dernière validation a plus de ce délai, en microsecondes
+
+	#define NB_LIGNES_STATISTIQUES 16 // Le nombre de lignes de compteurs : chaque processus écrit la ligne de son processeur
+
+	/*
+	 * Options supplémentaires de m_connexion, à combiner avec les constantes O_ par un « OR » bit-à-bit.
+	 * Elles utilisent des bits que les constantes O_ n'utilisent pas et ne sont jamais transmises à shm_open().
+	 *
+	 * Les bits M_MOTEUR_MASQUE choisissent le moteur de la file au moment de la création (O_CREAT) ;
+	 * une connexion à une file existante utilise toujours le moteur choisi par le créateur.
+	 */
+	#define M_MOTEUR_MASQUE (07 << 23)
+	#define M_MUTEX         (00 << 23) // moteur par défaut : un mutex et des canaux d'attente partagés par tous les processus
+	#define M_SPSC          (01 << 23) // anneau sans verrou pour exactement un producteur et un consommateur
+	#define M_MPMC          (02 << 23) // anneau sans verrou pour plusieurs producteurs et plusieurs consommateurs
+	#define M_PRIORITE      (03 << 23) // comme M_MUTEX, avec un tas binaire pour les lectures par priorité (type < 0)
+	#define M_OCTETS        (04 << 23) // un mutex et un anneau d'octets : chaque message n'occupe que sa propre longueur
+	#define M_DIFFUSION     (05 << 23) // anneau écrit une fois, lu par chaque lecteur connecté ; les envois attendent le lecteur le plus lent
+	#define M_DIFFUSION_ABANDON (06 << 23) // comme M_DIFFUSION, mais les lecteurs trop lents sont décrochés au lieu de bloquer les envois
+
+	// Les options suivantes ne comptent, elles aussi, qu'à la création de la file
+	#define M_ALIGNE        (01 << 26) // chaque place (message ou enregistrement) commence sur une ligne de cache : deux messages voisins ne partagent pas de ligne
+	#define M_FRAGMENTS     (01 << 30) // nb_fragments sous-files indépendantes dans le même segment, choisies par le type du message (cf. m_connexion)
+	#define M_EXTENSIBLE    (01 << 5)  // M_MUTEX, M_PRIORITE : la file pourra grandir jusqu'à capacite_maximale (cf. m_redimensionner) ;
+	                                   // les bits hauts sont tous pris, et les bits 2 à 5 ne servent à aucune constante O_ sous Linux
+
+	// Les options de projection, au contraire, ne concernent que le processus qui se connecte (avec ou sans O_CREAT)
+	#define M_GRANDES_PAGES (01 << 27) // projeter la file sur des grandes pages (MAP_HUGETLB, sinon madvise(MADV_HUGEPAGE)) ; à défaut, des pages normales
+	#define M_PRECHARGE     (01 << 28) // toucher toutes les pages dès la connexion (MAP_POPULATE) : pas de défaut de page au premier passage
+	#define M_MLOCK         (01 << 29) // verrouiller la file en mémoire (mlock) : ses pages ne vont jamais dans le swap
 
 	struct mon_message{
 		long type; // le type du message
 		void* mtext; // le message lui-même
 	};
 
+	// Les statistiques d'une file, remplies par m_stats() : la somme des compteurs de tous les processus depuis la création de la file
+	struct m_statistiques {
+		uint64_t envois; // le nombre de messages envoyés
+		uint64_t receptions; // le nombre de messages lus
+		uint64_t octets_envoyes; // le nombre d'octets envoyés
+		uint64_t octets_recus; // le nombre d'octets lus
+		uint64_t envois_refuses; // le nombre d'envois O_NONBLOCK refusés (EAGAIN, file pleine)
+		uint64_t receptions_refusees; // le nombre de lectures O_NONBLOCK refusées (EAGAIN, pas de message)
+		uint64_t messages_perimes; // le nombre de messages jetés à la lecture parce que leur durée de vie était passée (m_envoi_ttl)
+		uint64_t attentes_file_pleine; // le nombre de fois qu'un envoi a attendu une place
+		uint64_t attentes_file_vide; // le nombre de fois qu'une lecture a attendu un message
+		uint64_t attentes_verrou; // le nombre de fois que le mutex de la file était pris par un autre processus
+		uint64_t duree_attente_file_pleine; // la durée totale de ces attentes, en nanosecondes
+		uint64_t duree_attente_file_vide;
+		uint64_t duree_attente_verrou;
+		size_t occupation; // le nombre de messages actuellement dans la file (m_nb)
+		size_t occupation_maximale; // le plus grand nombre de messages dans la file
+	};
+
 	// le type MESSAGE identifie la file de messages et sera utilisé par de nombreuses fonctions
 	typedef struct ptr_file {
 		int   type_ouverture_file_de_messages; // lecture, écriture, lecture et écriture
 		void* ptr_memoire_partagee; // le pointeur vers la mémoire partagée qui contient la file
+		size_t taille_projection; // la taille projetée par ce processus (arrondie à une grande page avec MAP_HUGETLB)
+		int lecteur; // moteurs M_DIFFUSION : la place de cette connexion parmi les lecteurs de la file ; -1 si aucune
+		pid_t pid_lecteur; // moteurs M_DIFFUSION : le processus à qui est ce lecteur (après fork(), l'enfant prend le sien)
+		int descripteur; // le descripteur de shm_open(), gardé pour m_redimensionner ; -1 pour une file anonyme
+		int options_projection; // M_PRECHARGE et M_MLOCK, étendus aux places ajoutées par m_redimensionner
+		uint32_t generation; // la génération de la file (cf. m_redimensionner) vue par la dernière opération de ce processus
+		size_t taille_utile; // la partie de la projection que la file occupait à cette génération
+		void* bloc_local; // m_connexion_locale : le bloc de calloc() qui contient la file ; NULL pour une file projetée
+		size_t longueur_hors_ligne; // m_hors_ligne : la longueur maximale des messages que cette connexion envoie hors ligne ; 0 : aucun
+		mode_t mode_hors_ligne; // m_hors_ligne : les droits des objets mémoire des messages hors ligne (ceux de la file)
+		int observation; // m_observation : la file est projetée en lecture seule (PROT_READ) ; aucune lecture de message
 	} MESSAGE ;
 
+	/**
+	 * Le descripteur d'un élément du tableau circulaire. Les descripteurs se suivent, sans les messages : les recherches
+	 * par type et le maintien des listes parcourent une mémoire contiguë. Le message de l'élément d'indice i est dans
+	 * la zone des messages, à la place i (cf. message_element).
+	 */
 	typedef struct message_file {
 		long  type; // le type du message
-		void* message; // le message lui-même
 		int   longueur_message; //  le nombre d’octets dans le message (nécessaire pour la valeur de retour de m_reception)
+		_Atomic uint32_t sequence; // moteur M_MPMC : position pour laquelle l'élément est prêt (cf. CURSEURS_MPMC)
+
+		// Moteur M_MUTEX : les éléments sont chaînés par leurs indices (-1 marque la fin d'une liste)
+		int suivant; // le message suivant dans la file (ou l'élément libre suivant)
+		int precedent; // le message précédent dans la file
+		int suivant_meme_type; // le message suivant du même type
+
+		int etat; // moteurs M_MUTEX et M_PRIORITE : ELEMENT_LIBRE, ELEMENT_RESERVE ... (pour reconstruire les listes, cf. reparer_file)
+		pid_t pid; // le processus qui a réservé l'élément, ou qui a lu son message
+
+		// Moteur M_PRIORITE
+		int position_tas; // la place de l'élément dans le tas
+		uint64_t numero_ordre; // l'ordre d'arrivée, pour départager les messages de même type ; moteurs M_DIFFUSION : la position prise par l'envoi
+
+		uint64_t peremption; // l'heure (CLOCK_MONOTONIC, en nanosecondes) après laquelle le message est jeté au lieu d'être lu ; 0 : jamais
+
+		uint32_t somme_controle; // files durables : la somme de contrôle du type, de la longueur et du message (cf. restaurer_file)
 	} FILE_ELEMENT ;
 
+	/**
+	 * Un message hors ligne (cf. m_hors_ligne) : plus long que longueur_maximale_message, il est dans son propre objet mémoire,
+	 * et sa place ne contient que cette poignée ; longueur_message est sa vraie longueur. Le nom de l'objet mémoire
+	 * se déduit de la poignée (cf. nom_hors_ligne).
+	 */
+	typedef struct poignee_hors_ligne {
+		uint64_t numero; // le numéro de l'objet parmi ceux du processus qui l'a créé
+		int64_t pid; // le processus qui l'a créé
+	} POIGNEE_HORS_LIGNE ;
+
+	#define ELEMENT_LIBRE   0 // dans la liste des éléments libres
+	#define ELEMENT_RESERVE 1 // pris par un envoi, le message n'est pas encore publié
+	#define ELEMENT_PUBLIE  2 // message dans la file
+	#define ELEMENT_LU      3 // message retiré de la file, élément pas encore rendu (m_reception_peek)
+
+	/**
+	 * Une entrée de l'index des types du moteur M_MUTEX : une table de hachage (sondage linéaire) qui associe
+	 * à chaque type présent dans la file le premier et le dernier message de ce type.
+	 */
+	typedef struct index_type {
+		long type;
+		int  premier; // -1 : entrée libre
+		int  dernier;
+	} INDEX_TYPE ;
+
+	/**
+	 * Un enregistrement de notifications : le processus pid recevra le signal signum au prochain message de ce type.
+	 * Les enregistrements de la mémoire partagée sont chaînés, par hachage du type, dans notifications_par_type
+	 * ou dans la liste des enregistrements libres.
+	 */
 	typedef struct enregistrement_notifications {
 		long  type; // le type du message
 		int signum; // Quand le processus s’enregistre, il doit indiquer quel signal il veut recevoir
 		pid_t   pid;
+		int suivant; // l'enregistrement suivant de la même liste ; -1 : fin de la liste
 	} ENREGISTREMENT_NOTIFICATIONS ;
 
 	/**
-	 * Une structure qui contient des informations générales sur l’état de la file de messages
-	 * et un pointer vers le debut de la file (debut du tableau circulaire)
+	 * Un descripteur ouvert par m_fd() : une FIFO nommée dont un seul processus lit l'extrémité lecture.
+	 * Quand il est armé, le premier envoi (ou la première libération d'une place) qui rend la condition vraie
+	 * le désarme et écrit un octet dans la FIFO, ce qui la rend lisible.
+	 */
+	typedef struct abonnement_descripteur {
+		_Atomic uint32_t etat; // DESCRIPTEUR_LIBRE, DESCRIPTEUR_INSCRIT ou DESCRIPTEUR_ARME
+		uint32_t generation; // change à chaque inscription : les processus qui envoient gardent la FIFO ouverte tant qu'elle ne change pas
+		int sorte; // ATTENTE_FILE_VIDE : attend un message (POLLIN) ; ATTENTE_FILE_PLEINE : attend une place (POLLOUT)
+		pid_t pid; // le processus qui a ouvert le descripteur
+		uid_t uid; // son utilisateur : le répertoire de la FIFO, et le propriétaire qu'elle doit avoir
+		unsigned numero; // avec pid, donne le nom de la FIFO
+	} ABONNEMENT_DESCRIPTEUR ;
+
+	#define DESCRIPTEUR_LIBRE   0
+	#define DESCRIPTEUR_INSCRIT 1 // la FIFO est peut-être déjà lisible : personne ne doit y écrire
+	#define DESCRIPTEUR_ARME    2 // la FIFO est vide et attend que la condition devienne vraie
+
+	/**
+	 * Les indices du moteur M_SPSC. Ce sont des compteurs 32 bits qui ne font qu'augmenter ;
+	 * l'indice dans le tableau circulaire est compteur & (capacite - 1), la capacité étant une puissance de 2.
+	 * Chaque ligne de cache n'est écrite, dans le cas normal, que par un seul des deux processus.
+	 */
+	typedef struct curseurs_spsc {
+		// Ligne du producteur
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t queue; // le nombre de messages publiés (aussi le mot futex du consommateur)
+		uint32_t tete_locale; // la dernière valeur de tete lue par le producteur
+		_Atomic uint32_t attente_consommateur; // 1 si le consommateur dort (ou va dormir) sur queue
+
+		// Ligne du consommateur
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t tete; // le nombre de messages lus (aussi le mot futex du producteur)
+		uint32_t queue_locale; // la dernière valeur de queue lue par le consommateur
+		_Atomic uint32_t attente_producteur; // 1 si le producteur dort (ou va dormir) sur tete
+	} CURSEURS_SPSC ;
+
+	/**
+	 * Les indices du moteur M_MPMC (file bornée de D. Vyukov). Producteurs et consommateurs réservent une position
+	 * par compare-and-swap sur queue ou tete ; la sequence de chaque élément dit à qui il appartient :
+	 * sequence == position : libre pour le producteur de cette position,
+	 * sequence == position + 1 : rempli, prêt pour le consommateur de cette position.
+	 * Les mots futex ne sont modifiés que lorsqu'un processus attend.
+	 * Les moteurs M_DIFFUSION utilisent les mêmes champs : tete y est la position du lecteur le plus lent
+	 * à la dernière vérification, et sequence == position + 1 veut dire « publié pour la position ».
+	 */
+	typedef struct curseurs_mpmc {
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t queue; // la prochaine position à remplir
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t tete; // la prochaine position à lire
+
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t signal_non_vide; // mot futex des consommateurs qui attendent un message
+		_Atomic uint32_t consommateurs_en_attente;
+
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t signal_non_plein; // mot futex des producteurs qui attendent une place
+		_Atomic uint32_t producteurs_en_attente;
+	} CURSEURS_MPMC ;
+
+	/**
+	 * L'en-tête d'un message du moteur M_OCTETS. Les messages sont rangés les uns après les autres dans un anneau d'octets,
+	 * chacun suivi de son contenu ; la place occupée est un multiple de sizeof(ENREGISTREMENT).
+	 * Un message qui ne tient pas avant la fin de l'anneau commence au début, après un bourrage jusqu'à la fin.
+	 */
+	typedef struct enregistrement {
+		uint32_t taille; // la place occupée dans l'anneau, en-tête compris
+		uint32_t longueur; // le nombre d'octets du message (la longueur réservée, avant m_envoi_commit)
+		uint32_t etat; // ENREGISTREMENT_RESERVE, ENREGISTREMENT_PUBLIE ...
+		pid_t pid; // le processus qui a réservé la place, ou qui a lu son message
+		long type; // le type du message
+	} ENREGISTREMENT ;
+
+	#define ENREGISTREMENT_RESERVE  1 // place réservée, le message n'est pas encore publié
+	#define ENREGISTREMENT_PUBLIE   2 // message dans la file
+	#define ENREGISTREMENT_LU       3 // message retiré de la file, place pas encore libérée (m_reception_peek)
+	#define ENREGISTREMENT_LIBERE   4 // place libérée, rendue à l'anneau quand les places précédentes le sont aussi
+	#define ENREGISTREMENT_BOURRAGE 5 // place perdue jusqu'à la fin de l'anneau
+
+	/**
+	 * Un lecteur des moteurs M_DIFFUSION : une connexion en lecture, qui lit tous les messages à partir de sa position.
+	 * Chaque lecteur n'écrit que sa propre ligne de cache ; les envois ne les parcourent que lorsque l'anneau semble plein.
+	 */
+	typedef struct lecteur_diffusion {
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t position; // la prochaine position à lire
+		_Atomic uint32_t etat; // LECTEUR_LIBRE, LECTEUR_ACTIF ...
+		pid_t pid; // le processus connecté
+	} LECTEUR_DIFFUSION ;
+
+	#define LECTEUR_LIBRE    0 // place libre
+	#define LECTEUR_ACTIF    1 // les envois attendent que ce lecteur ait lu un message avant de réutiliser sa place
+	#define LECTEUR_DECROCHE 2 // dépassé par les envois (M_DIFFUSION_ABANDON) : sa prochaine lecture échoue avec EOVERFLOW
+
+	/**
+	 * Les compteurs d'octets du moteur M_OCTETS. Ils ne font qu'augmenter ; la position dans l'anneau est compteur % taille_anneau.
+	 * tete <= lecture <= queue : les places de tete à lecture sont lues mais peut-être pas encore libérées,
+	 * celles de lecture à queue sont réservées ou publiées.
+	 */
+	typedef struct curseurs_octets {
+		uint64_t tete; // le début de la plus ancienne place occupée
+		uint64_t lecture; // le début du prochain message à lire
+		uint64_t queue; // la fin de la dernière place réservée
+		size_t taille_anneau; // la taille de l'anneau en octets
+		size_t nombre_enregistrements; // le nombre de places occupées (réservées, publiées ou lues), au plus capacite
+	} CURSEURS_OCTETS ;
+
+	/**
+	 * Un canal d'attente des moteurs M_MUTEX et M_PRIORITE, à la place d'une condition pthread : un mot futex et
+	 * le nombre de processus endormis dessus. Signaler le canal incrémente sequence ; l'appel système qui réveille
+	 * les processus n'est fait que si en_attente n'est pas nul.
+	 */
+	typedef struct canal_attente {
+		_Atomic uint32_t sequence; // le mot futex, incrémenté à chaque signalement
+		_Atomic uint32_t en_attente; // le nombre de processus endormis (ou qui vont s'endormir) sur sequence
+	} CANAL_ATTENTE ;
+
+	// Les sortes d'attente comptées par les statistiques
+	#define ATTENTE_FILE_PLEINE 0 // un envoi attend une place
+	#define ATTENTE_FILE_VIDE   1 // une lecture attend un message
+	#define ATTENTE_VERROU      2 // un processus attend le mutex de la file, pris par un autre
+	#define NB_SORTES_ATTENTE   3
+
+	/**
+	 * Une ligne de compteurs des statistiques. Chaque processus incrémente la ligne du processeur sur lequel il tourne :
+	 * deux processus qui tournent en même temps n'écrivent pas la même ligne de cache, sauf si leurs processeurs
+	 * ont le même numéro modulo NB_LIGNES_STATISTIQUES. Les compteurs ne font qu'augmenter.
+	 */
+	typedef struct statistiques_ligne {
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint64_t envois; // les messages envoyés
+		_Atomic uint64_t receptions; // les messages lus
+		_Atomic uint64_t octets_envoyes;
+		_Atomic uint64_t octets_recus;
+		_Atomic uint64_t refus[2]; // les appels O_NONBLOCK qui ont échoué avec EAGAIN : [ATTENTE_FILE_PLEINE] envois, [ATTENTE_FILE_VIDE] lectures
+		_Atomic uint64_t perimes; // les messages jetés à la lecture, leur durée de vie passée
+		_Atomic uint64_t attentes[NB_SORTES_ATTENTE]; // le nombre d'attentes de chaque sorte
+		_Atomic uint64_t duree_attentes[NB_SORTES_ATTENTE]; // leur durée totale, en nanosecondes
+	} STATISTIQUES_LIGNE ;
+
+	// Les statistiques d'une file, dans la mémoire partagée ; lues par m_stats() sans prendre le mutex
+	typedef struct statistiques {
+		STATISTIQUES_LIGNE lignes[NB_LIGNES_STATISTIQUES];
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic size_t occupation_maximale; // le plus grand nombre de messages vu après un envoi
+	} STATISTIQUES ;
+
+	/**
+	 * Les files durables (m_connexion_fichier) : la file est dans un fichier ordinaire, écrit sur le disque par msync()
+	 * une fois par groupe d'opérations plutôt qu'à chaque message. Les opérations comptées par operations_validees
+	 * (l'index de validation) survivent à un arrêt de la machine ; les suivantes peuvent être perdues.
+	 */
+	typedef struct durabilite {
+		size_t operations_par_validation; // msync() dès que ce nombre d'opérations attend (0 : pas de seuil)
+		uint64_t delai_validation; // ou dès que la dernière validation a ce délai, en nanosecondes (0 : pas de seuil)
+		_Atomic uint64_t operations; // le nombre d'envois et de lectures réussis depuis la création de la file
+		_Atomic uint64_t operations_validees; // l'index de validation : les operations que le dernier msync() a écrites sur le disque
+		_Atomic uint64_t heure_validation; // l'heure (CLOCK_MONOTONIC, en nanosecondes) du dernier msync()
+		_Atomic pid_t validation_en_cours; // le processus qui fait msync(), 0 si personne
+	} DURABILITE ;
+
+	/**
+	 * Une structure qui contient des informations générales sur l’état de la file de messages ;
+	 * le tableau des descripteurs commence decalage_tableau octets après elle, la zone des messages decalage_messages octets
+	 * après elle (aucune adresse absolue : cf. debut_tableau et debut_messages).
+	 * La file ne contient que des indices et des décalages : chaque processus peut la projeter à n'importe quelle adresse,
+	 * et une connexion la vérifie sans rien y écrire (magie, version et somme de contrôle de l'en-tête).
 	 */
 	typedef struct file_de_messages {
-		ENREGISTREMENT_NOTIFICATIONS notifications[NB_PROCESSUS];
+		_Atomic uint32_t magie; // MAGIE_FILE, écrit en dernier par le créateur : 0 tant que la file n'est pas prête
+		uint32_t version; // VERSION_FORMAT de la bibliothèque qui a créé la file
+		uint32_t somme_controle_entete; // la somme de contrôle des champs fixés à la création (cf. somme_controle_entete)
 
+		/*
+		 * Chaque groupe de champs commence sur sa propre ligne de cache : les champs lus à chaque opération et écrits
+		 * seulement à la connexion, l'état protégé par le mutex, les canaux signalés par les lectures, ceux signalés par
+		 * les envois. Un envoi ne fait ainsi pas sortir du cache des lectures la ligne qu'elles viennent de modifier.
+		 */
+		int moteur; // M_MUTEX, M_SPSC ... (choisi à la création de la file)
+		int options; // M_ALIGNE ... (choisies à la création de la file)
+		int durable; // la file est dans un fichier ordinaire (m_connexion_fichier, cf. DURABILITE)
+		int locale; // la file est dans la mémoire d'un seul processus (m_connexion_locale) : mutex et futex privés
 		size_t longueur_maximale_message; // La longueur maximale d’un message
 		size_t capacite; // capacité de la file (le nombre minimal de messages que la file peut stocker)
+		size_t alignement; // la place de chaque message (ou enregistrement du moteur M_OCTETS) est un multiple de alignement
+		size_t taille_place; // la place d'un message dans la zone des messages (cf. taille_place)
+		size_t taille_index_types; // le nombre d'entrées de l'index des types (une puissance de 2), placé juste après l'en-tête
+		size_t capacite_maximale; // la capacité jusqu'à laquelle m_redimensionner peut faire grandir la file (capacite si elle ne le peut pas)
+		size_t decalage_tableau; // la place de l'index des types et du tas, prévus pour capacite_maximale : le tableau des descripteurs (ou l'anneau) commence après
+		size_t decalage_messages; // le début de la zone des messages, après les descripteurs prévus pour capacite_maximale
+		size_t taille_reservee; // la taille de l'objet mémoire à capacite_maximale : chaque processus projette toute cette place dès sa connexion
+		_Atomic uint32_t generation; // augmentée par chaque m_redimensionner
+		size_t nombre_fragments; // M_FRAGMENTS : le nombre de sous-files placées après cet en-tête ; 0 pour une file ordinaire
+		size_t taille_fragment; // M_FRAGMENTS : la place de chaque sous-file (un multiple de TAILLE_LIGNE_CACHE)
+
+		// Moteurs M_MUTEX, M_PRIORITE et M_OCTETS : écrits, mutex pris, par les envois comme par les lectures
+		_Alignas(TAILLE_LIGNE_CACHE) pthread_mutex_t mutex; // robuste : cf. reparer_file
+		pid_t proprietaire_mutex; // le processus qui a le mutex, 0 si personne
+		int first; // l’indice du premier (plus ancien) message de la file, celui qui sera lu par m_reception avec type == 0 ; -1 si vide
+		int last; // l’indice du dernier (plus récent) message de la file ; -1 si vide
+		int libre; // l’indice du premier élément libre, celui que m_envoi utilisera pour placer le nouveau message ; -1 si pleine (ou si toutes les places sont réservées)
 		size_t nombre_elements_remplis; // le nombre de messages actuellement dans la file
+		size_t taille_tas; // moteur M_PRIORITE : le nombre d'éléments du tas, placé après l'index des types (à sa taille maximale)
+		uint64_t numero_ordre_suivant; // le numero_ordre du prochain message
+
+		// Signalé par les lectures
+		_Alignas(TAILLE_LIGNE_CACHE) CANAL_ATTENTE attente_file_pleine; // Si la file d'attente est pleine et que le processus souhaite attendre qu'une place se libère
+
+		// Signalés par les envois
+		_Alignas(TAILLE_LIGNE_CACHE) CANAL_ATTENTE attente_file_vide; // Si la file d'attente est vide et que le processus souhaite attendre
+		CANAL_ATTENTE attente_priorite; // Si aucun message de type inférieur ou égal à |type| (type < 0)
+		CANAL_ATTENTE attente_type[NB_CANAUX_TYPE]; // Si aucun message du type demandé (type > 0) : canal choisi par hachage du type
+
+		CURSEURS_SPSC spsc; // utilisés seulement par le moteur M_SPSC, à la place de first, last et du mutex
+		CURSEURS_MPMC mpmc; // utilisés seulement par le moteur M_MPMC, à la place de first, last et du mutex
+		CURSEURS_OCTETS octets; // utilisés seulement par le moteur M_OCTETS, à la place de first, last et libre
+
+		STATISTIQUES statistiques; // les compteurs lus par m_stats()
 
-		int first; // l’indice du premier élément de la file, celui qui sera lu par m_reception.
-		int last; // l’indice de premier élément libre de tableau, celui que m_envoi utilisera pour placer le nouveau message.
+		// Files durables : écrits par chaque opération et par le processus qui fait msync()
+		_Alignas(TAILLE_LIGNE_CACHE) DURABILITE durabilite;
 
-		pthread_cond_t attente_file_pleine; // Si la file d'attente est pleine et que le processus souhaite attendre qu'une place se libère
-		pthread_cond_t attente_file_vide; // Si la file d'attente est vide et que le processus souhaite attendre
-		pthread_mutex_t mutex;
+		// Lus à chaque envoi (et à chaque lecture), écrits seulement quand un processus s'abonne ou se désabonne
+		_Alignas(TAILLE_LIGNE_CACHE) _Atomic uint32_t descripteurs_armes[2]; // le nombre de descripteurs m_fd() armés de chaque sorte
+		_Atomic uint32_t nombre_notifications; // le nombre d'enregistrements de notifications
 
-		FILE_ELEMENT* tableau_circulaire; // Pointer vers le debut de la file (debut du tableau circulaire)
+		ABONNEMENT_DESCRIPTEUR descripteurs[NB_DESCRIPTEURS]; // les descripteurs de m_fd()
+
+		// Les enregistrements de notifications, protégés par leur propre mutex : un envoi ne parcourt que la liste du type du message
+		pthread_mutex_t mutex_notifications;
+		int notifications_libres; // la liste des enregistrements libres
+		int notifications_par_type[NB_LISTES_NOTIFICATIONS]; // le premier enregistrement de chaque liste ; -1 si vide
+		ENREGISTREMENT_NOTIFICATIONS notifications[NB_NOTIFICATIONS];
 	} FILE_DE_MESSAGES ;
 
 
 	/**
-	 * Signature   : MESSAGE *m_connexion( const char *nom, int options [, size_t nb_msg, size_t len_max, mode_t mode]);
+	 * Signature   : MESSAGE *m_connexion( const char *nom, int options [, size_t nb_msg, size_t len_max, mode_t mode [, size_t taille_octets] [, size_t nb_fragments] [, size_t capacite_maximale]]);
 	 * Description : Une fonction qui permet soit de se connecter à une file de message existante, soit de créer
 	 *               une nouvelle file de messages et s’y connecter.
+	 *               Avec O_CREAT, options peut aussi choisir le moteur de la file (M_SPSC, M_MPMC, M_PRIORITE, M_OCTETS ...) ;
+	 *               avec M_OCTETS, taille_octets est la taille de l'anneau en octets.
+	 *               Avec M_DIFFUSION et M_DIFFUSION_ABANDON, chaque connexion en lecture reçoit tous les messages envoyés après elle ;
+	 *               après fork(), chaque processus qui lit a son propre lecteur, placé à la position de celui du père.
+	 *               M_ALIGNE aligne chaque message sur une ligne de cache (au prix de la place perdue par l'arrondi).
+	 *               M_FRAGMENTS partage la file en nb_fragments sous-files, chacune avec son propre verrou (ou ses curseurs) :
+	 *               l'ordre d'arrivée n'est alors garanti qu'entre messages du même type.
+	 *               M_EXTENSIBLE (M_MUTEX et M_PRIORITE) permet à m_redimensionner de faire grandir la file jusqu'à
+	 *               capacite_maximale ; l'index et les descripteurs sont prévus dès la création pour capacite_maximale messages.
+	 *               Avec ou sans O_CREAT, M_GRANDES_PAGES, M_PRECHARGE et M_MLOCK choisissent comment ce processus projette la file.
 	 *
 	 * m_connexion retourne un pointeur vers un objet de type MESSAGE qui identifie la file de messages et sera utilisé par d’autres fonctions.
-	 * En cas d’échec, m_connexion retourne NULL.
+	 * En cas d’échec, m_connexion retourne NULL (EAGAIN : file existante encore en cours de création ;
+	 * EINVAL : objet mémoire qui ne contient pas une file de ce format, cf. VERSION_FORMAT).
 	 */
 	MESSAGE *m_connexion(const char *nom, int options, ...);  // Fonction avec un nombre variable de parametres
 
+	/**
+	 * Signature   : MESSAGE *m_connexion_fichier( const char *chemin, int options [, size_t nb_msg, size_t len_max, mode_t mode [, size_t capacite_maximale]]);
+	 * Description : Comme m_connexion(), pour une file durable, placée dans le fichier ordinaire chemin au lieu d’un objet
+	 *               mémoire POSIX : moteurs M_MUTEX et M_PRIORITE seulement, sans M_FRAGMENTS.
+	 *               Un fichier qui contient déjà une file n’est pas recréé, même avec O_CREAT : la première connexion
+	 *               après un arrêt (de la machine ou de tous les processus connectés) la restaure. Les messages dont
+	 *               la somme de contrôle est fausse sont jetés ; ceux lus mais pas encore validés peuvent revenir.
+	 *               Les pages modifiées sont écrites sur le disque par groupes (cf. m_validation_groupee).
+	 *
+	 * En cas d’échec, m_connexion_fichier retourne NULL (EINVAL : moteur impossible, ou fichier qui n’est pas une file durable).
+	 */
+	MESSAGE *m_connexion_fichier(const char *chemin, int options, ...);
+
+	/**
+	 * Signature   : MESSAGE *m_connexion_locale(int options, size_t nb_msg, size_t len_max [, size_t taille_octets] [, size_t nb_fragments] [, size_t capacite_maximale]);
+	 * Description : Crée une file pour les threads du processus appelant seulement, dans la mémoire du processus (calloc)
+	 *               au lieu d’une projection partagée : mutex et futex privés, sans shm_open() ni mmap(). Tous les threads
+	 *               se servent du MESSAGE retourné, avec les mêmes fonctions que pour une autre file ; après fork(), l’enfant
+	 *               a sa propre copie de la file. Pas de moteur M_DIFFUSION ni d’option de projection.
+	 *
+	 * En cas d’échec, m_connexion_locale retourne NULL (EINVAL : moteur ou option impossible).
+	 */
+	MESSAGE *m_connexion_locale(int options, ...);
+
+	/**
+	 * Signature   : MESSAGE *m_observation(const char *nom, int options);
+	 * Description : Une connexion de surveillance à la file existante nom : l’objet mémoire est ouvert en O_RDONLY et projeté
+	 *               en lecture seule (PROT_READ), sans rien y écrire. Seules les fonctions qui lisent l’état de la file
+	 *               (m_nb, m_capacite, m_message_len, m_stats ...) s’en servent ; les lectures de messages, m_fd() et
+	 *               les notifications échouent avec EBADF, comme les envois. options : M_GRANDES_PAGES, M_PRECHARGE, M_MLOCK.
+	 *               Une connexion O_RDONLY de m_connexion() lit les messages : elle écrit dans la file (mutex, curseurs)
+	 *               et demande donc aussi le droit d’écriture sur l’objet mémoire.
+	 *
+	 * En cas d’échec, m_observation retourne NULL (EINVAL si nom est NULL, ou comme m_connexion sans O_CREAT).
+	 */
+	MESSAGE *m_observation(const char *nom, int options);
+
 	/**
 	  * Signature : int m_deconnexion(MESSAGE *file);
 	  * Description : Une fonction qui déconnecte le processus de la file de messages ;
@@ -92,8 +482,8 @@
 	  * Description : Une fonction qui envoie le message dans la file.
 	  *
 	  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon
-	  * Si la longueur du message est plus grande que la longueur maximale supportée par la file,
-	  * la fonction retourne immédiatement −1 et met EMSGSIZE dans errno.
+	  * Si la longueur du message est plus grande que la longueur maximale supportée par la file (et que celle
+	  * des messages hors ligne de la connexion, cf. m_hors_ligne), la fonction retourne immédiatement −1 et met EMSGSIZE dans errno.
 	  */
 	int m_envoi(MESSAGE *file, const void *msg, size_t len, int msgflag);
 
@@ -108,8 +498,165 @@
 	  */
 	ssize_t m_reception(MESSAGE *file, void *msg, size_t len, long type, int flags);
 
+	/* Les attentes bornées et la durée de vie des messages */
+
+	/**
+	  * Signature : int m_envoi_timeout(MESSAGE *file, const void *msg, size_t len, const struct timespec *echeance);
+	  * Description : Une fonction qui envoie le message comme m_envoi() bloquant, en attendant une place au plus jusqu’à
+	  *               l’heure echeance de l’horloge CLOCK_MONOTONIC (NULL : sans limite).
+	  *
+	  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon (errno prend la valeur ETIMEDOUT si l’échéance est passée).
+	  */
+	int m_envoi_timeout(MESSAGE *file, const void *msg, size_t len, const struct timespec *echeance);
+
+	/**
+	  * Signature : ssize_t m_reception_timeout(MESSAGE *file, void *msg, size_t len, long type, const struct timespec *echeance);
+	  * Description : Une fonction qui lit un message comme m_reception() bloquant, en l’attendant au plus jusqu’à
+	  *               l’heure echeance de l’horloge CLOCK_MONOTONIC (NULL : sans limite).
+	  *
+	  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec (ETIMEDOUT si l’échéance est passée).
+	  */
+	ssize_t m_reception_timeout(MESSAGE *file, void *msg, size_t len, long type, const struct timespec *echeance);
+
+	/**
+	  * Signature : int m_envoi_ttl(MESSAGE *file, const void *msg, size_t len, int msgflag, const struct timespec *duree_vie);
+	  * Description : Une fonction qui envoie le message comme m_envoi() ; s’il n’est pas lu avant duree_vie,
+	  *               les lectures le jettent au lieu de le retourner, et sa place est rendue à la file.
+	  *
+	  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon (EINVAL avec le moteur M_OCTETS).
+	  */
+	int m_envoi_ttl(MESSAGE *file, const void *msg, size_t len, int msgflag, const struct timespec *duree_vie);
+
+	/* L’envoi et la réception sans copie */
+
+	/**
+	  * Signature : void *m_envoi_reserve(MESSAGE *file, size_t len, int msgflag);
+	  * Description : Une fonction qui réserve dans la file la place d’un message de len octets au plus,
+	  *               et retourne l’adresse où l’écrire ; le message est publié par m_envoi_commit().
+	  *
+	  * Valeur de retour : l’adresse de la place réservée, ou NULL en cas d’échec.
+	  */
+	void *m_envoi_reserve(MESSAGE *file, size_t len, int msgflag);
+
+	/**
+	  * Signature : int m_envoi_commit(MESSAGE *file, void *zone, long type, size_t len);
+	  * Description : Une fonction qui publie le message écrit à l’adresse zone retournée par m_envoi_reserve().
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec.
+	  */
+	int m_envoi_commit(MESSAGE *file, void *zone, long type, size_t len);
+
+	/**
+	  * Signature : const void *m_reception_peek(MESSAGE *file, size_t *len, long type, int flags);
+	  * Description : Une fonction qui retire de la file le premier message convenable et retourne son adresse,
+	  *               sans le copier ; sa place est rendue à la file par m_reception_release().
+	  *
+	  * Valeur de retour : l’adresse du message lu, ou NULL en cas d’échec.
+	  */
+	const void *m_reception_peek(MESSAGE *file, size_t *len, long type, int flags);
+
+	/**
+	  * Signature : int m_reception_release(MESSAGE *file, const void *zone);
+	  * Description : Une fonction qui rend à la file la place du message retourné par m_reception_peek().
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec.
+	  */
+	int m_reception_release(MESSAGE *file, const void *zone);
+
+	/* Les messages en plusieurs morceaux */
+
+	/**
+	  * Signature : int m_envoiv(MESSAGE *file, long type, const struct iovec *iov, int iovcnt, int msgflag);
+	  * Description : Une fonction qui envoie comme m_envoi() le message de type type fait des iovcnt morceaux iov[i],
+	  *               mis bout à bout directement dans la place du message (cf. writev).
+	  *
+	  * Valeur de retour : 0 quand l’envoi réussit, −1 sinon (EMSGSIZE si la somme des longueurs dépasse la longueur maximale, comme m_envoi(),
+	  *                    EINVAL si iovcnt n’est pas dans [0, IOV_MAX]).
+	  */
+	int m_envoiv(MESSAGE *file, long type, const struct iovec *iov, int iovcnt, int msgflag);
+
+	/**
+	  * Signature : ssize_t m_receptionv(MESSAGE *file, const struct iovec *iov, int iovcnt, long type, int flags);
+	  * Description : Une fonction qui lit un message comme m_reception() et le répartit directement dans les morceaux iov[i],
+	  *               remplis l’un après l’autre (cf. readv).
+	  *
+	  * Valeur de retour : le nombre d’octets du message lu, ou -1 en cas d’échec (EMSGSIZE si le message ne tient pas
+	  *                    dans les morceaux, EINVAL si iovcnt n’est pas dans [0, IOV_MAX]).
+	  */
+	ssize_t m_receptionv(MESSAGE *file, const struct iovec *iov, int iovcnt, long type, int flags);
+
+	/* Les grands messages hors ligne */
+
+	/**
+	  * Signature : int m_hors_ligne(MESSAGE *file, size_t longueur_maximale);
+	  * Description : Une fonction qui permet à cette connexion d’envoyer des messages plus longs que la longueur maximale
+	  *               de la file, jusqu’à longueur_maximale octets (0 : aucun, comme à la connexion) : un tel message va
+	  *               dans son propre objet mémoire, et sa place ne contient qu’une poignée. Toute connexion les reçoit ;
+	  *               m_envoi_reserve() et m_reception_peek() retournent une projection de l’objet, sans copie.
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec (EINVAL pour une file M_OCTETS, M_DIFFUSION ou durable, ou dont la longueur
+	  *                    maximale est plus petite qu’une poignée ; EBADF si la connexion est seulement en lecture).
+	  */
+	int m_hors_ligne(MESSAGE *file, size_t longueur_maximale);
+
+	/* Les lots */
+
+	/**
+	  * Signature : ssize_t m_envoi_lot(MESSAGE *file, const struct mon_message *msgs, const size_t *lens, size_t nb, int msgflag);
+	  * Description : Une fonction qui envoie les nb messages msgs[i] de longueur lens[i], dans cet ordre,
+	  *               avec une seule section critique et un seul réveil pour tout le lot.
+	  *
+	  * Valeur de retour : le nombre de messages envoyés, ou −1 si aucun message n’a été envoyé.
+	  */
+	ssize_t m_envoi_lot(MESSAGE *file, const struct mon_message *msgs, const size_t *lens, size_t nb, int msgflag);
+
+	/**
+	  * Signature : ssize_t m_reception_lot(MESSAGE *file, void **msgs, size_t *lens, size_t nb, long type, int flags);
+	  * Description : Une fonction qui lit jusqu’à nb messages convenables et copie le i-ème à l’adresse msgs[i] ;
+	  *               lens[i] donne la mémoire disponible, puis la longueur du message lu. Seul le premier message est attendu.
+	  *
+	  * Valeur de retour : le nombre de messages lus, ou −1 en cas d’échec.
+	  */
+	ssize_t m_reception_lot(MESSAGE *file, void **msgs, size_t *lens, size_t nb, long type, int flags);
+
+	/* Les files durables */
+
+	/**
+	  * Signature   : int m_validation_groupee(MESSAGE *file, size_t nb_operations, unsigned long delai_us);
+	  * Description : Une fonction qui règle la validation groupée d’une file durable, pour tous les processus connectés :
+	  *               msync() dès que nb_operations envois et lectures attendent, ou dès qu’une opération arrive plus de
+	  *               delai_us microsecondes après la dernière validation (0 : pas de seuil). Les seuils sont vérifiés
+	  *               après chaque opération ; m_synchroniser() valide les dernières quand la file reste inactive.
+	  *               Par défaut : VALIDATION_OPERATIONS et VALIDATION_DELAI_US.
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec (EINVAL si la file n’est pas durable, EBADF si elle est ouverte seulement en lecture).
+	  */
+	int m_validation_groupee(MESSAGE *file, size_t nb_operations, unsigned long delai_us);
+
+	/**
+	  * Signature   : int m_synchroniser(MESSAGE *file);
+	  * Description : Une fonction qui écrit tout de suite sur le disque les opérations faites sur une file durable.
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec (EINVAL si la file n’est pas durable, EBADF si elle est ouverte seulement
+	  *                    en lecture, ou l’erreur de msync()).
+	  */
+	int m_synchroniser(MESSAGE *file);
+
 	/* L’état de la file */
 
+	/**
+	  * Signature   : int m_redimensionner(MESSAGE *file, size_t nb_msg);
+	  * Description : Une fonction qui change la capacité d’une file M_MUTEX ou M_PRIORITE (sans M_FRAGMENTS) pendant
+	  *               qu’elle sert : les messages de la file restent, dans le même ordre. La file peut grandir jusqu’à
+	  *               la capacite_maximale donnée à la création avec M_EXTENSIBLE (sans M_EXTENSIBLE, jusqu’à sa capacité à la création) ;
+	  *               elle ne rétrécit que si les messages des places retirées tiennent dans les places restantes.
+	  *               Les autres processus connectés voient la nouvelle capacité à leur opération suivante.
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec (EINVAL : moteur ou capacité impossible ;
+	  *                    EBUSY : des places à retirer sont réservées ou en cours de lecture, ou les messages ne tiennent pas).
+	  */
+	int m_redimensionner(MESSAGE *file, size_t nb_msg);
+
 	/**
 	  * Signature   : size_t m_message_len(MESSAGE* message);
 	  * Description : Une fonction qui retourne la taille maximale d’un message.
@@ -122,10 +669,61 @@
 	  */
 	size_t m_capacite(MESSAGE *);
 
+	/**
+	  * Signature   : size_t m_capacite_octets(MESSAGE* file);
+	  * Description : Une fonction qui retourne le nombre d'octets que la file réserve aux messages.
+	  */
+	size_t m_capacite_octets(MESSAGE *);
+
 	/**
 	  * Signature   : size_t m_nb(MESSAGE* file);
 	  * Description : Une fonction qui retourne le nombre de messages actuellement dans la file.
 	  */
 	size_t m_nb(MESSAGE *);
 
+	/**
+	  * Signature   : int m_fd(MESSAGE *file, int evenements);
+	  * Description : Une fonction qui retourne un descripteur à surveiller avec poll(), select() ou epoll (en lecture) :
+	  *               il devient lisible quand la file n’est pas vide (evenements == POLLIN)
+	  *               ou quand elle n’est pas pleine (evenements == POLLOUT).
+	  *
+	  * Valeur de retour : le descripteur, ou −1 en cas d’échec.
+	  */
+	int m_fd(MESSAGE *file, int evenements);
+
+	/**
+	  * Signature   : int m_fermeture_fd(MESSAGE *file, int fd);
+	  * Description : Une fonction qui ferme un descripteur retourné par m_fd().
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec.
+	  */
+	int m_fermeture_fd(MESSAGE *file, int fd);
+
+	/* Les notifications */
+
+	/**
+	  * Signature   : int enregistrement_notifications(MESSAGE *file, long type, int signum);
+	  * Description : Une fonction qui enregistre le processus pour recevoir le signal signum au prochain message de ce type ;
+	  *               l’enregistrement est supprimé quand le signal est envoyé.
+	  *
+	  * Valeur de retour : 1 si OK, −1 si échec.
+	  */
+	int enregistrement_notifications(MESSAGE *file, long type, int signum);
+
+	/**
+	  * Signature   : int annuler_enregistrement(MESSAGE *file);
+	  * Description : Une fonction qui supprime tous les enregistrements de notifications du processus sur la file.
+	  *
+	  * Valeur de retour : 1 si au moins un enregistrement a été supprimé, −1 sinon.
+	  */
+	int annuler_enregistrement(MESSAGE *file);
+
+	/**
+	  * Signature   : int m_stats(MESSAGE *file, struct m_statistiques *stats);
+	  * Description : Une fonction qui remplit stats avec les compteurs de la file, sans prendre son mutex.
+	  *
+	  * Valeur de retour : 0 si OK, −1 si échec.
+	  */
+	int m_stats(MESSAGE *file, struct m_statistiques *stats);
+
 #endif /* M_FILE_H_ */
@@ -24,23 +24,10 @@
 
 void construction_et_envoi_message(MESSAGE* file, long type, void* message, size_t len, int msgflag) {
 
-	// void * malloc (size_t size)
-	struct mon_message *m = malloc( sizeof( struct mon_message ) + len );
-	if( m == NULL ){
-	   // Traiter erreur de malloc()
-		fprintf(stderr, "L'allocation de memoire a l'aide de la fonction malloc() a echoue \n");
-		exit(EXIT_FAILURE);
-	}
-
-	m -> mtext = m + 1;
-	m->type = type;
-
-	// copier le message  envoyer
-	memmove( m -> mtext, message, len) ;
-
-	m_envoi( file, m, len, msgflag) ;
+	// le message est copi directement dans sa place dans la file, sans tampon intermdiaire
+	struct iovec morceau = { message, len };
 
-	free( m );
+	m_envoiv( file, type, &morceau, 1, msgflag) ;
 
 }
 